@@ -109,6 +109,33 @@ static inline void clear_pages(void *addr, unsigned int npages)
 }
 #define clear_pages clear_pages
 
+/**
+ * clear_pages_nocache() - clear a page range with non-temporal stores.
+ * @addr: start address of kernel page range
+ * @npages: number of pages
+ *
+ * MOVNTI writes around the cache hierarchy, which keeps the clearing of
+ * memory that is not about to be used from evicting the working set.
+ * The trailing SFENCE orders the weakly ordered stores before anything
+ * that publishes the pages, such as setting a PTE.
+ */
+static inline void clear_pages_nocache(void *addr, unsigned int npages)
+{
+	u64 len = npages * PAGE_SIZE;
+	u64 *p = addr, *end = addr + len;
+
+	kmsan_unpoison_memory(addr, len);
+
+	for (; p < end; p += 4)
+		asm volatile("movnti %1, (%0)\n\t"
+			     "movnti %1, 8(%0)\n\t"
+			     "movnti %1, 16(%0)\n\t"
+			     "movnti %1, 24(%0)"
+			     : : "r" (p), "r" (0UL) : "memory");
+	asm volatile("sfence" : : : "memory");
+}
+#define clear_pages_nocache clear_pages_nocache
+
 static inline void clear_page(void *addr)
 {
 	clear_pages(addr, 1);
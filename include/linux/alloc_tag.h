@@ -134,6 +134,24 @@ static inline bool mem_alloc_profiling_enabled(void)
 				   &mem_alloc_profiling_key);
 }
 
+/*
+ * With vm.mem_profiling_sample_rate above 1, only about one allocation in that
+ * many is accounted to its tag, and the counters are scaled back up when read.
+ */
+DECLARE_STATIC_KEY_FALSE(mem_alloc_profiling_sampled);
+DECLARE_PER_CPU(int, alloc_tag_sample_countdown);
+
+bool __alloc_tag_sample(void);
+
+static inline bool alloc_tag_sample(void)
+{
+	if (!static_branch_unlikely(&mem_alloc_profiling_sampled))
+		return true;
+	if (likely(this_cpu_dec_return(alloc_tag_sample_countdown) > 0))
+		return false;
+	return __alloc_tag_sample();
+}
+
 static inline struct alloc_tag_counters alloc_tag_read(struct alloc_tag *tag)
 {
 	struct alloc_tag_counters v = { 0, 0 };
@@ -198,6 +216,12 @@ static inline bool alloc_tag_ref_set(union codetag_ref *ref, struct alloc_tag *t
 
 static inline void alloc_tag_add(union codetag_ref *ref, struct alloc_tag *tag, size_t bytes)
 {
+	if (!alloc_tag_sample()) {
+		/* Not sampled, so alloc_tag_sub() has nothing to undo either */
+		set_codetag_empty(ref);
+		return;
+	}
+
 	if (likely(alloc_tag_ref_set(ref, tag)))
 		this_cpu_add(tag->counters->bytes, bytes);
 }
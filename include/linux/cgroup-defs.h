@@ -671,6 +671,9 @@ struct cgroup_root {
 	/* Hierarchy-specific flags */
 	unsigned int flags;
 
+	/* How stale, in msecs, memory.stat may be; 0 flushes on every read */
+	unsigned int memory_stat_staleness;
+
 	/* The path to use for release notifications. */
 	char release_agent_path[PATH_MAX];
 
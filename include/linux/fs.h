@@ -1190,6 +1190,18 @@ struct fown_struct {
 	int signum;		/* posix.1b rt signal to be delivered on IO */
 };
 
+/*
+ * A sequential stream that was interleaved with the one currently tracked in
+ * struct file_ra_state, saved so it can be resumed without starting over.
+ */
+struct file_ra_stream {
+	pgoff_t start;
+	unsigned int size;
+	unsigned int async_size;
+};
+
+#define FILE_RA_STREAMS	3
+
 /**
  * struct file_ra_state - Track a file's readahead state.
  * @start: Where the most recent readahead started.
@@ -1201,6 +1213,12 @@ struct fown_struct {
  * @order: Preferred folio order used for most recent readahead.
  * @mmap_miss: How many mmap accesses missed in the page cache.
  * @prev_pos: The last byte in the most recent read request.
+ * @stride_prev: Start of the most recent strided block.
+ * @stride_next: Start of the next strided block to prefetch.
+ * @stride: Distance in pages between the starts of strided blocks.
+ * @stride_nr: Number of pages in each strided block.
+ * @stride_count: How many times in a row @stride was seen.
+ * @streams: Interleaved sequential streams, most recently used first.
  *
  * When this structure is passed to ->readahead(), the "most recent"
  * readahead means the current readahead.
@@ -1213,6 +1231,14 @@ struct file_ra_state {
 	unsigned short order;
 	unsigned short mmap_miss;
 	loff_t prev_pos;
+#ifdef CONFIG_READAHEAD_PATTERNS
+	pgoff_t stride_prev;
+	pgoff_t stride_next;
+	unsigned long stride;
+	unsigned int stride_nr;
+	unsigned int stride_count;
+	struct file_ra_stream streams[FILE_RA_STREAMS];
+#endif
 };
 
 /*
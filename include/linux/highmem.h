@@ -303,6 +303,30 @@ static inline void clear_user_highpages(struct page *page, unsigned long vaddr,
 #endif
 }
 
+/**
+ * clear_user_highpages_nocache() - clear a page range to be mapped to user
+ * space without pulling it into the caches
+ * @page: start page
+ * @vaddr: start address of the user mapping
+ * @npages: number of pages
+ *
+ * Like clear_user_highpages(), but meant for large ranges that userspace
+ * will not touch soon. Uses clear_pages_nocache() when the pages are in
+ * the direct map and need no special handling, clear_user_highpages()
+ * otherwise.
+ */
+static inline void clear_user_highpages_nocache(struct page *page,
+						unsigned long vaddr,
+						unsigned int npages)
+{
+#if defined(clear_user_highpage) || defined(clear_user_page) || \
+	defined(CONFIG_HIGHMEM)
+	clear_user_highpages(page, vaddr, npages);
+#else
+	clear_pages_nocache(page_address(page), npages);
+#endif
+}
+
 #ifndef vma_alloc_zeroed_movable_folio
 /**
  * vma_alloc_zeroed_movable_folio - Allocate a zeroed page for a VMA.
@@ -935,6 +935,8 @@ unsigned long lruvec_page_state_local(struct lruvec *lruvec,
 				      enum node_stat_item idx);
 
 void mem_cgroup_flush_stats(struct mem_cgroup *memcg);
+unsigned int mem_cgroup_flush_stats_bounded(struct mem_cgroup *memcg,
+					    unsigned int max_age);
 void mem_cgroup_flush_stats_ratelimited(struct mem_cgroup *memcg);
 
 void mod_lruvec_kmem_state(void *p, enum node_stat_item idx, int val);
@@ -1388,6 +1390,12 @@ static inline void mem_cgroup_flush_stats(struct mem_cgroup *memcg)
 {
 }
 
+static inline unsigned int mem_cgroup_flush_stats_bounded(struct mem_cgroup *memcg,
+							  unsigned int max_age)
+{
+	return 0;
+}
+
 static inline void mem_cgroup_flush_stats_ratelimited(struct mem_cgroup *memcg)
 {
 }
@@ -1846,8 +1854,10 @@ static inline bool memcg_is_dying(struct mem_cgroup *memcg)
 
 #if defined(CONFIG_MEMCG) && defined(CONFIG_ZSWAP)
 bool obj_cgroup_may_zswap(struct obj_cgroup *objcg);
-void obj_cgroup_charge_zswap(struct obj_cgroup *objcg, size_t size);
-void obj_cgroup_uncharge_zswap(struct obj_cgroup *objcg, size_t size);
+void obj_cgroup_charge_zswap(struct obj_cgroup *objcg, size_t size,
+			     unsigned int nr_pages);
+void obj_cgroup_uncharge_zswap(struct obj_cgroup *objcg, size_t size,
+			       unsigned int nr_pages);
 bool mem_cgroup_zswap_writeback_enabled(struct mem_cgroup *memcg);
 #else
 static inline bool obj_cgroup_may_zswap(struct obj_cgroup *objcg)
@@ -1855,11 +1865,11 @@ static inline bool obj_cgroup_may_zswap(struct obj_cgroup *objcg)
 	return true;
 }
 static inline void obj_cgroup_charge_zswap(struct obj_cgroup *objcg,
-					   size_t size)
+					   size_t size, unsigned int nr_pages)
 {
 }
 static inline void obj_cgroup_uncharge_zswap(struct obj_cgroup *objcg,
-					     size_t size)
+					     size_t size, unsigned int nr_pages)
 {
 }
 static inline bool mem_cgroup_zswap_writeback_enabled(struct mem_cgroup *memcg)
@@ -4828,6 +4828,22 @@ static inline void clear_pages(void *addr, unsigned int npages)
 }
 #endif
 
+#ifndef clear_pages_nocache
+/**
+ * clear_pages_nocache() - clear a page range while bypassing the caches.
+ * @addr: start address
+ * @npages: number of pages
+ *
+ * Architectures with non-temporal stores can provide this to clear memory
+ * which is not going to be accessed soon without polluting the caches.
+ * The stores must be ordered before return. Falls back to clear_pages().
+ */
+static inline void clear_pages_nocache(void *addr, unsigned int npages)
+{
+	clear_pages(addr, npages);
+}
+#endif
+
 #ifndef PROCESS_PAGES_NON_PREEMPT_BATCH
 #ifdef clear_pages
 /*
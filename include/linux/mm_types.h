@@ -1345,6 +1345,14 @@ struct mm_struct {
 
 		/* numa_scan_seq prevents two threads remapping PTEs. */
 		int numa_scan_seq;
+
+		/*
+		 * With NUMA_BALANCING_MGLRU, the node most threads of this mm
+		 * run on, elected by a majority vote from the scheduler tick.
+		 * The MGLRU mm walk migrates young folios towards it.
+		 */
+		int numa_access_nid;
+		int numa_access_votes;
 #endif
 		/*
 		 * An operation with batched TLB flushing is going on. Anything
@@ -1982,6 +1990,8 @@ enum {
 #define MMF_TOPDOWN		31	/* mm searches top down by default */
 #define MMF_TOPDOWN_MASK	BIT(MMF_TOPDOWN)
 
+#define MMF_ASYNC_TEARDOWN	32	/* tear down asynchronously on exit */
+
 #define MMF_INIT_LEGACY_MASK	(MMF_DUMP_FILTER_MASK |\
 				 MMF_DISABLE_THP_MASK | MMF_HAS_MDWE_MASK |\
 				 MMF_VM_MERGE_ANY_MASK | MMF_TOPDOWN_MASK)
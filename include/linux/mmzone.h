@@ -599,6 +599,9 @@ enum {
 /* double-buffering Bloom filters */
 #define NR_BLOOM_FILTERS	2
 
+/* misplaced folios an mm walk isolates before migrating them */
+#define LRU_GEN_NUMA_BATCH	16
+
 struct lru_gen_mm_state {
 	/* synced with max_seq after each iteration */
 	unsigned long seq;
@@ -627,6 +630,12 @@ struct lru_gen_mm_walk {
 	int batched;
 	int swappiness;
 	bool force_scan;
+#ifdef CONFIG_NUMA_BALANCING
+	/* the node the mm under walk mostly runs on, see NUMA_BALANCING_MGLRU */
+	int numa_nid;
+	int nr_numa_folios;
+	struct folio *numa_folios[LRU_GEN_NUMA_BATCH];
+#endif
 };
 
 /*
@@ -1517,6 +1526,8 @@ typedef struct pglist_data {
 	struct mutex kswapd_lock;
 #endif
 	struct task_struct *kswapd;	/* Protected by kswapd_lock */
+	/* Extra reclaim threads, see kswapd_threads in the node's sysfs */
+	struct kswapd_helpers *kswapd_helpers;
 	int kswapd_order;
 	enum zone_type kswapd_highest_zoneidx;
 
@@ -1528,6 +1539,10 @@ typedef struct pglist_data {
 	wait_queue_head_t kcompactd_wait;
 	struct task_struct *kcompactd;
 	bool proactive_compact_trigger;
+	/* Free block target and parallelism, see compact_* in node sysfs */
+	unsigned int kcompactd_workers;
+	unsigned int kcompactd_target_order;
+	unsigned long kcompactd_target_nr;
 #endif
 	/*
 	 * This is a per-node reserve of pages that are not available
@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_PERCPU_COUNTER_TREE_H
+#define _LINUX_PERCPU_COUNTER_TREE_H
+/*
+ * A hierarchical "approximate counter" with a bounded error.
+ *
+ * Each CPU counts what it adds. Every time a CPU count crosses a multiple
+ * of the batch, that multiple is carried into an intermediate node shared
+ * by a group of neighbouring CPUs, whose crossings are carried further up
+ * with a batch ARITY times larger, until the root. The root is the
+ * approximate value: it is never above the precise sum and never more than
+ * the accuracy below it, and it is read with a single load. The precise sum
+ * still needs all CPU counts, but since those are never reset it needs no
+ * lock and no CPU hotplug handling.
+ */
+
+#include <linux/atomic.h>
+#include <linux/cache.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+#include <linux/types.h>
+
+/* log2 of how many children an intermediate node has */
+#define PERCPU_COUNTER_TREE_ARITY_SHIFT	3
+#define PERCPU_COUNTER_TREE_ARITY	(1U << PERCPU_COUNTER_TREE_ARITY_SHIFT)
+
+/* default CPU batch, rounded up to a power of 2 when one is given */
+#define PERCPU_COUNTER_TREE_BATCH	32
+
+struct percpu_counter_tree_item {
+	atomic_long_t count;
+} ____cacheline_aligned_in_smp;
+
+struct percpu_counter_tree {
+	unsigned long __percpu *counters;
+	/* the intermediate nodes level after level, the root is the last one */
+	struct percpu_counter_tree_item *items;
+	struct percpu_counter_tree_item *root;
+	unsigned int nr_levels;
+	unsigned int batch_shift;
+	long bias;
+	/* how far the approximate value can be below the precise sum */
+	long accuracy;
+	/* serializes percpu_counter_tree_limited_add() slow paths */
+	raw_spinlock_t lock;
+};
+
+int percpu_counter_tree_init(struct percpu_counter_tree *pct, long amount,
+			     unsigned int batch, gfp_t gfp);
+void percpu_counter_tree_destroy(struct percpu_counter_tree *pct);
+void percpu_counter_tree_add(struct percpu_counter_tree *pct, long amount);
+long percpu_counter_tree_sum(struct percpu_counter_tree *pct);
+int percpu_counter_tree_compare(struct percpu_counter_tree *pct, long rhs);
+bool percpu_counter_tree_limited_add(struct percpu_counter_tree *pct,
+				     long limit, long amount);
+
+static inline void percpu_counter_tree_sub(struct percpu_counter_tree *pct,
+					   long amount)
+{
+	percpu_counter_tree_add(pct, -amount);
+}
+
+/*
+ * Never above percpu_counter_tree_sum(), and less than pct->accuracy below it
+ * once the updates racing with the read have completed.
+ */
+static inline long percpu_counter_tree_read(struct percpu_counter_tree *pct)
+{
+	return atomic_long_read(&pct->root->count) + pct->bias;
+}
+
+static inline long
+percpu_counter_tree_read_positive(struct percpu_counter_tree *pct)
+{
+	long ret = percpu_counter_tree_read(pct);
+
+	return ret < 0 ? 0 : ret;
+}
+
+#endif /* _LINUX_PERCPU_COUNTER_TREE_H */
@@ -72,6 +72,24 @@ enum psi_states {
 /* Use one bit in the state mask to track TSK_ONCPU */
 #define PSI_ONCPU	(1 << NR_PSI_STATES)
 
+/*
+ * What a group's subtree looks like on a CPU, as far as its parent is
+ * concerned. A parent's pressure states follow from its own tasks and
+ * from how many of its children are in each subtree state, so a task
+ * change only needs to go up the hierarchy for as long as it changes
+ * the subtree state of a group.
+ */
+enum psi_subtree_states {
+	PSI_SUBTREE_IOWAIT,		/* tasks in iowait */
+	PSI_SUBTREE_MEMSTALL,		/* tasks in a memstall */
+	PSI_SUBTREE_RUNNING,		/* runnable tasks */
+	PSI_SUBTREE_PRODUCTIVE,		/* runnable tasks not in a memstall */
+	PSI_SUBTREE_QUEUED,		/* runnable tasks not on the CPU */
+	PSI_SUBTREE_ONCPU,		/* the current task */
+	PSI_SUBTREE_ONCPU_MEMSTALL,	/* the current task, in a memstall */
+	NR_PSI_SUBTREE_STATES,
+};
+
 /* Flag whether to re-arm avgs_work, see details in get_recent_times() */
 #define PSI_STATE_RESCHEDULE	(1 << (NR_PSI_STATES + 1))
 
@@ -84,19 +102,25 @@ enum psi_aggregators {
 struct psi_group_cpu {
 	/* 1st cacheline updated by the scheduler */
 
-	/* States of the tasks belonging to this group */
+	/* States of the tasks belonging to this group itself */
 	unsigned int tasks[NR_PSI_TASK_COUNTS]
 			____cacheline_aligned_in_smp;
 
-	/* Aggregate pressure state derived from the tasks */
+	/* Aggregate pressure state derived from the subtree state */
 	u32 state_mask;
 
+	/* Subtree state derived from the tasks and the children */
+	u32 subtree_mask;
+
 	/* Period time sampling buckets for each state of interest (ns) */
 	u32 times[NR_PSI_STATES];
 
-	/* Time of last task change in this group (rq_clock) */
+	/* Time of last state change in this group (rq_clock) */
 	u64 state_start;
 
+	/* Number of child groups in each subtree state */
+	unsigned int children[NR_PSI_SUBTREE_STATES];
+
 	/* 2nd cacheline updated by the aggregator */
 
 	/* Delta detection against the sampling buckets */
@@ -85,6 +85,8 @@ struct scx_dispatch_q {
 	struct rb_root		priq;	/* used to order by p->scx.dsq_vtime */
 	u32			nr;
 	u32			seq;	/* used by BPF iter */
+	u32			flags;	/* SCX_CREATE_DSQ_* */
+	struct llist_head	pending; /* lockless insertions not on list yet */
 	u64			id;
 	struct rhash_head	hash_node;
 	struct llist_node	free_node;
@@ -191,6 +193,7 @@ struct sched_ext_entity {
 	u64			ddsp_enq_flags;
 	struct scx_dsq_list_node dsq_list;	/* dispatch order */
 	struct rb_node		dsq_priq;	/* p->scx.dsq_vtime order */
+	struct llist_node	dsq_pending;	/* see dispatch_enqueue_lockless() */
 	u32			dsq_seq;
 	u32			dsq_flags;	/* protected by DSQ lock */
 	u32			flags;		/* protected by rq lock */
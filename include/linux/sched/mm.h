@@ -146,6 +146,9 @@ extern void mmput(struct mm_struct *);
  */
 void mmput_async(struct mm_struct *);
 #endif
+/* same as mmput, but may tear the mm down asynchronously on task exit */
+void mmput_exit(struct mm_struct *mm);
+bool mm_teardown_pending(void);
 
 /* Grab a reference to a task's mm, if it is not already going away */
 extern struct mm_struct *get_task_mm(struct task_struct *task);
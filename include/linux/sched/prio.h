@@ -27,6 +27,20 @@
 #define NICE_TO_PRIO(nice)	((nice) + DEFAULT_PRIO)
 #define PRIO_TO_NICE(prio)	((prio) - DEFAULT_PRIO)
 
+/*
+ * Latency nice asks for shorter (negative) or longer (positive) slices than
+ * the default, independently of the nice value that sets the weight. Like
+ * the nice value it goes from -20 to 19, and is stored as a latency priority
+ * from 0 to LATENCY_NICE_WIDTH - 1.
+ */
+#define MAX_LATENCY_NICE	19
+#define MIN_LATENCY_NICE	-20
+#define LATENCY_NICE_WIDTH	(MAX_LATENCY_NICE - MIN_LATENCY_NICE + 1)
+#define DEFAULT_LATENCY_PRIO	(LATENCY_NICE_WIDTH / 2)
+
+#define NICE_TO_LATENCY(nice)	((nice) + DEFAULT_LATENCY_PRIO)
+#define LATENCY_TO_NICE(prio)	((prio) - DEFAULT_LATENCY_PRIO)
+
 /*
  * Convert nice value [19,-20] to rlimit style value [1,40].
  */
@@ -243,6 +243,21 @@ struct swap_sequential_cluster {
 	unsigned int next[SWAP_NR_ORDERS]; /* Likely next allocation offset */
 };
 
+/*
+ * Free and nonfull clusters are sharded by NUMA node. Each node owns a
+ * contiguous range of the device's clusters, which return to that node's
+ * shard when freed, and CPUs take new clusters from their own node's shard
+ * before the others. This keeps allocation and freeing on different nodes
+ * off each other's locks, and each node's swap-out within one range of the
+ * device.
+ */
+struct swap_cluster_shard {
+	spinlock_t lock;		/* protects the lists below */
+	struct list_head free_clusters;	/* free clusters list */
+	struct list_head nonfull_clusters[SWAP_NR_ORDERS];
+					/* list of cluster that contains at least one free slot */
+} ____cacheline_aligned_in_smp;
+
 /*
  * The in-memory structure used to track swap areas.
  */
@@ -254,23 +269,26 @@ struct swap_info_struct {
 	signed char	type;		/* strange name for an index */
 	unsigned int	max;		/* size of this swap device */
 	struct swap_cluster_info *cluster_info; /* cluster info. Only for SSD */
-	struct list_head free_clusters; /* free clusters list */
+	struct swap_cluster_shard *shards; /* free and nonfull clusters, per node */
+	unsigned int nr_shards;		/* number of shards, nr_node_ids */
+	unsigned int shard_clusters;	/* clusters per shard */
 	struct list_head full_clusters; /* full clusters list */
-	struct list_head nonfull_clusters[SWAP_NR_ORDERS];
-					/* list of cluster that contains at least one free slot */
 	struct list_head frag_clusters[SWAP_NR_ORDERS];
 					/* list of cluster that are fragmented or contented */
 	unsigned int pages;		/* total of usable pages of swap */
 	atomic_long_t inuse_pages;	/* number of those currently in use */
 	struct swap_sequential_cluster *global_cluster; /* Use one global cluster for rotating device */
 	spinlock_t global_cluster_lock;	/* Serialize usage of global cluster */
+	atomic_long_t nr_lock_contended; /* cluster list locks found held */
+	atomic_long_t nr_remote_alloc;	/* clusters taken from another node's shard */
 	struct rb_root swap_extent_root;/* root of the swap extent rbtree */
 	struct block_device *bdev;	/* swap device or bdev of swap file */
 	struct file *swap_file;		/* seldom referenced */
 	struct completion comp;		/* seldom referenced */
 	spinlock_t lock;		/*
 					 * protect map scan related fields like
-					 * inuse_pages and all cluster lists.
+					 * inuse_pages and the full, frag and
+					 * discard cluster lists.
 					 * Other fields are only changed
 					 * at swapon/swapoff, so are protected
 					 * by swap_lock. changing flags need
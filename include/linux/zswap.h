@@ -27,6 +27,7 @@ struct zswap_lruvec_state {
 unsigned long zswap_total_pages(void);
 bool zswap_store(struct folio *folio);
 int zswap_load(struct folio *folio);
+bool zswap_can_load_large(swp_entry_t swp, unsigned int nr_pages);
 void zswap_invalidate(swp_entry_t swp);
 int zswap_swapon(int type, unsigned long nr_pages);
 void zswap_swapoff(int type);
@@ -35,6 +36,7 @@ void zswap_lruvec_state_init(struct lruvec *lruvec);
 void zswap_folio_swapin(struct folio *folio);
 bool zswap_is_enabled(void);
 bool zswap_never_enabled(void);
+bool zswap_large_swapin_allowed(void);
 #else
 
 struct zswap_lruvec_state {};
@@ -49,6 +51,12 @@ static inline int zswap_load(struct folio *folio)
 	return -ENOENT;
 }
 
+static inline bool zswap_can_load_large(swp_entry_t swp,
+					unsigned int nr_pages)
+{
+	return true;
+}
+
 static inline void zswap_invalidate(swp_entry_t swp) {}
 static inline int zswap_swapon(int type, unsigned long nr_pages)
 {
@@ -69,6 +77,11 @@ static inline bool zswap_never_enabled(void)
 	return true;
 }
 
+static inline bool zswap_large_swapin_allowed(void)
+{
+	return true;
+}
+
 #endif
 
 #endif /* _LINUX_ZSWAP_H */
@@ -126,6 +126,75 @@ DEFINE_EVENT(page_cache_ra_op, page_cache_async_ra,
 	TP_ARGS(inode, index, ra, req_count)
 );
 
+#ifdef CONFIG_READAHEAD_PATTERNS
+TRACE_EVENT(page_cache_ra_stride,
+	TP_PROTO(struct inode *inode, pgoff_t index, struct file_ra_state *ra,
+		 bool hit),
+
+	TP_ARGS(inode, index, ra, hit),
+
+	TP_STRUCT__entry(
+		__field(u64, i_ino)
+		__field(dev_t, s_dev)
+		__field(pgoff_t, index)
+		__field(pgoff_t, stride_next)
+		__field(unsigned long, stride)
+		__field(unsigned int, stride_nr)
+		__field(unsigned int, stride_count)
+		__field(bool, hit)
+	),
+
+	TP_fast_assign(
+		__entry->i_ino = inode->i_ino;
+		__entry->s_dev = inode->i_sb->s_dev;
+		__entry->index = index;
+		__entry->stride_next = ra->stride_next;
+		__entry->stride = ra->stride;
+		__entry->stride_nr = ra->stride_nr;
+		__entry->stride_count = ra->stride_count;
+		__entry->hit = hit;
+	),
+
+	TP_printk(
+		"dev=%d:%d ino=%llx index=%lu stride=%lu stride_nr=%u stride_count=%u stride_next=%lu hit=%d",
+		MAJOR(__entry->s_dev), MINOR(__entry->s_dev), __entry->i_ino,
+		__entry->index, __entry->stride, __entry->stride_nr,
+		__entry->stride_count, __entry->stride_next, __entry->hit
+	)
+);
+
+TRACE_EVENT(page_cache_ra_stream,
+	TP_PROTO(struct inode *inode, pgoff_t index, struct file_ra_state *ra),
+
+	TP_ARGS(inode, index, ra),
+
+	TP_STRUCT__entry(
+		__field(u64, i_ino)
+		__field(dev_t, s_dev)
+		__field(pgoff_t, index)
+		__field(pgoff_t, start)
+		__field(unsigned int, size)
+		__field(unsigned int, async_size)
+	),
+
+	TP_fast_assign(
+		__entry->i_ino = inode->i_ino;
+		__entry->s_dev = inode->i_sb->s_dev;
+		__entry->index = index;
+		__entry->start = ra->start;
+		__entry->size = ra->size;
+		__entry->async_size = ra->async_size;
+	),
+
+	TP_printk(
+		"dev=%d:%d ino=%llx index=%lu start=%lu size=%u async_size=%u",
+		MAJOR(__entry->s_dev), MINOR(__entry->s_dev), __entry->i_ino,
+		__entry->index, __entry->start, __entry->size,
+		__entry->async_size
+	)
+);
+#endif /* CONFIG_READAHEAD_PATTERNS */
+
 #endif /* _TRACE_FILEMAP_H */
 
 /* This part must be outside protection */
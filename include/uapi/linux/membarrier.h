@@ -162,8 +162,37 @@ enum membarrier_cmd {
 	MEMBARRIER_CMD_SHARED			= MEMBARRIER_CMD_GLOBAL,
 };
 
+/**
+ * enum membarrier_cmd_flag - membarrier system call command flags
+ * @MEMBARRIER_CMD_FLAG_CPU:
+ *                          Only interrupt the CPU indicated by @cpu_id,
+ *                          if it runs a thread of the caller's process.
+ * @MEMBARRIER_CMD_FLAG_TID:
+ *                          Only interrupt the CPU running the thread
+ *                          whose thread ID is passed in @cpu_id, if it
+ *                          is running. The thread must belong to the
+ *                          caller's process, otherwise -EINVAL is
+ *                          returned. Not accepted by
+ *                          MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE,
+ *                          which returns -EINVAL: a thread that is not
+ *                          running may resume on another CPU running
+ *                          the process without serializing its core.
+ * @MEMBARRIER_CMD_FLAG_PIDFD:
+ *                          Like MEMBARRIER_CMD_FLAG_TID, with a pidfd
+ *                          referring to the thread passed in @cpu_id.
+ *                          Not accepted by
+ *                          MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE
+ *                          either.
+ *
+ * These flags are accepted by the private expedited commands and are
+ * mutually exclusive. For the memory barrier and rseq commands,
+ * non-running targets are de facto in the state the command would bring
+ * them to, so a targeted command only ever interrupts a single CPU.
+ */
 enum membarrier_cmd_flag {
 	MEMBARRIER_CMD_FLAG_CPU		= (1 << 0),
+	MEMBARRIER_CMD_FLAG_TID		= (1 << 1),
+	MEMBARRIER_CMD_FLAG_PIDFD	= (1 << 2),
 };
 
 #endif /* _UAPI_LINUX_MEMBARRIER_H */
@@ -416,4 +416,12 @@ struct prctl_mm_map {
 # define PR_CFI_DISABLE		_BITUL(1)
 # define PR_CFI_LOCK		_BITUL(2)
 
+/*
+ * Tear the address space down asynchronously when the last task using it
+ * exits, instead of making the exiting task free all of its memory. The
+ * setting is not inherited across fork() and is reset by execve().
+ */
+#define PR_SET_ASYNC_TEARDOWN	82
+#define PR_GET_ASYNC_TEARDOWN	83
+
 #endif /* _LINUX_PRCTL_H */
@@ -54,13 +54,16 @@
 	 (__u64)1 << _UFFDIO_MOVE |		\
 	 (__u64)1 << _UFFDIO_WRITEPROTECT |	\
 	 (__u64)1 << _UFFDIO_CONTINUE |		\
-	 (__u64)1 << _UFFDIO_POISON)
+	 (__u64)1 << _UFFDIO_POISON |		\
+	 (__u64)1 << _UFFDIO_COPY_VEC |		\
+	 (__u64)1 << _UFFDIO_MOVE_VEC)
 #define UFFD_API_RANGE_IOCTLS_BASIC		\
 	((__u64)1 << _UFFDIO_WAKE |		\
 	 (__u64)1 << _UFFDIO_COPY |		\
 	 (__u64)1 << _UFFDIO_WRITEPROTECT |	\
 	 (__u64)1 << _UFFDIO_CONTINUE |		\
-	 (__u64)1 << _UFFDIO_POISON)
+	 (__u64)1 << _UFFDIO_POISON |		\
+	 (__u64)1 << _UFFDIO_COPY_VEC)
 
 /*
  * Valid ioctl command number range with this API is from 0x00 to
@@ -79,6 +82,8 @@
 #define _UFFDIO_WRITEPROTECT		(0x06)
 #define _UFFDIO_CONTINUE		(0x07)
 #define _UFFDIO_POISON			(0x08)
+#define _UFFDIO_COPY_VEC		(0x09)
+#define _UFFDIO_MOVE_VEC		(0x0A)
 #define _UFFDIO_API			(0x3F)
 
 /* userfaultfd ioctl ids */
@@ -103,6 +108,10 @@
 				      struct uffdio_continue)
 #define UFFDIO_POISON		_IOWR(UFFDIO, _UFFDIO_POISON, \
 				      struct uffdio_poison)
+#define UFFDIO_COPY_VEC		_IOWR(UFFDIO, _UFFDIO_COPY_VEC,	\
+				      struct uffdio_copy_vec)
+#define UFFDIO_MOVE_VEC		_IOWR(UFFDIO, _UFFDIO_MOVE_VEC,	\
+				      struct uffdio_move_vec)
 
 /* read() structure */
 struct uffd_msg {
@@ -374,6 +383,51 @@ struct uffdio_move {
 	__s64 move;
 };
 
+/*
+ * One entry of the array passed to UFFDIO_COPY_VEC and UFFDIO_MOVE_VEC,
+ * with the same meaning as the dst/src/len fields of uffdio_copy and
+ * uffdio_move respectively.
+ */
+struct uffdio_vec {
+	__u64 dst;
+	__u64 src;
+	__u64 len;
+};
+
+/*
+ * UFFDIO_COPY_VEC and UFFDIO_MOVE_VEC resolve up to UFFDIO_VEC_MAX
+ * ranges in a single call.  The entries are processed in order and the
+ * ioctl stops at the first one that fails or is only partially done.
+ * The total number of bytes copied or moved is reported back in the
+ * last field, or a negative error if no byte could be processed at
+ * all; the ioctl returns 0 only if every entry was fully processed.
+ */
+#define UFFDIO_VEC_MAX		1024
+
+struct uffdio_copy_vec {
+	__u64 vec;		/* pointer to an array of struct uffdio_vec */
+	__u64 nr;		/* number of entries in the array */
+	__u64 mode;		/* UFFDIO_COPY_MODE_* */
+
+	/*
+	 * "copy" is written by the ioctl and must be at the end: the
+	 * copy_from_user will not read the last 8 bytes.
+	 */
+	__s64 copy;
+};
+
+struct uffdio_move_vec {
+	__u64 vec;		/* pointer to an array of struct uffdio_vec */
+	__u64 nr;		/* number of entries in the array */
+	__u64 mode;		/* UFFDIO_MOVE_MODE_* */
+
+	/*
+	 * "move" is written by the ioctl and must be at the end: the
+	 * copy_from_user will not read the last 8 bytes.
+	 */
+	__s64 move;
+};
+
 /*
  * Flags for the userfaultfd(2) system call itself.
  */
@@ -47,6 +47,7 @@ struct cgroup_fs_context {
 	struct cgroup_root	*root;
 	struct cgroup_namespace	*ns;
 	unsigned int	flags;			/* CGRP_ROOT_* flags */
+	unsigned int	memory_stat_staleness;	/* memory.stat staleness in msecs */
 
 	/* cgroup1 bits */
 	bool		cpuset_clone_children;
@@ -1984,6 +1984,7 @@ enum cgroup2_param {
 	Opt_memory_localevents,
 	Opt_memory_recursiveprot,
 	Opt_memory_hugetlb_accounting,
+	Opt_memory_stat_staleness,
 	Opt_pids_localevents,
 	nr__cgroup2_params
 };
@@ -1994,6 +1995,7 @@ static const struct fs_parameter_spec cgroup2_fs_parameters[] = {
 	fsparam_flag("memory_localevents",	Opt_memory_localevents),
 	fsparam_flag("memory_recursiveprot",	Opt_memory_recursiveprot),
 	fsparam_flag("memory_hugetlb_accounting", Opt_memory_hugetlb_accounting),
+	fsparam_u32("memory_stat_staleness",	Opt_memory_stat_staleness),
 	fsparam_flag("pids_localevents",	Opt_pids_localevents),
 	{}
 };
@@ -2024,6 +2026,9 @@ static int cgroup2_parse_param(struct fs_context *fc, struct fs_parameter *param
 	case Opt_memory_hugetlb_accounting:
 		ctx->flags |= CGRP_ROOT_MEMORY_HUGETLB_ACCOUNTING;
 		return 0;
+	case Opt_memory_stat_staleness:
+		ctx->memory_stat_staleness = result.uint_32;
+		return 0;
 	case Opt_pids_localevents:
 		ctx->flags |= CGRP_ROOT_PIDS_LOCAL_EVENTS;
 		return 0;
@@ -2038,7 +2043,8 @@ struct cgroup_of_peak *of_peak(struct kernfs_open_file *of)
 	return &ctx->peak;
 }
 
-static void apply_cgroup_root_flags(unsigned int root_flags)
+static void apply_cgroup_root_flags(unsigned int root_flags,
+				    unsigned int memory_stat_staleness)
 {
 	if (current->nsproxy->cgroup_ns == &init_cgroup_ns) {
 		if (root_flags & CGRP_ROOT_NS_DELEGATE)
@@ -2064,6 +2070,9 @@ static void apply_cgroup_root_flags(unsigned int root_flags)
 		else
 			cgrp_dfl_root.flags &= ~CGRP_ROOT_MEMORY_HUGETLB_ACCOUNTING;
 
+		WRITE_ONCE(cgrp_dfl_root.memory_stat_staleness,
+			   memory_stat_staleness);
+
 		if (root_flags & CGRP_ROOT_PIDS_LOCAL_EVENTS)
 			cgrp_dfl_root.flags |= CGRP_ROOT_PIDS_LOCAL_EVENTS;
 		else
@@ -2083,6 +2092,9 @@ static int cgroup_show_options(struct seq_file *seq, struct kernfs_root *kf_root
 		seq_puts(seq, ",memory_recursiveprot");
 	if (cgrp_dfl_root.flags & CGRP_ROOT_MEMORY_HUGETLB_ACCOUNTING)
 		seq_puts(seq, ",memory_hugetlb_accounting");
+	if (cgrp_dfl_root.memory_stat_staleness)
+		seq_printf(seq, ",memory_stat_staleness=%u",
+			   cgrp_dfl_root.memory_stat_staleness);
 	if (cgrp_dfl_root.flags & CGRP_ROOT_PIDS_LOCAL_EVENTS)
 		seq_puts(seq, ",pids_localevents");
 	return 0;
@@ -2092,7 +2104,7 @@ static int cgroup_reconfigure(struct fs_context *fc)
 {
 	struct cgroup_fs_context *ctx = cgroup_fc2context(fc);
 
-	apply_cgroup_root_flags(ctx->flags);
+	apply_cgroup_root_flags(ctx->flags, ctx->memory_stat_staleness);
 	return 0;
 }
 
@@ -2320,7 +2332,7 @@ static int cgroup_get_tree(struct fs_context *fc)
 
 	ret = cgroup_do_get_tree(fc);
 	if (!ret)
-		apply_cgroup_root_flags(ctx->flags);
+		apply_cgroup_root_flags(ctx->flags, ctx->memory_stat_staleness);
 	return ret;
 }
 
@@ -7499,6 +7511,7 @@ static ssize_t features_show(struct kobject *kobj, struct kobj_attribute *attr,
 			"memory_localevents\n"
 			"memory_recursiveprot\n"
 			"memory_hugetlb_accounting\n"
+			"memory_stat_staleness\n"
 			"pids_localevents\n");
 }
 static struct kobj_attribute cgroup_features_attr = __ATTR_RO(features);
@@ -1225,6 +1225,106 @@ void mmput_async(struct mm_struct *mm)
 EXPORT_SYMBOL_GPL(mmput_async);
 #endif
 
+/*
+ * An exiting task can leave the teardown of its address space to a worker,
+ * so that whoever waits for it to exit does not also wait for all of its
+ * memory to be freed. Tasks opt in with PR_SET_ASYNC_TEARDOWN, or the admin
+ * sets a resident set size above which all of them do.
+ */
+static unsigned int sysctl_exit_async_teardown_mb __read_mostly;
+static struct workqueue_struct *mm_teardown_wq __ro_after_init;
+static atomic_t nr_mm_teardowns = ATOMIC_INIT(0);
+
+static void mmput_teardown_fn(struct work_struct *work)
+{
+	struct mm_struct *mm = container_of(work, struct mm_struct,
+					    async_put_work);
+
+	__mmput(mm);
+	atomic_dec(&nr_mm_teardowns);
+}
+
+static bool mm_wants_async_teardown(struct mm_struct *mm)
+{
+	unsigned int min_mb = READ_ONCE(sysctl_exit_async_teardown_mb);
+
+	/* The OOM killer relies on its victims to free their memory */
+	if (!mm_teardown_wq || tsk_is_oom_victim(current))
+		return false;
+	if (mm_flags_test(MMF_ASYNC_TEARDOWN, mm))
+		return true;
+	return min_mb &&
+	       get_mm_rss(mm) >= (unsigned long)min_mb << (20 - PAGE_SHIFT);
+}
+
+/*
+ * Freeing is mostly spent touching struct pages and page tables, so do it on
+ * the node the exiting task was preferring, where most of its memory is
+ * expected to be.
+ */
+static int mm_teardown_node(void)
+{
+#ifdef CONFIG_NUMA_BALANCING
+	if (current->numa_preferred_nid != NUMA_NO_NODE)
+		return current->numa_preferred_nid;
+#endif
+	return numa_node_id();
+}
+
+/**
+ * mmput_exit - drop the reference of an exiting task to its mm
+ * @mm: the mm of the exiting task
+ *
+ * Like mmput(), except that a large address space, or one that asked for it,
+ * is torn down asynchronously once its last user is gone.
+ */
+void mmput_exit(struct mm_struct *mm)
+{
+	might_sleep();
+
+	if (!mm_wants_async_teardown(mm)) {
+		mmput(mm);
+		return;
+	}
+
+	if (atomic_dec_and_test(&mm->mm_users)) {
+		atomic_inc(&nr_mm_teardowns);
+		INIT_WORK(&mm->async_put_work, mmput_teardown_fn);
+		queue_work_node(mm_teardown_node(), mm_teardown_wq,
+				&mm->async_put_work);
+	}
+}
+
+/*
+ * Whether memory of exited tasks is still being freed, which the OOM killer
+ * should wait for rather than kill somebody else.
+ */
+bool mm_teardown_pending(void)
+{
+	return atomic_read(&nr_mm_teardowns);
+}
+
+static const struct ctl_table mm_teardown_sysctl_table[] = {
+	{
+		.procname	= "exit_async_teardown_mb",
+		.data		= &sysctl_exit_async_teardown_mb,
+		.maxlen		= sizeof(sysctl_exit_async_teardown_mb),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec,
+	},
+};
+
+static int __init mm_teardown_init(void)
+{
+	mm_teardown_wq = alloc_workqueue("mm_teardown",
+					 WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (!mm_teardown_wq)
+		pr_warn("mm_teardown: workqueue allocation failed\n");
+	register_sysctl_init("vm", mm_teardown_sysctl_table);
+	return 0;
+}
+subsys_initcall(mm_teardown_init);
+
 /**
  * set_mm_exe_file - change a reference to the mm's executable file
  * @mm: The mm to change.
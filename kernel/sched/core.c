@@ -4639,6 +4639,10 @@ void set_numabalancing_state(bool enabled)
 }
 
 #ifdef CONFIG_PROC_SYSCTL
+static const int numa_balancing_mode_max = NUMA_BALANCING_NORMAL |
+					   NUMA_BALANCING_MEMORY_TIERING |
+					   NUMA_BALANCING_MGLRU;
+
 static void reset_memory_tiering(void)
 {
 	struct pglist_data *pgdat;
@@ -4785,7 +4789,7 @@ static const struct ctl_table sched_core_sysctls[] = {
 		.mode		= 0644,
 		.proc_handler	= sysctl_numa_balancing,
 		.extra1		= SYSCTL_ZERO,
-		.extra2		= SYSCTL_FOUR,
+		.extra2		= (void *)&numa_balancing_mode_max,
 	},
 #endif /* CONFIG_NUMA_BALANCING */
 };
@@ -4833,6 +4837,7 @@ int sched_fork(u64 clone_flags, struct task_struct *p)
 		set_load_weight(p, false);
 		p->se.custom_slice = 0;
 		p->se.slice = sysctl_sched_base_slice;
+		p->latency_prio = DEFAULT_LATENCY_PRIO;
 
 		/*
 		 * We don't need the reset flag anymore after the fork. It has
@@ -8933,6 +8938,7 @@ void __init sched_init(void)
 	root_task_group.cfs_rq = &runqueues.cfs;
 
 	root_task_group.shares = ROOT_TASK_GROUP_LOAD;
+	root_task_group.latency_prio = DEFAULT_LATENCY_PRIO;
 	init_cfs_bandwidth(&root_task_group.cfs_bandwidth, NULL);
 #endif /* CONFIG_FAIR_GROUP_SCHED */
 #ifdef CONFIG_EXT_GROUP_SCHED
@@ -10231,6 +10237,23 @@ static int cpu_idle_write_s64(struct cgroup_subsys_state *css,
 }
 #endif /* CONFIG_GROUP_SCHED_WEIGHT */
 
+#ifdef CONFIG_FAIR_GROUP_SCHED
+static s64 cpu_latency_nice_read_s64(struct cgroup_subsys_state *css,
+				     struct cftype *cft)
+{
+	return LATENCY_TO_NICE(READ_ONCE(css_tg(css)->latency_prio));
+}
+
+static int cpu_latency_nice_write_s64(struct cgroup_subsys_state *css,
+				      struct cftype *cft, s64 nice)
+{
+	if (nice < MIN_LATENCY_NICE || nice > MAX_LATENCY_NICE)
+		return -ERANGE;
+
+	return sched_group_set_latency(css_tg(css), NICE_TO_LATENCY(nice));
+}
+#endif /* CONFIG_FAIR_GROUP_SCHED */
+
 static struct cftype cpu_legacy_files[] = {
 #ifdef CONFIG_GROUP_SCHED_WEIGHT
 	{
@@ -10244,6 +10267,13 @@ static struct cftype cpu_legacy_files[] = {
 		.write_s64 = cpu_idle_write_s64,
 	},
 #endif
+#ifdef CONFIG_FAIR_GROUP_SCHED
+	{
+		.name = "latency.nice",
+		.read_s64 = cpu_latency_nice_read_s64,
+		.write_s64 = cpu_latency_nice_write_s64,
+	},
+#endif
 #ifdef CONFIG_GROUP_SCHED_BANDWIDTH
 	{
 		.name = "cfs_period_us",
@@ -10522,6 +10552,14 @@ static struct cftype cpu_files[] = {
 		.write_s64 = cpu_idle_write_s64,
 	},
 #endif
+#ifdef CONFIG_FAIR_GROUP_SCHED
+	{
+		.name = "latency.nice",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_s64 = cpu_latency_nice_read_s64,
+		.write_s64 = cpu_latency_nice_write_s64,
+	},
+#endif
 #ifdef CONFIG_GROUP_SCHED_BANDWIDTH
 	{
 		.name = "max",
@@ -1422,6 +1422,7 @@ void proc_sched_show_task(struct task_struct *p, struct pid_namespace *ns,
 		P(dl.deadline);
 	} else if (fair_policy(p->policy)) {
 		P(se.slice);
+		__PS("latency_nice", LATENCY_TO_NICE(p->latency_prio));
 	}
 #ifdef CONFIG_SCHED_CLASS_EXT
 	__PS("ext.enabled", task_on_scx(p));
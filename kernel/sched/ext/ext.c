@@ -1498,6 +1498,112 @@ static void local_dsq_post_enq(struct scx_sched *sch, struct scx_dispatch_q *dsq
 	}
 }
 
+/*
+ * @dsq->pending is set to this once lockless insertions are no longer allowed,
+ * i.e. when @dsq is being destroyed. See destroy_dsq().
+ */
+#define SCX_DSQ_PENDING_CLOSED	((struct llist_node *)1UL)
+
+static bool dsq_has_pending(struct scx_dispatch_q *dsq)
+{
+	struct llist_node *first = READ_ONCE(dsq->pending.first);
+
+	return first && first != SCX_DSQ_PENDING_CLOSED;
+}
+
+/*
+ * Move the tasks on @first, detached from @dsq->pending, to the tail of @dsq in
+ * the order they were inserted.
+ */
+static void dsq_splice_pending(struct scx_dispatch_q *dsq,
+			       struct llist_node *first)
+{
+	struct task_struct *p;
+	u32 nr = 0;
+
+	lockdep_assert_held(&dsq->lock);
+
+	if (!first || first == SCX_DSQ_PENDING_CLOSED)
+		return;
+
+	if (unlikely(!RB_EMPTY_ROOT(&dsq->priq)))
+		scx_error(dsq->sched, "DSQ ID 0x%016llx already had PRIQ-enqueued tasks",
+			  dsq->id);
+
+	llist_for_each_entry(p, llist_reverse_order(first), scx.dsq_pending) {
+		list_add_tail(&p->scx.dsq_list.node, &dsq->list);
+		if (!dsq->first_task)
+			rcu_assign_pointer(dsq->first_task, p);
+
+		WRITE_ONCE(dsq->seq, dsq->seq + 1);
+		p->scx.dsq_seq = dsq->seq;
+		nr++;
+	}
+
+	/* see dsq_inc_nr() */
+	WRITE_ONCE(dsq->nr, dsq->nr + nr);
+}
+
+/*
+ * Make the lockless insertions into @dsq visible on @dsq->list. Must be called
+ * after locking a user DSQ before looking at or changing its tasks.
+ */
+static void dsq_flush_pending(struct scx_dispatch_q *dsq)
+{
+	lockdep_assert_held(&dsq->lock);
+
+	/* only lock holders detach entries, so it can't have emptied since */
+	if (dsq_has_pending(dsq))
+		dsq_splice_pending(dsq, xchg(&dsq->pending.first, NULL));
+}
+
+/*
+ * Best-effort flush for the kfuncs which don't otherwise lock @dsq and may be
+ * called with it held, e.g. from ops.dequeue() while tasks are being consumed.
+ */
+static void dsq_try_flush_pending(struct scx_dispatch_q *dsq)
+{
+	unsigned long flags;
+
+	if (!dsq_has_pending(dsq))
+		return;
+
+	if (raw_spin_trylock_irqsave(&dsq->lock, flags)) {
+		dsq_flush_pending(dsq);
+		raw_spin_unlock_irqrestore(&dsq->lock, flags);
+	}
+}
+
+/*
+ * Insert @p at the tail of @dsq without taking @dsq->lock. @p's fields are set
+ * up before it becomes reachable through @dsq->pending. As with the locked
+ * path, @p can't be dequeued before this returns as either its rq is locked or
+ * its ops_state is still %SCX_OPSS_QUEUEING or %SCX_OPSS_DISPATCHING.
+ *
+ * Returns %false if @dsq no longer takes lockless insertions, in which case the
+ * caller should take the locked path.
+ */
+static bool dispatch_enqueue_lockless(struct scx_dispatch_q *dsq,
+				      struct task_struct *p)
+{
+	struct llist_node *first = READ_ONCE(dsq->pending.first);
+	u32 custody = p->scx.flags & SCX_TASK_IN_CUSTODY;
+
+	p->scx.dsq = dsq;
+	p->scx.flags |= SCX_TASK_IN_CUSTODY;
+
+	do {
+		if (unlikely(first == SCX_DSQ_PENDING_CLOSED)) {
+			p->scx.dsq = NULL;
+			p->scx.flags = (p->scx.flags & ~SCX_TASK_IN_CUSTODY) | custody;
+			return false;
+		}
+		p->scx.dsq_pending.next = first;
+	} while (!try_cmpxchg(&dsq->pending.first, &first, &p->scx.dsq_pending));
+
+	return true;
+}
+
 static void dispatch_enqueue(struct scx_sched *sch, struct rq *rq,
 			     struct scx_dispatch_q *dsq, struct task_struct *p,
 			     u64 enq_flags)
@@ -1508,6 +1614,11 @@ static void dispatch_enqueue(struct scx_sched *sch, struct rq *rq,
 	WARN_ON_ONCE((p->scx.dsq_flags & SCX_TASK_DSQ_ON_PRIQ) ||
 		     !RB_EMPTY_NODE(&p->scx.dsq_priq));
 
+	if ((dsq->flags & SCX_CREATE_DSQ_LOCKLESS_ENQ) &&
+	    !(enq_flags & (SCX_ENQ_HEAD | SCX_ENQ_PREEMPT | SCX_ENQ_DSQ_PRIQ)) &&
+	    dispatch_enqueue_lockless(dsq, p))
+		goto out_clear_opss;
+
 	if (!is_local) {
 		raw_spin_lock_nested(&dsq->lock,
 			(enq_flags & SCX_ENQ_NESTED) ? SINGLE_DEPTH_NESTING : 0);
@@ -1519,6 +1630,9 @@ static void dispatch_enqueue(struct scx_sched *sch, struct rq *rq,
 			dsq = find_global_dsq(sch, task_cpu(p));
 			raw_spin_lock(&dsq->lock);
 		}
+
+		/* keep the insertion order with the lockless ones */
+		dsq_flush_pending(dsq);
 	}
 
 	if (unlikely((dsq->id & SCX_DSQ_FLAG_BUILTIN) &&
@@ -1618,6 +1732,7 @@ static void dispatch_enqueue(struct scx_sched *sch, struct rq *rq,
 		raw_spin_unlock(&dsq->lock);
 	}
 
+out_clear_opss:
 	/*
 	 * We're transitioning out of QUEUEING or DISPATCHING. store_release to
 	 * match waiters' load_acquire.
@@ -1675,8 +1790,10 @@ static void dispatch_dequeue(struct rq *rq, struct task_struct *p)
 		return;
 	}
 
-	if (!is_local)
+	if (!is_local) {
 		raw_spin_lock(&dsq->lock);
+		dsq_flush_pending(dsq);
+	}
 
 	/*
 	 * Now that we hold @dsq->lock, @p->holding_cpu and @p->scx.dsq_* can't
@@ -2492,22 +2609,31 @@ static struct rq *move_task_between_dsqs(struct scx_sched *sch,
 	return dst_rq;
 }
 
-static bool consume_dispatch_q(struct scx_sched *sch, struct rq *rq,
-			       struct scx_dispatch_q *dsq, u64 enq_flags)
+/*
+ * Move up to @nr tasks from @dsq to @rq's local DSQ in dispatch order. Tasks
+ * which are already on @rq are moved under a single @dsq->lock hold. Migrating a
+ * remote task drops the lock and restarts the scan. Returns the number of tasks
+ * moved.
+ */
+static u32 consume_dispatch_q_nr(struct scx_sched *sch, struct rq *rq,
+				 struct scx_dispatch_q *dsq, u64 enq_flags,
+				 u32 nr)
 {
-	struct task_struct *p;
+	struct task_struct *p, *next;
+	u32 moved = 0;
 retry:
 	/*
 	 * The caller can't expect to successfully consume a task if the task's
 	 * addition to @dsq isn't guaranteed to be visible somehow. Test
 	 * @dsq->list without locking and skip if it seems empty.
 	 */
-	if (list_empty(&dsq->list))
-		return false;
+	if (list_empty(&dsq->list) && !dsq_has_pending(dsq))
+		return moved;
 
 	raw_spin_lock(&dsq->lock);
+	dsq_flush_pending(dsq);
 
-	nldsq_for_each_task(p, dsq) {
+	for (p = nldsq_next_task(dsq, NULL, false); p; p = next) {
 		struct rq *task_rq = task_rq(p);
 
 		/*
@@ -2521,22 +2647,32 @@ static bool consume_dispatch_q(struct scx_sched *sch, struct rq *rq,
 		if (unlikely(READ_ONCE(sch->aborting)) && dsq->id != SCX_DSQ_BYPASS)
 			break;
 
+		next = nldsq_next_task(dsq, p, false);
+
 		if (rq == task_rq) {
 			task_unlink_from_dsq(p, dsq);
 			move_local_task_to_local_dsq(sch, p, enq_flags, dsq, rq);
-			raw_spin_unlock(&dsq->lock);
-			return true;
+			if (++moved == nr)
+				break;
+			continue;
 		}
 
 		if (task_can_run_on_remote_rq(sch, p, rq, false)) {
-			if (likely(consume_remote_task(rq, p, enq_flags, dsq, task_rq)))
-				return true;
+			if (likely(consume_remote_task(rq, p, enq_flags, dsq, task_rq)) &&
+			    ++moved == nr)
+				return moved;
 			goto retry;
 		}
 	}
 
 	raw_spin_unlock(&dsq->lock);
-	return false;
+	return moved;
+}
+
+static bool consume_dispatch_q(struct scx_sched *sch, struct rq *rq,
+			       struct scx_dispatch_q *dsq, u64 enq_flags)
+{
+	return consume_dispatch_q_nr(sch, rq, dsq, enq_flags, 1);
 }
 
 static bool consume_global_dsq(struct scx_sched *sch, struct rq *rq)
@@ -4180,13 +4316,15 @@ static void reenq_user(struct rq *rq, struct scx_dispatch_q *dsq, u64 reenq_flag
 {
 	struct rq *locked_rq = rq;
 	struct scx_sched *sch = dsq->sched;
-	struct scx_dsq_list_node cursor = INIT_DSQ_LIST_CURSOR(cursor, dsq, 0);
+	struct scx_dsq_list_node cursor;
 	struct task_struct *p;
 	s32 nr_enqueued = 0;
 
 	lockdep_assert_rq_held(rq);
 
 	raw_spin_lock(&dsq->lock);
+	dsq_flush_pending(dsq);
+	cursor = INIT_DSQ_LIST_CURSOR(cursor, dsq, 0);
 
 	while (likely(!READ_ONCE(sch->bypass_depth))) {
 		struct rq *task_rq;
@@ -4679,6 +4817,14 @@ static void destroy_dsq(struct scx_sched *sch, u64 dsq_id)
 
 	raw_spin_lock_irqsave(&dsq->lock, flags);
 
+	/*
+	 * Close @dsq->pending so that any further insertion takes the locked
+	 * path below, which either sees the tasks or the invalidated ->id.
+	 */
+	if (dsq->flags & SCX_CREATE_DSQ_LOCKLESS_ENQ)
+		dsq_splice_pending(dsq, xchg(&dsq->pending.first,
+					     SCX_DSQ_PENDING_CLOSED));
+
 	if (dsq->nr) {
 		scx_error(sch, "attempting to destroy in-use dsq 0x%016llx (nr=%u)",
 			  dsq->id, dsq->nr);
@@ -8964,6 +9110,53 @@ __bpf_kfunc bool scx_bpf_dsq_move_to_local(u64 dsq_id, const struct bpf_prog_aux
 	return scx_bpf_dsq_move_to_local___v2(dsq_id, 0, aux);
 }
 
+/**
+ * scx_bpf_dsq_move_to_local_nr - move tasks from a DSQ to the current CPU's local DSQ
+ * @dsq_id: DSQ to move tasks from. Must be a user-created DSQ
+ * @nr: maximum number of tasks to move
+ * @enq_flags: %SCX_ENQ_*
+ * @aux: implicit BPF argument to access bpf_prog_aux hidden from BPF progs
+ *
+ * Batched scx_bpf_dsq_move_to_local(). Move up to @nr tasks from the DSQ
+ * identified by @dsq_id to the current CPU's local DSQ in dispatch order.
+ * Consecutive tasks which are already on the current CPU are moved while
+ * holding the DSQ lock once. Can only be called from ops.dispatch().
+ *
+ * Returns the number of tasks moved.
+ */
+__bpf_kfunc u32 scx_bpf_dsq_move_to_local_nr(u64 dsq_id, u32 nr, u64 enq_flags,
+					     const struct bpf_prog_aux *aux)
+{
+	struct scx_dispatch_q *dsq;
+	struct scx_sched *sch;
+	struct scx_dsp_ctx *dspc;
+	u32 moved;
+
+	guard(rcu)();
+
+	sch = scx_prog_sched(aux);
+	if (unlikely(!sch || !nr))
+		return 0;
+
+	if (!scx_vet_enq_flags(sch, SCX_DSQ_LOCAL, &enq_flags))
+		return 0;
+
+	dspc = &this_cpu_ptr(sch->pcpu)->dsp_ctx;
+
+	flush_dispatch_buf(sch, dspc->rq);
+
+	dsq = find_user_dsq(sch, dsq_id);
+	if (unlikely(!dsq)) {
+		scx_error(sch, "invalid DSQ ID 0x%016llx", dsq_id);
+		return 0;
+	}
+
+	/* see scx_bpf_dsq_move_to_local___v2() */
+	moved = consume_dispatch_q_nr(sch, dspc->rq, dsq, enq_flags, nr);
+	dspc->nr_tasks += moved;
+	return moved;
+}
+
 /**
  * scx_bpf_dsq_move_set_slice - Override slice when moving between DSQs
  * @it__iter: DSQ iterator in progress
@@ -9105,6 +9298,7 @@ BTF_ID_FLAGS(func, scx_bpf_dispatch_nr_slots, KF_IMPLICIT_ARGS)
 BTF_ID_FLAGS(func, scx_bpf_dispatch_cancel, KF_IMPLICIT_ARGS)
 BTF_ID_FLAGS(func, scx_bpf_dsq_move_to_local, KF_IMPLICIT_ARGS)
 BTF_ID_FLAGS(func, scx_bpf_dsq_move_to_local___v2, KF_IMPLICIT_ARGS)
+BTF_ID_FLAGS(func, scx_bpf_dsq_move_to_local_nr, KF_IMPLICIT_ARGS)
 /* scx_bpf_dsq_move*() also in scx_kfunc_ids_unlocked: callable from unlocked contexts */
 BTF_ID_FLAGS(func, scx_bpf_dsq_move_set_slice, KF_RCU)
 BTF_ID_FLAGS(func, scx_bpf_dsq_move_set_vtime, KF_RCU)
@@ -9165,12 +9359,14 @@ __bpf_kfunc_start_defs();
  * scx_bpf_create_dsq - Create a custom DSQ
  * @dsq_id: DSQ to create
  * @node: NUMA node to allocate from
+ * @flags: %SCX_CREATE_DSQ_*
  * @aux: implicit BPF argument to access bpf_prog_aux hidden from BPF progs
  *
  * Create a custom DSQ identified by @dsq_id. Can be called from any sleepable
  * scx callback, and any BPF_PROG_TYPE_SYSCALL prog.
  */
-__bpf_kfunc s32 scx_bpf_create_dsq(u64 dsq_id, s32 node, const struct bpf_prog_aux *aux)
+__bpf_kfunc s32 scx_bpf_create_dsq___v2(u64 dsq_id, s32 node, u64 flags,
+					const struct bpf_prog_aux *aux)
 {
 	struct scx_dispatch_q *dsq;
 	struct scx_sched *sch;
@@ -9183,6 +9379,9 @@ __bpf_kfunc s32 scx_bpf_create_dsq(u64 dsq_id, s32 node, const struct bpf_prog_a
 	if (unlikely(dsq_id & SCX_DSQ_FLAG_BUILTIN))
 		return -EINVAL;
 
+	if (unlikely(flags & ~__SCX_CREATE_DSQ_ALL_FLAGS))
+		return -EINVAL;
+
 	dsq = kmalloc_node(sizeof(*dsq), GFP_KERNEL, node);
 	if (!dsq)
 		return -ENOMEM;
@@ -9196,6 +9395,7 @@ __bpf_kfunc s32 scx_bpf_create_dsq(u64 dsq_id, s32 node, const struct bpf_prog_a
 		kfree(dsq);
 		return ret;
 	}
+	dsq->flags = flags;
 
 	rcu_read_lock();
 
@@ -9216,10 +9416,19 @@ __bpf_kfunc s32 scx_bpf_create_dsq(u64 dsq_id, s32 node, const struct bpf_prog_a
 	return ret;
 }
 
+/*
+ * COMPAT: ___v2 was introduced in v7.2. Remove this and ___v2 tag in the future.
+ */
+__bpf_kfunc s32 scx_bpf_create_dsq(u64 dsq_id, s32 node, const struct bpf_prog_aux *aux)
+{
+	return scx_bpf_create_dsq___v2(dsq_id, node, 0, aux);
+}
+
 __bpf_kfunc_end_defs();
 
 BTF_KFUNCS_START(scx_kfunc_ids_unlocked)
 BTF_ID_FLAGS(func, scx_bpf_create_dsq, KF_IMPLICIT_ARGS | KF_SLEEPABLE)
+BTF_ID_FLAGS(func, scx_bpf_create_dsq___v2, KF_IMPLICIT_ARGS | KF_SLEEPABLE)
 /* also in scx_kfunc_ids_dispatch: also callable from ops.dispatch() */
 BTF_ID_FLAGS(func, scx_bpf_dsq_move_set_slice, KF_RCU)
 BTF_ID_FLAGS(func, scx_bpf_dsq_move_set_vtime, KF_RCU)
@@ -9416,6 +9625,7 @@ __bpf_kfunc s32 scx_bpf_dsq_nr_queued(u64 dsq_id, const struct bpf_prog_aux *aux
 	} else {
 		dsq = find_user_dsq(sch, dsq_id);
 		if (dsq) {
+			dsq_try_flush_pending(dsq);
 			ret = READ_ONCE(dsq->nr);
 			goto out;
 		}
@@ -9455,7 +9665,9 @@ __bpf_kfunc void scx_bpf_destroy_dsq(u64 dsq_id, const struct bpf_prog_aux *aux)
  *
  * Initialize BPF iterator @it which can be used with bpf_for_each() to walk
  * tasks in the DSQ specified by @dsq_id. Iteration using @it only includes
- * tasks which are already queued when this function is invoked.
+ * tasks which are already queued when this function is invoked. Lockless
+ * insertions which haven't been flushed into the DSQ yet may be missed, e.g.
+ * when called from ops.dequeue() with the DSQ locked.
  */
 __bpf_kfunc int bpf_iter_scx_dsq_new(struct bpf_iter_scx_dsq *it, u64 dsq_id,
 				     u64 flags, const struct bpf_prog_aux *aux)
@@ -9487,6 +9699,7 @@ __bpf_kfunc int bpf_iter_scx_dsq_new(struct bpf_iter_scx_dsq *it, u64 dsq_id,
 	if (!kit->dsq)
 		return -ENOENT;
 
+	dsq_try_flush_pending(kit->dsq);
 	kit->cursor = INIT_DSQ_LIST_CURSOR(kit->cursor, kit->dsq, flags);
 
 	return 0;
@@ -9566,6 +9779,10 @@ __bpf_kfunc struct task_struct *scx_bpf_dsq_peek(u64 dsq_id,
 		return NULL;
 	}
 
+	/* lockless insertions only become the first task once flushed */
+	if (!rcu_access_pointer(dsq->first_task))
+		dsq_try_flush_pending(dsq);
+
 	return rcu_dereference(dsq->first_task);
 }
 
@@ -1340,6 +1340,19 @@ enum scx_reenq_flags {
 	__SCX_REENQ_TSR_MASK	= 0xfLLU << 32,
 };
 
+enum scx_create_dsq_flags {
+	/*
+	 * Tail insertions, i.e. without %SCX_ENQ_HEAD, %SCX_ENQ_PREEMPT or vtime
+	 * ordering, don't take the DSQ lock. They are pushed onto a lockless
+	 * list which is spliced into the DSQ by whoever next takes the lock to
+	 * consume, iterate or count tasks. Useful for DSQs shared by many CPUs
+	 * that insert at high rates, e.g. per-LLC DSQs.
+	 */
+	SCX_CREATE_DSQ_LOCKLESS_ENQ	= 1LLU << 0,
+
+	__SCX_CREATE_DSQ_ALL_FLAGS	= SCX_CREATE_DSQ_LOCKLESS_ENQ,
+};
+
 enum scx_pick_idle_cpu_flags {
 	SCX_PICK_IDLE_CORE	= 1LLU << 0,	/* pick a CPU whose SMT siblings are also idle */
 	SCX_PICK_IDLE_IN_NODE	= 1LLU << 1,	/* pick a CPU in the same target NUMA node */
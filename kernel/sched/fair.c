@@ -1231,6 +1231,54 @@ int sched_update_scaling(void)
 
 static void clear_buddies(struct cfs_rq *cfs_rq, struct sched_entity *se);
 
+/*
+ * The request size that a latency nice asks for: the base slice divided by
+ * the weight of the same nice value relative to nice 0, so that negative
+ * latency nice gets shorter slices, hence earlier deadlines on wakeup and
+ * PREEMPT_SHORT, and positive latency nice longer ones. Clamped like a
+ * custom slice.
+ */
+static u64 latency_slice(int latency_prio)
+{
+	u64 slice = sysctl_sched_base_slice;
+
+	if (latency_prio == DEFAULT_LATENCY_PRIO)
+		return slice;
+
+	slice = div_u64(slice << SCHED_FIXEDPOINT_SHIFT,
+			sched_prio_to_weight[latency_prio]);
+	return clamp_t(u64, slice, NSEC_PER_MSEC/10, NSEC_PER_MSEC*100);
+}
+
+/* The slice of an entity without a custom slice */
+static inline u64 entity_base_slice(struct sched_entity *se)
+{
+	if (entity_is_task(se))
+		return latency_slice(task_of(se)->latency_prio);
+	return sysctl_sched_base_slice;
+}
+
+/*
+ * A group entity asks for the shortest slice queued below it, so that the
+ * group can service its entities in the desired time-frame, unless its task
+ * group has a latency nice, which then sets its slice like for a task.
+ */
+static inline u64 group_entity_slice(struct sched_entity *se, u64 slice)
+{
+#ifdef CONFIG_FAIR_GROUP_SCHED
+	struct cfs_rq *gcfs_rq = group_cfs_rq(se);
+	int latency_prio;
+
+	if (!gcfs_rq)
+		return slice;
+
+	latency_prio = READ_ONCE(gcfs_rq->tg->latency_prio);
+	if (latency_prio != DEFAULT_LATENCY_PRIO)
+		return latency_slice(latency_prio);
+#endif
+	return slice;
+}
+
 /*
  * XXX: strictly: vd_i += N*r_i/w_i such that: vd_i > ve_i
  * this is probably good enough.
@@ -1243,10 +1291,10 @@ static bool update_deadline(struct cfs_rq *cfs_rq, struct sched_entity *se)
 	/*
 	 * For EEVDF the virtual time slope is determined by w_i (iow.
 	 * nice) while the request time r_i is determined by
-	 * sysctl_sched_base_slice.
+	 * sysctl_sched_base_slice and latency nice.
 	 */
 	if (!se->custom_slice)
-		se->slice = sysctl_sched_base_slice;
+		se->slice = entity_base_slice(se);
 
 	/*
 	 * EEVDF: vd_i = ve_i + r_i / w_i
@@ -4340,6 +4388,8 @@ void init_numa_balancing(u64 clone_flags, struct task_struct *p)
 		if (mm_users == 1) {
 			mm->numa_next_scan = jiffies + msecs_to_jiffies(sysctl_numa_balancing_scan_delay);
 			mm->numa_scan_seq = 0;
+			mm->numa_access_nid = NUMA_NO_NODE;
+			mm->numa_access_votes = 0;
 		}
 	}
 	p->node_stamp			= 0;
@@ -4377,6 +4427,36 @@ void init_numa_balancing(u64 clone_flags, struct task_struct *p)
 	}
 }
 
+#define NUMA_ACCESS_VOTES_MAX	16
+
+/*
+ * Vote for the node current runs on as the one its mm should live on. This is a
+ * Boyer-Moore majority vote, so a node most threads of the mm run on wins in
+ * the end, and the votes are capped so that the steady state doesn't keep
+ * writing the shared mm. The updates race with other threads, which is fine
+ * since the result is only a hint for the MGLRU mm walk.
+ */
+static void task_numa_access_vote(void)
+{
+	struct mm_struct *mm = current->mm;
+	int nid = numa_node_id();
+	int votes = READ_ONCE(mm->numa_access_votes);
+
+	/* Don't move memory against the policy or the cpuset of the task */
+	if (current->mempolicy || !node_isset(nid, cpuset_current_mems_allowed))
+		return;
+
+	if (READ_ONCE(mm->numa_access_nid) == nid) {
+		if (votes < NUMA_ACCESS_VOTES_MAX)
+			WRITE_ONCE(mm->numa_access_votes, votes + 1);
+	} else if (!votes) {
+		WRITE_ONCE(mm->numa_access_nid, nid);
+		WRITE_ONCE(mm->numa_access_votes, 1);
+	} else {
+		WRITE_ONCE(mm->numa_access_votes, votes - 1);
+	}
+}
+
 /*
  * Drive the periodic memory faults..
  */
@@ -4388,7 +4468,19 @@ static void task_tick_numa(struct rq *rq, struct task_struct *curr)
 	/*
 	 * We don't care about NUMA placement if we don't have memory.
 	 */
-	if (!curr->mm || (curr->flags & (PF_EXITING | PF_KTHREAD)) || work->next != work)
+	if (!curr->mm || (curr->flags & (PF_EXITING | PF_KTHREAD)))
+		return;
+
+	/*
+	 * The MGLRU mm walk finds the accessed folios instead of hinting
+	 * faults, so all that is needed from the task is where it runs.
+	 */
+	if (sysctl_numa_balancing_mode & NUMA_BALANCING_MGLRU) {
+		task_numa_access_vote();
+		return;
+	}
+
+	if (work->next != work)
 		return;
 
 	/*
@@ -5960,7 +6052,7 @@ void __setparam_fair(struct task_struct *p, const struct sched_attr *attr)
 				      NSEC_PER_MSEC*100); /* HZ=100  / 10 */
 	} else {
 		se->custom_slice = 0;
-		se->slice = sysctl_sched_base_slice;
+		se->slice = latency_slice(p->latency_prio);
 	}
 }
 
@@ -5972,7 +6064,7 @@ place_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	s64 lag = 0;
 
 	if (!se->custom_slice)
-		se->slice = sysctl_sched_base_slice;
+		se->slice = entity_base_slice(se);
 	vslice = calc_delta_fair(se->slice, se);
 
 	/*
@@ -7851,7 +7943,7 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 		 * its entities in the desired time-frame.
 		 */
 		if (slice) {
-			se->slice = slice;
+			se->slice = group_entity_slice(se, slice);
 			se->custom_slice = 1;
 		}
 		enqueue_entity(cfs_rq, se, flags);
@@ -7874,7 +7966,7 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 		se_update_runnable(se);
 		update_cfs_group(se);
 
-		se->slice = slice;
+		se->slice = group_entity_slice(se, slice);
 		if (se != cfs_rq->curr)
 			min_vruntime_cb_propagate(&se->run_node, NULL);
 		slice = cfs_rq_min_slice(cfs_rq);
@@ -7991,7 +8083,7 @@ static int dequeue_entities(struct rq *rq, struct sched_entity *se, int flags)
 		se_update_runnable(se);
 		update_cfs_group(se);
 
-		se->slice = slice;
+		se->slice = group_entity_slice(se, slice);
 		if (se != cfs_rq->curr)
 			min_vruntime_cb_propagate(&se->run_node, NULL);
 		slice = cfs_rq_min_slice(cfs_rq);
@@ -11786,6 +11878,93 @@ static bool update_llc_busiest(struct lb_env *env,
 }
 #endif
 
+/*
+ * Summing the CPU statistics of every group costs load balancing in NUMA
+ * domains of large machines a scan of all their CPUs, which newly idle
+ * balancing does when the CPU should be picking work. So the sums of the
+ * other groups than the local one are cached in their shared
+ * sched_group_capacity, and reused by all CPUs balancing within the same
+ * jiffy. An enqueue or dequeue marks the sums of the groups its CPU sees
+ * itself in stale; see sched_balance_stats_invalidate() for why the sums
+ * of other groups may lag by up to the rest of the jiffy. The local group
+ * is always summed, it is the one the CPU knows best.
+ */
+static bool sg_lb_stats_cacheable(struct lb_env *env, struct sched_group *group)
+{
+	if (!sched_feat(LB_STATS_CACHE))
+		return false;
+
+	if (!(env->sd->flags & SD_NUMA) ||
+	    (env->sd->flags & SD_ASYM_CPUCAPACITY))
+		return false;
+
+#ifdef CONFIG_SCHED_CACHE
+	/* nr_pref_dst_llc depends on the balancing CPU */
+	if (sched_cache_enabled())
+		return false;
+#endif
+
+	return cpumask_subset(sched_group_span(group), env->cpus);
+}
+
+static bool sg_lb_stats_cached(struct sched_group *group,
+			       struct sg_lb_stats *sgs,
+			       struct sched_group_lb_cache *lbc)
+{
+	struct sched_group_capacity *sgc = group->sgc;
+	unsigned int seq;
+
+	if (READ_ONCE(sgc->lb_stale))
+		return false;
+
+	seq = read_seqcount_begin(&sgc->lb_seq);
+	*lbc = sgc->lb_cache;
+	if (read_seqcount_retry(&sgc->lb_seq, seq) || lbc->stamp != jiffies)
+		return false;
+
+	sgs->group_load = lbc->load;
+	sgs->group_util = lbc->util;
+	sgs->group_runnable = lbc->runnable;
+	sgs->sum_nr_running = lbc->nr_running;
+	sgs->sum_h_nr_running = lbc->h_nr_running;
+	sgs->idle_cpus = lbc->idle_cpus;
+	sgs->group_overutilized = lbc->overutilized;
+#ifdef CONFIG_NUMA_BALANCING
+	sgs->nr_numa_running = lbc->nr_numa_running;
+	sgs->nr_preferred_running = lbc->nr_preferred_running;
+#endif
+	return true;
+}
+
+static void sg_lb_stats_cache(struct sched_group *group,
+			      struct sg_lb_stats *sgs,
+			      struct sched_group_lb_cache *lbc)
+{
+	struct sched_group_capacity *sgc = group->sgc;
+
+	/* Somebody else is storing sums at least as recent */
+	if (!raw_spin_trylock(&sgc->lb_lock))
+		return;
+
+	lbc->stamp = jiffies;
+	lbc->load = sgs->group_load;
+	lbc->util = sgs->group_util;
+	lbc->runnable = sgs->group_runnable;
+	lbc->nr_running = sgs->sum_nr_running;
+	lbc->h_nr_running = sgs->sum_h_nr_running;
+	lbc->idle_cpus = sgs->idle_cpus;
+	lbc->overutilized = sgs->group_overutilized;
+#ifdef CONFIG_NUMA_BALANCING
+	lbc->nr_numa_running = sgs->nr_numa_running;
+	lbc->nr_preferred_running = sgs->nr_preferred_running;
+#endif
+
+	write_seqcount_begin(&sgc->lb_seq);
+	sgc->lb_cache = *lbc;
+	write_seqcount_end(&sgc->lb_seq);
+	raw_spin_unlock(&sgc->lb_lock);
+}
+
 /**
  * update_sg_lb_stats - Update sched_group's statistics for load balancing.
  * @env: The load balancing environment.
@@ -11802,15 +11981,31 @@ static inline void update_sg_lb_stats(struct lb_env *env,
 {
 	int i, nr_running, local_group, sd_flags = env->sd->flags;
 	bool balancing_at_rd = !env->sd->parent;
+	struct sched_group_lb_cache lbc = { };
+	bool cacheable = false;
 
 	memset(sgs, 0, sizeof(*sgs));
 
 	local_group = group == sds->local;
 
+	if (!local_group && sg_lb_stats_cacheable(env, group)) {
+		if (sg_lb_stats_cached(group, sgs, &lbc)) {
+			schedstat_inc(env->sd->lb_groups_cached[env->idle]);
+			goto summed;
+		}
+
+		/* Enqueues and dequeues from now on make what we sum stale */
+		cacheable = true;
+		WRITE_ONCE(group->sgc->lb_stale, 0);
+		smp_mb();
+	}
+
 	for_each_cpu_and(i, sched_group_span(group), env->cpus) {
 		struct rq *rq = cpu_rq(i);
 		unsigned long load = cpu_load(rq);
 
+		schedstat_inc(env->sd->lb_cpus_scanned[env->idle]);
+
 		sgs->group_load += load;
 		sgs->group_util += cpu_util_cfs(i);
 		sgs->group_runnable += cpu_runnable(rq);
@@ -11845,9 +12040,8 @@ static inline void update_sg_lb_stats(struct lb_env *env,
 			continue;
 		}
 
-		/* Overload indicator is only updated at root domain */
-		if (balancing_at_rd && nr_running > 1)
-			*sg_overloaded = 1;
+		if (nr_running > 1)
+			lbc.overloaded = true;
 
 #ifdef CONFIG_NUMA_BALANCING
 		/* Only fbq_classify_group() uses this to classify NUMA groups */
@@ -11865,13 +12059,25 @@ static inline void update_sg_lb_stats(struct lb_env *env,
 				sgs->group_misfit_task_load = rq->misfit_task_load;
 				*sg_overloaded = 1;
 			}
-		} else if (env->idle && sched_reduced_capacity(rq, env->sd)) {
+		} else if ((env->idle || cacheable) &&
+			   sched_reduced_capacity(rq, env->sd)) {
 			/* Check for a task running on a CPU with reduced capacity */
-			if (sgs->group_misfit_task_load < load)
-				sgs->group_misfit_task_load = load;
+			if (lbc.reduced_load < load)
+				lbc.reduced_load = load;
 		}
 	}
 
+	if (cacheable)
+		sg_lb_stats_cache(group, sgs, &lbc);
+
+summed:
+	/* Overload indicator is only updated at root domain */
+	if (balancing_at_rd && lbc.overloaded)
+		*sg_overloaded = 1;
+
+	if (env->idle && lbc.reduced_load)
+		sgs->group_misfit_task_load = lbc.reduced_load;
+
 	sgs->group_capacity = group->sgc->capacity;
 
 	sgs->group_weight = group->group_weight;
@@ -15114,6 +15320,7 @@ int alloc_fair_sched_group(struct task_group *tg, struct task_group *parent)
 
 	tg->cfs_rq = &state->cfs_rq;
 	tg->shares = NICE_0_LOAD;
+	tg->latency_prio = DEFAULT_LATENCY_PRIO;
 
 	init_cfs_bandwidth(tg_cfs_bandwidth(tg), tg_cfs_bandwidth(parent));
 
@@ -15331,6 +15538,20 @@ int sched_group_set_idle(struct task_group *tg, long idle)
 	return 0;
 }
 
+/*
+ * The group entities pick up the new slice the next time they are enqueued
+ * or the hierarchy below them changes, like for the min_slice they follow
+ * otherwise.
+ */
+int sched_group_set_latency(struct task_group *tg, int latency_prio)
+{
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	WRITE_ONCE(tg->latency_prio, latency_prio);
+	return 0;
+}
+
 #endif /* CONFIG_FAIR_GROUP_SCHED */
 
 
@@ -142,3 +142,9 @@ SCHED_FEAT(LATENCY_WARN, false)
  */
 SCHED_FEAT(NI_RANDOM, true)
 SCHED_FEAT(NI_RATE, true)
+
+/*
+ * Reuse the statistics of remote groups in NUMA domains while they hold,
+ * see sg_lb_stats_cacheable().
+ */
+SCHED_FEAT(LB_STATS_CACHE, true)
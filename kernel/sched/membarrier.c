@@ -327,7 +327,8 @@ static int membarrier_global_expedited(void)
 	return 0;
 }
 
-static int membarrier_private_expedited(int flags, int cpu_id)
+static int membarrier_private_expedited(int flags, int cpu_id,
+					struct task_struct *target)
 {
 	struct mm_struct *mm = current->mm;
 	smp_call_func_t ipi_func = ipi_mb;
@@ -371,6 +372,19 @@ static int membarrier_private_expedited(int flags, int cpu_id)
 	 * rq->curr modification in scheduler.
 	 */
 	guard(mb)();
+	if (target) {
+		/*
+		 * Read the target's CPU after the barrier above: if the
+		 * target ran user code before it, the scheduler's barrier
+		 * after its rq->curr store orders the CPU it runs on before
+		 * this read. Otherwise the target goes through that barrier
+		 * before it next returns to user-space, and if it moves
+		 * away in the meantime, it does so through the scheduler.
+		 * That doesn't serialize its core, so SYNC_CORE never gets
+		 * here with a target.
+		 */
+		cpu_id = task_cpu(target);
+	}
 	if (cpu_id >= 0) {
 		if (cpu_id >= nr_cpu_ids || !cpu_possible(cpu_id))
 			return 0;
@@ -442,6 +456,52 @@ static int membarrier_private_expedited(int flags, int cpu_id)
 	return 0;
 }
 
+/*
+ * Look up the thread targeted by MEMBARRIER_CMD_FLAG_TID or
+ * MEMBARRIER_CMD_FLAG_PIDFD. Only threads of the caller's process can be
+ * targeted, like the untargeted private expedited commands only cover
+ * those.
+ */
+static struct task_struct *membarrier_get_target(unsigned int flags, int id)
+{
+	struct task_struct *p;
+	unsigned int f_flags;
+
+	if (flags & MEMBARRIER_CMD_FLAG_TID) {
+		p = find_get_task_by_vpid(id);
+		if (!p)
+			return ERR_PTR(-ESRCH);
+	} else {
+		p = pidfd_get_task(id, &f_flags);
+		if (IS_ERR(p))
+			return p;
+	}
+
+	if (!same_thread_group(p, current)) {
+		put_task_struct(p);
+		return ERR_PTR(-EINVAL);
+	}
+	return p;
+}
+
+static int membarrier_private_expedited_target(int flags, unsigned int cmd_flags,
+					       int cpu_id)
+{
+	struct task_struct *target = NULL;
+	int ret;
+
+	if (cmd_flags & (MEMBARRIER_CMD_FLAG_TID | MEMBARRIER_CMD_FLAG_PIDFD)) {
+		target = membarrier_get_target(cmd_flags, cpu_id);
+		if (IS_ERR(target))
+			return PTR_ERR(target);
+	}
+
+	ret = membarrier_private_expedited(flags, cpu_id, target);
+	if (target)
+		put_task_struct(target);
+	return ret;
+}
+
 static int sync_runqueues_membarrier_state(struct mm_struct *mm)
 {
 	int membarrier_state = atomic_read(&mm->membarrier_state);
@@ -598,14 +658,17 @@ static int membarrier_get_registrations(void)
 /**
  * sys_membarrier - issue memory barriers on a set of threads
  * @cmd:    Takes command values defined in enum membarrier_cmd.
- * @flags:  Currently needs to be 0 for all commands other than
- *          MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ: in the latter
- *          case it can be MEMBARRIER_CMD_FLAG_CPU, indicating that @cpu_id
- *          contains the CPU on which to interrupt (= restart)
- *          the RSEQ critical section.
+ * @flags:  Currently needs to be 0 for all commands other than the
+ *          private expedited ones: for those it can be one of
+ *          MEMBARRIER_CMD_FLAG_CPU, MEMBARRIER_CMD_FLAG_TID or
+ *          MEMBARRIER_CMD_FLAG_PIDFD, indicating that @cpu_id contains
+ *          the CPU, thread ID or thread pidfd to target instead of all
+ *          threads of the process. MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE
+ *          only accepts MEMBARRIER_CMD_FLAG_CPU.
  * @cpu_id: if @flags == MEMBARRIER_CMD_FLAG_CPU, indicates the cpu on which
- *          RSEQ CS should be interrupted (@cmd must be
- *          MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ).
+ *          to issue the barrier (e.g. interrupt the RSEQ CS). With
+ *          MEMBARRIER_CMD_FLAG_TID or MEMBARRIER_CMD_FLAG_PIDFD, indicates
+ *          the thread whose CPU to issue it on, if the thread is running.
  *
  * If this system call is not implemented, -ENOSYS is returned. If the
  * command specified does not exist, not available on the running
@@ -634,16 +697,29 @@ static int membarrier_get_registrations(void)
 SYSCALL_DEFINE3(membarrier, int, cmd, unsigned int, flags, int, cpu_id)
 {
 	switch (cmd) {
-	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ:
+	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE:
+		/*
+		 * A thread that isn't running may next run on a CPU which
+		 * already runs another thread of the process. That CPU goes
+		 * through no mm switch, so only an IPI to it would serialize
+		 * the core: a single thread can't be targeted.
+		 */
 		if (unlikely(flags && flags != MEMBARRIER_CMD_FLAG_CPU))
 			return -EINVAL;
 		break;
+	case MEMBARRIER_CMD_PRIVATE_EXPEDITED:
+	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ:
+		if (unlikely(flags && flags != MEMBARRIER_CMD_FLAG_CPU &&
+			     flags != MEMBARRIER_CMD_FLAG_TID &&
+			     flags != MEMBARRIER_CMD_FLAG_PIDFD))
+			return -EINVAL;
+		break;
 	default:
 		if (unlikely(flags))
 			return -EINVAL;
 	}
 
-	if (!(flags & MEMBARRIER_CMD_FLAG_CPU))
+	if (!flags)
 		cpu_id = -1;
 
 	switch (cmd) {
@@ -667,15 +743,15 @@ SYSCALL_DEFINE3(membarrier, int, cmd, unsigned int, flags, int, cpu_id)
 	case MEMBARRIER_CMD_REGISTER_GLOBAL_EXPEDITED:
 		return membarrier_register_global_expedited();
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED:
-		return membarrier_private_expedited(0, cpu_id);
+		return membarrier_private_expedited_target(0, flags, cpu_id);
 	case MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED:
 		return membarrier_register_private_expedited(0);
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE:
-		return membarrier_private_expedited(MEMBARRIER_FLAG_SYNC_CORE, cpu_id);
+		return membarrier_private_expedited_target(MEMBARRIER_FLAG_SYNC_CORE, flags, cpu_id);
 	case MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_SYNC_CORE:
 		return membarrier_register_private_expedited(MEMBARRIER_FLAG_SYNC_CORE);
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ:
-		return membarrier_private_expedited(MEMBARRIER_FLAG_RSEQ, cpu_id);
+		return membarrier_private_expedited_target(MEMBARRIER_FLAG_RSEQ, flags, cpu_id);
 	case MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_RSEQ:
 		return membarrier_register_private_expedited(MEMBARRIER_FLAG_RSEQ);
 	case MEMBARRIER_CMD_GET_REGISTRATIONS:
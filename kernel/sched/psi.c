@@ -240,29 +240,81 @@ void __init psi_init(void)
 	group_init(&psi_system);
 }
 
-static u32 test_states(unsigned int *tasks, u32 state_mask)
+static u32 test_subtree(struct psi_group_cpu *groupc, bool oncpu, int cpu)
 {
-	const bool oncpu = state_mask & PSI_ONCPU;
+	unsigned int *tasks = groupc->tasks;
+	u32 subtree_mask = 0;
+	int s;
+
+	if (tasks[NR_IOWAIT])
+		subtree_mask |= BIT(PSI_SUBTREE_IOWAIT);
+
+	if (tasks[NR_MEMSTALL])
+		subtree_mask |= BIT(PSI_SUBTREE_MEMSTALL);
+
+	if (tasks[NR_RUNNING]) {
+		subtree_mask |= BIT(PSI_SUBTREE_RUNNING);
+		if (tasks[NR_RUNNING] > tasks[NR_MEMSTALL_RUNNING])
+			subtree_mask |= BIT(PSI_SUBTREE_PRODUCTIVE);
+		if (tasks[NR_RUNNING] > oncpu)
+			subtree_mask |= BIT(PSI_SUBTREE_QUEUED);
+	}
+
+	/*
+	 * Since we care about lost potential, a memstall is FULL
+	 * when there are no other working tasks, but also when
+	 * the CPU is actively reclaiming and nothing productive
+	 * could run even if it were runnable. So when the current
+	 * task in a cgroup is in_memstall, the corresponding groupc
+	 * on that cpu is in PSI_MEM_FULL state.
+	 */
+	if (oncpu) {
+		subtree_mask |= BIT(PSI_SUBTREE_ONCPU);
+		if (unlikely(cpu_curr(cpu)->in_memstall))
+			subtree_mask |= BIT(PSI_SUBTREE_ONCPU_MEMSTALL);
+	}
 
-	if (tasks[NR_IOWAIT]) {
+	/*
+	 * Each of these is true of the subtree if it is true of the
+	 * group's own tasks or of any child's subtree: the running
+	 * tasks outnumber the one on the CPU in the subtree exactly
+	 * when they do in one of its parts, and there is a productive
+	 * task in the subtree exactly when there is one in a part.
+	 */
+	for (s = 0; s < NR_PSI_SUBTREE_STATES; s++)
+		if (groupc->children[s])
+			subtree_mask |= BIT(s);
+
+	return subtree_mask;
+}
+
+static u32 test_states(u32 subtree_mask, u32 state_mask)
+{
+	if (subtree_mask & BIT(PSI_SUBTREE_IOWAIT)) {
 		state_mask |= BIT(PSI_IO_SOME);
-		if (!tasks[NR_RUNNING])
+		if (!(subtree_mask & BIT(PSI_SUBTREE_RUNNING)))
 			state_mask |= BIT(PSI_IO_FULL);
 	}
 
-	if (tasks[NR_MEMSTALL]) {
+	if (subtree_mask & BIT(PSI_SUBTREE_MEMSTALL)) {
 		state_mask |= BIT(PSI_MEM_SOME);
-		if (tasks[NR_RUNNING] == tasks[NR_MEMSTALL_RUNNING])
+		if (!(subtree_mask & BIT(PSI_SUBTREE_PRODUCTIVE)))
 			state_mask |= BIT(PSI_MEM_FULL);
 	}
 
-	if (tasks[NR_RUNNING] > oncpu)
+	if (subtree_mask & BIT(PSI_SUBTREE_ONCPU_MEMSTALL))
+		state_mask |= BIT(PSI_MEM_FULL);
+
+	if (subtree_mask & BIT(PSI_SUBTREE_QUEUED))
 		state_mask |= BIT(PSI_CPU_SOME);
 
-	if (tasks[NR_RUNNING] && !oncpu)
+	if ((subtree_mask & BIT(PSI_SUBTREE_RUNNING)) &&
+	    !(subtree_mask & BIT(PSI_SUBTREE_ONCPU)))
 		state_mask |= BIT(PSI_CPU_FULL);
 
-	if (tasks[NR_IOWAIT] || tasks[NR_MEMSTALL] || tasks[NR_RUNNING])
+	if (subtree_mask & (BIT(PSI_SUBTREE_IOWAIT) |
+			    BIT(PSI_SUBTREE_MEMSTALL) |
+			    BIT(PSI_SUBTREE_RUNNING)))
 		state_mask |= BIT(PSI_NONIDLE);
 
 	return state_mask;
@@ -274,7 +326,6 @@ static void get_recent_times(struct psi_group *group, int cpu,
 {
 	struct psi_group_cpu *groupc = per_cpu_ptr(group->pcpu, cpu);
 	int current_cpu = raw_smp_processor_id();
-	unsigned int tasks[NR_PSI_TASK_COUNTS];
 	u64 now, state_start;
 	enum psi_states s;
 	unsigned int seq;
@@ -289,8 +340,6 @@ static void get_recent_times(struct psi_group *group, int cpu,
 		memcpy(times, groupc->times, sizeof(groupc->times));
 		state_mask = groupc->state_mask;
 		state_start = groupc->state_start;
-		if (cpu == current_cpu)
-			memcpy(tasks, groupc->tasks, sizeof(groupc->tasks));
 	} while (psi_read_retry(cpu, seq));
 
 	/* Calculate state time deltas against the previous snapshot */
@@ -320,17 +369,17 @@ static void get_recent_times(struct psi_group *group, int cpu,
 	 * When collect_percpu_times() from the avgs_work, we don't want to
 	 * re-arm avgs_work when all CPUs are IDLE. But the current CPU running
 	 * this avgs_work is never IDLE, cause avgs_work can't be shut off.
-	 * So for the current CPU, we need to re-arm avgs_work only when
-	 * (NR_RUNNING > 1 || NR_IOWAIT > 0 || NR_MEMSTALL > 0), for other CPUs
+	 * So for the current CPU, we need to re-arm avgs_work only when some
+	 * task other than avgs_work is runnable or stalled, for other CPUs
 	 * we can just check PSI_NONIDLE delta.
 	 */
 	if (current_work() == &group->avgs_work.work) {
 		bool reschedule;
 
 		if (cpu == current_cpu)
-			reschedule = tasks[NR_RUNNING] +
-				     tasks[NR_IOWAIT] +
-				     tasks[NR_MEMSTALL] > 1;
+			reschedule = state_mask & (BIT(PSI_IO_SOME) |
+						   BIT(PSI_MEM_SOME) |
+						   BIT(PSI_CPU_SOME));
 		else
 			reschedule = *pchanged_states & (1 << PSI_NONIDLE);
 
@@ -795,11 +844,13 @@ static void record_times(struct psi_group_cpu *groupc, u64 now)
 
 static void psi_group_change(struct psi_group *group, int cpu,
 			     unsigned int clear, unsigned int set,
+			     u32 child_clear, u32 child_set,
 			     u64 now, bool wake_clock)
 {
 	struct psi_group_cpu *groupc;
 	unsigned int t, m;
 	u32 state_mask;
+	bool oncpu;
 
 	lockdep_assert_rq_held(cpu_rq(cpu));
 	groupc = per_cpu_ptr(group->pcpu, cpu);
@@ -819,10 +870,12 @@ static void psi_group_change(struct psi_group *group, int cpu,
 	} else {
 		state_mask = groupc->state_mask & PSI_ONCPU;
 	}
+	oncpu = state_mask & PSI_ONCPU;
 
 	/*
 	 * The rest of the state mask is calculated based on the task
-	 * counts. Update those first, then construct the mask.
+	 * counts and the subtree states of the children. Update those
+	 * first, then construct the mask.
 	 */
 	for (t = 0, m = clear; m; m &= ~(1 << t), t++) {
 		if (!(m & (1 << t)))
@@ -842,6 +895,25 @@ static void psi_group_change(struct psi_group *group, int cpu,
 		if (set & (1 << t))
 			groupc->tasks[t]++;
 
+	for (t = 0, m = child_clear; m; m &= ~(1 << t), t++) {
+		if (!(m & (1 << t)))
+			continue;
+		if (groupc->children[t]) {
+			groupc->children[t]--;
+		} else if (!psi_bug) {
+			printk_deferred(KERN_ERR "psi: child underflow! cpu=%d s=%d clear=%x set=%x\n",
+					cpu, t, child_clear, child_set);
+			psi_bug = 1;
+		}
+	}
+
+	for (t = 0; child_set; child_set &= ~(1 << t), t++)
+		if (child_set & (1 << t))
+			groupc->children[t]++;
+
+	/* The parent keeps counting the subtree even while PSI is disabled */
+	groupc->subtree_mask = test_subtree(groupc, oncpu, cpu);
+
 	if (!group->enabled) {
 		/*
 		 * On the first group change after disabling PSI, conclude
@@ -858,18 +930,16 @@ static void psi_group_change(struct psi_group *group, int cpu,
 		return;
 	}
 
-	state_mask = test_states(groupc->tasks, state_mask);
+	state_mask = test_states(groupc->subtree_mask, state_mask);
 
 	/*
-	 * Since we care about lost potential, a memstall is FULL
-	 * when there are no other working tasks, but also when
-	 * the CPU is actively reclaiming and nothing productive
-	 * could run even if it were runnable. So when the current
-	 * task in a cgroup is in_memstall, the corresponding groupc
-	 * on that cpu is in PSI_MEM_FULL state.
+	 * The time of a state that continues is folded in when it ends,
+	 * or by get_recent_times() while it lasts, so only state changes
+	 * need to be recorded. The aggregators are already running for
+	 * any state that was active before.
 	 */
-	if (unlikely((state_mask & PSI_ONCPU) && cpu_curr(cpu)->in_memstall))
-		state_mask |= (1 << PSI_MEM_FULL);
+	if (state_mask == groupc->state_mask)
+		return;
 
 	record_times(groupc, now);
 
@@ -882,6 +952,33 @@ static void psi_group_change(struct psi_group *group, int cpu,
 		schedule_delayed_work(&group->avgs_work, PSI_FREQ);
 }
 
+/*
+ * Apply a task change to @group and carry it up the hierarchy for as
+ * long as it changes the subtree state of the groups on the way. Most
+ * task changes are absorbed by the task's own group or a close ancestor,
+ * so this doesn't grow with the depth of the hierarchy the way updating
+ * every ancestor would.
+ */
+static void psi_groups_change(struct psi_group *group, int cpu,
+			      unsigned int clear, unsigned int set,
+			      u64 now, bool wake_clock)
+{
+	u32 child_clear = 0, child_set = 0;
+
+	do {
+		struct psi_group_cpu *groupc = per_cpu_ptr(group->pcpu, cpu);
+		u32 subtree_mask = groupc->subtree_mask;
+
+		psi_group_change(group, cpu, clear, set, child_clear, child_set,
+				 now, wake_clock);
+
+		child_clear = subtree_mask & ~groupc->subtree_mask;
+		child_set = groupc->subtree_mask & ~subtree_mask;
+		clear = set = 0;
+		group = group->parent;
+	} while (group && (child_clear | child_set));
+}
+
 static inline struct psi_group *task_psi_group(struct task_struct *task)
 {
 #ifdef CONFIG_CGROUPS
@@ -918,37 +1015,37 @@ void psi_task_change(struct task_struct *task, int clear, int set)
 
 	psi_write_begin(cpu);
 	now = cpu_clock(cpu);
-	for_each_group(group, task_psi_group(task))
-		psi_group_change(group, cpu, clear, set, now, true);
+	psi_groups_change(task_psi_group(task), cpu, clear, set, now, true);
 	psi_write_end(cpu);
 }
 
 void psi_task_switch(struct task_struct *prev, struct task_struct *next,
 		     bool sleep)
 {
-	struct psi_group *common = NULL;
+	bool same_group = false;
 	int cpu = task_cpu(prev);
 	u64 now;
 
 	psi_write_begin(cpu);
 	now = cpu_clock(cpu);
 
+	/*
+	 * If @next is in @prev's cgroup, TSK_ONCPU stays set there and
+	 * neither the cgroup nor its ancestors see it change.
+	 */
+	if (prev->pid && next->pid)
+		same_group = task_psi_group(prev) == task_psi_group(next);
+
 	if (next->pid) {
 		psi_flags_change(next, 0, TSK_ONCPU);
 		/*
-		 * Set TSK_ONCPU on @next's cgroups. If @next shares any
-		 * ancestors with @prev, those will already have @prev's
-		 * TSK_ONCPU bit set, and we can stop the iteration there.
+		 * Set TSK_ONCPU on @next's cgroup. If @next shares any
+		 * ancestors with @prev, those already have @prev's subtree
+		 * on the CPU, and the change stops before them.
 		 */
-		for_each_group(group, task_psi_group(next)) {
-			struct psi_group_cpu *groupc = per_cpu_ptr(group->pcpu, cpu);
-
-			if (groupc->state_mask & PSI_ONCPU) {
-				common = group;
-				break;
-			}
-			psi_group_change(group, cpu, 0, TSK_ONCPU, now, true);
-		}
+		if (!same_group)
+			psi_groups_change(task_psi_group(next), cpu, 0, TSK_ONCPU,
+					  now, true);
 	}
 
 	if (prev->pid) {
@@ -959,7 +1056,7 @@ void psi_task_switch(struct task_struct *prev, struct task_struct *next,
 		 * When we're going to sleep, psi_dequeue() lets us
 		 * handle TSK_RUNNING, TSK_MEMSTALL_RUNNING and
 		 * TSK_IOWAIT here, where we can combine it with
-		 * TSK_ONCPU and save walking common ancestors twice.
+		 * TSK_ONCPU and save walking the ancestors twice.
 		 */
 		if (sleep) {
 			clear |= TSK_RUNNING;
@@ -981,23 +1078,16 @@ void psi_task_switch(struct task_struct *prev, struct task_struct *next,
 
 		psi_flags_change(prev, clear, set);
 
-		for_each_group(group, task_psi_group(prev)) {
-			if (group == common)
-				break;
-			psi_group_change(group, cpu, clear, set, now, wake_clock);
-		}
-
 		/*
-		 * TSK_ONCPU is handled up to the common ancestor. If there are
-		 * any other differences between the two tasks (e.g. prev goes
-		 * to sleep, or only one task is memstall), finish propagating
-		 * those differences all the way up to the root.
+		 * Within the same cgroup, the current task still changes
+		 * from @prev to @next, which matters if only one of them
+		 * is in a memstall.
 		 */
-		if ((prev->psi_flags ^ next->psi_flags) & ~TSK_ONCPU) {
+		if (same_group)
 			clear &= ~TSK_ONCPU;
-			for_each_group(group, common)
-				psi_group_change(group, cpu, clear, set, now, wake_clock);
-		}
+
+		psi_groups_change(task_psi_group(prev), cpu, clear, set,
+				  now, wake_clock);
 	}
 	psi_write_end(cpu);
 }
@@ -1213,7 +1303,7 @@ void psi_cgroup_restart(struct psi_group *group)
 
 	/*
 	 * After we disable psi_group->enabled, we don't actually
-	 * stop percpu tasks accounting in each psi_group_cpu,
+	 * stop percpu tasks and subtree accounting in each psi_group_cpu,
 	 * instead only stop test_states() loop, record_times()
 	 * and averaging worker, see psi_group_change() for details.
 	 *
@@ -1222,7 +1312,7 @@ void psi_cgroup_restart(struct psi_group *group)
 	 * would see !psi_group->enabled and only do task accounting.
 	 *
 	 * When re-enable cgroup PSI, this function use psi_group_change()
-	 * to get correct state mask from test_states() loop on tasks[],
+	 * to get correct state mask from test_states() on subtree_mask,
 	 * and restart groupc->state_start from now, use .clear = .set = 0
 	 * here since no task status really changed.
 	 */
@@ -1236,7 +1326,7 @@ void psi_cgroup_restart(struct psi_group *group)
 
 		psi_write_begin(cpu);
 		now = cpu_clock(cpu);
-		psi_group_change(group, cpu, 0, 0, now, true);
+		psi_group_change(group, cpu, 0, 0, 0, 0, now, true);
 		psi_write_end(cpu);
 	}
 }
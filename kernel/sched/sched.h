@@ -487,6 +487,8 @@ struct task_group {
 	/* runqueue "owned" by this group on each CPU */
 	struct cfs_rq __percpu	*cfs_rq;
 	unsigned long		shares;
+	/* sets the slice of the group entities, see group_entity_slice() */
+	int			latency_prio;
 	/*
 	 * load_avg can be heavily contended at clock tick time, so put
 	 * it in its own cache-line separated from the fields above which
@@ -613,11 +615,14 @@ extern int sched_group_set_shares(struct task_group *tg, unsigned long shares);
 
 extern int sched_group_set_idle(struct task_group *tg, long idle);
 
+extern int sched_group_set_latency(struct task_group *tg, int latency_prio);
+
 extern void set_task_rq_fair(struct sched_entity *se,
 			     struct cfs_rq *prev, struct cfs_rq *next);
 #else /* !CONFIG_FAIR_GROUP_SCHED: */
 static inline int sched_group_set_shares(struct task_group *tg, unsigned long shares) { return 0; }
 static inline int sched_group_set_idle(struct task_group *tg, long idle) { return 0; }
+static inline int sched_group_set_latency(struct task_group *tg, int latency_prio) { return 0; }
 #endif /* !CONFIG_FAIR_GROUP_SCHED */
 
 #else /* !CONFIG_CGROUP_SCHED: */
@@ -2209,6 +2214,28 @@ static __always_inline bool sched_asym_cpucap_active(void)
 	return static_branch_unlikely(&sched_asym_cpucapacity);
 }
 
+/*
+ * Sums of the CPU statistics of a sched_group, which load balancing in NUMA
+ * domains reuses for the other groups than its local one, see
+ * update_sg_lb_stats().
+ */
+struct sched_group_lb_cache {
+	unsigned long		stamp;			/* jiffies when summed */
+	unsigned long		load;
+	unsigned long		util;
+	unsigned long		runnable;
+	unsigned long		reduced_load;		/* Max load on a CPU of reduced capacity */
+	unsigned int		nr_running;
+	unsigned int		h_nr_running;
+	unsigned int		idle_cpus;
+	bool			overutilized;
+	bool			overloaded;		/* A CPU runs more than one task */
+#ifdef CONFIG_NUMA_BALANCING
+	unsigned int		nr_numa_running;
+	unsigned int		nr_preferred_running;
+#endif
+};
+
 struct sched_group_capacity {
 	atomic_t		ref;
 	/*
@@ -2223,6 +2250,15 @@ struct sched_group_capacity {
 
 	int			id;
 
+	/*
+	 * Set when a task is enqueued or dequeued on a CPU of the group, the
+	 * cache then no longer holds until it is summed again.
+	 */
+	int			lb_stale;
+	raw_spinlock_t		lb_lock;		/* Serializes lb_cache updates */
+	seqcount_t		lb_seq;
+	struct sched_group_lb_cache lb_cache;
+
 	unsigned long		cpumask[];		/* Balance mask */
 };
 
@@ -3003,6 +3039,36 @@ static inline int sched_tick_offload_init(void) { return 0; }
 static inline void sched_update_tick_dependency(struct rq *rq) { }
 #endif /* !CONFIG_NO_HZ_FULL */
 
+#ifdef CONFIG_NUMA
+/*
+ * The number of tasks on @rq changed, so the load balancing summaries of the
+ * NUMA level groups it belongs to are stale. The flag is only written when it
+ * was clear, so that the cacheline stays shared between enqueues.
+ *
+ * This only reaches the group of each level as seen from @rq's CPU. NUMA
+ * groups overlap and are built per CPU, so the groups other CPUs see this
+ * CPU in may have a different sched_group_capacity and are not marked:
+ * walking them all on every enqueue would cost more than the scans the cache
+ * saves. Their sums may miss the change for the rest of the jiffy, after
+ * which sg_lb_stats_cached() ignores them anyway. Load balancing accepts that
+ * much staleness, like the PELT signals it already reads.
+ */
+static inline void sched_balance_stats_invalidate(struct rq *rq)
+{
+	struct sched_domain *sd;
+
+	for (sd = rcu_dereference_all(per_cpu(sd_numa, cpu_of(rq))); sd;
+	     sd = sd->parent) {
+		struct sched_group_capacity *sgc = sd->groups->sgc;
+
+		if (!READ_ONCE(sgc->lb_stale))
+			WRITE_ONCE(sgc->lb_stale, 1);
+	}
+}
+#else /* !CONFIG_NUMA: */
+static inline void sched_balance_stats_invalidate(struct rq *rq) { }
+#endif /* !CONFIG_NUMA */
+
 static inline void add_nr_running(struct rq *rq, unsigned count)
 {
 	unsigned prev_nr = rq->nr_running;
@@ -3015,6 +3081,7 @@ static inline void add_nr_running(struct rq *rq, unsigned count)
 	if (prev_nr < 2 && rq->nr_running >= 2)
 		set_rd_overloaded(rq->rd, 1);
 
+	sched_balance_stats_invalidate(rq);
 	sched_update_tick_dependency(rq);
 }
 
@@ -3025,6 +3092,8 @@ static inline void sub_nr_running(struct rq *rq, unsigned count)
 		call_trace_sched_update_nr_running(rq, -count);
 	}
 
+	sched_balance_stats_invalidate(rq);
+
 	/* Check if we still need preemption */
 	sched_update_tick_dependency(rq);
 }
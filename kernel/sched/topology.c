@@ -2707,6 +2707,8 @@ static int __sdt_alloc(const struct cpumask *cpu_map)
 				return -ENOMEM;
 
 			sgc->id = j;
+			raw_spin_lock_init(&sgc->lb_lock);
+			seqcount_init(&sgc->lb_seq);
 
 			*per_cpu_ptr(sdd->sgc, j) = sgc;
 		}
@@ -2832,6 +2832,21 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 			return -EINVAL;
 		error = prctl_get_auxv((void __user *)arg2, arg3);
 		break;
+	case PR_SET_ASYNC_TEARDOWN:
+		if (arg3 || arg4 || arg5)
+			return -EINVAL;
+		if (arg2 == 1)
+			mm_flags_set(MMF_ASYNC_TEARDOWN, me->mm);
+		else if (!arg2)
+			mm_flags_clear(MMF_ASYNC_TEARDOWN, me->mm);
+		else
+			return -EINVAL;
+		break;
+	case PR_GET_ASYNC_TEARDOWN:
+		if (arg2 || arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = !!mm_flags_test(MMF_ASYNC_TEARDOWN, me->mm);
+		break;
 #ifdef CONFIG_KSM
 	case PR_SET_MEMORY_MERGE:
 		if (arg3 || arg4 || arg5)
@@ -8,6 +8,7 @@
 #include <linux/page_ext.h>
 #include <linux/pgalloc_tag.h>
 #include <linux/proc_fs.h>
+#include <linux/random.h>
 #include <linux/rcupdate.h>
 #include <linux/seq_buf.h>
 #include <linux/seq_file.h>
@@ -39,6 +40,59 @@ EXPORT_SYMBOL(mem_alloc_profiling_key);
 
 DEFINE_STATIC_KEY_FALSE(mem_profiling_compressed);
 
+DEFINE_STATIC_KEY_FALSE(mem_alloc_profiling_sampled);
+EXPORT_SYMBOL(mem_alloc_profiling_sampled);
+
+DEFINE_PER_CPU(int, alloc_tag_sample_countdown);
+EXPORT_PER_CPU_SYMBOL(alloc_tag_sample_countdown);
+
+/* Account about one allocation in this many, see alloc_tag_sample() */
+static unsigned int alloc_tag_sample_rate = 1;
+
+/* LCG state for the sampling intervals, seeded when sampling is enabled */
+static DEFINE_PER_CPU(u32, alloc_tag_sample_seed);
+
+/*
+ * The countdown of this CPU ran out: account this allocation and pick how many
+ * to skip until the next one. The interval is randomized around the rate, so
+ * that allocations recurring with a fixed period don't all get missed.
+ *
+ * This runs for allocations from any context, NMI included, so the interval
+ * comes from a lockless per-CPU LCG rather than the random pool. A racing
+ * update from an interrupt only perturbs the sequence.
+ */
+bool __alloc_tag_sample(void)
+{
+	unsigned int rate = READ_ONCE(alloc_tag_sample_rate);
+	u32 seed;
+
+	if (rate <= 1) {
+		this_cpu_write(alloc_tag_sample_countdown, 1);
+		return true;
+	}
+
+	seed = this_cpu_read(alloc_tag_sample_seed) * 1664525 + 1013904223;
+	this_cpu_write(alloc_tag_sample_seed, seed);
+	this_cpu_write(alloc_tag_sample_countdown,
+		       reciprocal_scale(seed, 2 * rate - 1) + 1);
+	return true;
+}
+EXPORT_SYMBOL(__alloc_tag_sample);
+
+/* Counters of @tag, scaled up to make up for sampling */
+static struct alloc_tag_counters alloc_tag_read_scaled(struct alloc_tag *tag)
+{
+	struct alloc_tag_counters counter = alloc_tag_read(tag);
+	unsigned int rate = READ_ONCE(alloc_tag_sample_rate);
+
+	if (static_branch_unlikely(&mem_alloc_profiling_sampled)) {
+		counter.bytes *= rate;
+		counter.calls *= rate;
+	}
+
+	return counter;
+}
+
 struct alloc_tag_kernel_section kernel_tags = { NULL, 0 };
 unsigned long alloc_tag_ref_mask;
 int alloc_tag_ref_offs;
@@ -90,12 +144,15 @@ static void print_allocinfo_header(struct seq_buf *buf)
 	/* Output format version, so we can change it. */
 	seq_buf_printf(buf, "allocinfo - version: 2.0\n");
 	seq_buf_printf(buf, "#     <size>  <calls> <tag info>\n");
+	if (static_branch_unlikely(&mem_alloc_profiling_sampled))
+		seq_buf_printf(buf, "# sampled: 1 in %u allocations, scaled\n",
+			       READ_ONCE(alloc_tag_sample_rate));
 }
 
 static void alloc_tag_to_text(struct seq_buf *out, struct codetag *ct)
 {
 	struct alloc_tag *tag = ct_to_alloc_tag(ct);
-	struct alloc_tag_counters counter = alloc_tag_read(tag);
+	struct alloc_tag_counters counter = alloc_tag_read_scaled(tag);
 	s64 bytes = counter.bytes;
 
 	seq_buf_printf(out, "%12lli %8llu ", bytes, counter.calls);
@@ -147,7 +204,7 @@ size_t alloc_tag_top_users(struct codetag_bytes *tags, size_t count, bool can_sl
 
 	iter = codetag_get_ct_iter(alloc_tag_cttype);
 	while ((ct = codetag_next_ct(&iter))) {
-		struct alloc_tag_counters counter = alloc_tag_read(ct_to_alloc_tag(ct));
+		struct alloc_tag_counters counter = alloc_tag_read_scaled(ct_to_alloc_tag(ct));
 
 		n.ct	= ct;
 		n.bytes = counter.bytes;
@@ -953,6 +1010,38 @@ static int proc_mem_profiling_handler(const struct ctl_table *table, int write,
 	return proc_do_static_key(table, write, buffer, lenp, ppos);
 }
 
+static DEFINE_MUTEX(alloc_tag_sample_lock);
+
+static int proc_mem_profiling_sample_rate(const struct ctl_table *table, int write,
+					  void *buffer, size_t *lenp, loff_t *ppos)
+{
+	unsigned int rate;
+	struct ctl_table t = *table;
+	int ret;
+
+	if (!write)
+		return proc_douintvec_minmax(table, write, buffer, lenp, ppos);
+
+	t.data = &rate;
+	ret = proc_douintvec_minmax(&t, write, buffer, lenp, ppos);
+	if (ret)
+		return ret;
+
+	mutex_lock(&alloc_tag_sample_lock);
+	WRITE_ONCE(alloc_tag_sample_rate, rate);
+	if (rate > 1) {
+		int cpu;
+
+		for_each_possible_cpu(cpu)
+			per_cpu(alloc_tag_sample_seed, cpu) = get_random_u32();
+		static_branch_enable(&mem_alloc_profiling_sampled);
+	} else {
+		static_branch_disable(&mem_alloc_profiling_sampled);
+	}
+	mutex_unlock(&alloc_tag_sample_lock);
+
+	return 0;
+}
 
 static const struct ctl_table memory_allocation_profiling_sysctls[] = {
 	{
@@ -961,6 +1050,15 @@ static const struct ctl_table memory_allocation_profiling_sysctls[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_mem_profiling_handler,
 	},
+	{
+		.procname	= "mem_profiling_sample_rate",
+		.data		= &alloc_tag_sample_rate,
+		.maxlen		= sizeof(alloc_tag_sample_rate),
+		.mode		= 0644,
+		.proc_handler	= proc_mem_profiling_sample_rate,
+		.extra1		= SYSCTL_ONE,
+		.extra2		= SYSCTL_INT_MAX,
+	},
 };
 
 static void __init sysctl_init(void)
@@ -0,0 +1,222 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Hierarchical percpu counters with a bounded error.
+ */
+
+#include <linux/percpu_counter_tree.h>
+#include <linux/cpumask.h>
+#include <linux/export.h>
+#include <linux/log2.h>
+#include <linux/preempt.h>
+#include <linux/slab.h>
+
+/* How many intermediate nodes level @level has, 1 being the lowest level */
+static inline unsigned int percpu_counter_tree_level_items(unsigned int level)
+{
+	unsigned int shift = level * PERCPU_COUNTER_TREE_ARITY_SHIFT;
+
+	return (nr_cpu_ids + (1U << shift) - 1) >> shift;
+}
+
+/* What a count going from @new - @amount to @new carries to the next level */
+static inline unsigned long percpu_counter_tree_carry(unsigned long new,
+						      unsigned long amount,
+						      unsigned int shift)
+{
+	unsigned long mask = ~0UL << shift;
+
+	return (new & mask) - ((new - amount) & mask);
+}
+
+int percpu_counter_tree_init(struct percpu_counter_tree *pct, long amount,
+			     unsigned int batch, gfp_t gfp)
+{
+	unsigned int level, nr_items = 0;
+
+	if (!batch)
+		batch = PERCPU_COUNTER_TREE_BATCH;
+	pct->batch_shift = order_base_2(batch);
+
+	pct->nr_levels = 0;
+	do {
+		pct->nr_levels++;
+		nr_items += percpu_counter_tree_level_items(pct->nr_levels);
+	} while (percpu_counter_tree_level_items(pct->nr_levels) > 1);
+
+	pct->counters = alloc_percpu_gfp(unsigned long, gfp);
+	if (!pct->counters)
+		return -ENOMEM;
+
+	pct->items = kzalloc_objs(*pct->items, nr_items, gfp);
+	if (!pct->items) {
+		free_percpu(pct->counters);
+		pct->counters = NULL;
+		return -ENOMEM;
+	}
+	pct->root = &pct->items[nr_items - 1];
+	pct->bias = amount;
+
+	/* The CPUs and every node below the root hold less than their batch */
+	pct->accuracy = (long)num_possible_cpus() << pct->batch_shift;
+	for (level = 1; level < pct->nr_levels; level++)
+		pct->accuracy += (long)percpu_counter_tree_level_items(level) <<
+			(pct->batch_shift + level * PERCPU_COUNTER_TREE_ARITY_SHIFT);
+
+	raw_spin_lock_init(&pct->lock);
+	return 0;
+}
+EXPORT_SYMBOL(percpu_counter_tree_init);
+
+void percpu_counter_tree_destroy(struct percpu_counter_tree *pct)
+{
+	if (!pct->counters)
+		return;
+
+	free_percpu(pct->counters);
+	kfree(pct->items);
+	pct->counters = NULL;
+	pct->items = NULL;
+	pct->root = NULL;
+}
+EXPORT_SYMBOL(percpu_counter_tree_destroy);
+
+/*
+ * The CPU count is updated with a local atomic, which is all most updates
+ * do. Once in a batch, the update also carries into the intermediate node of
+ * its CPU group, and once in ARITY batches of that node into the next level,
+ * so the root only sees one update in many. Preemption is disabled so that a
+ * carry, which the approximate value misses while it is in flight, is never
+ * left in flight for long.
+ */
+void percpu_counter_tree_add(struct percpu_counter_tree *pct, long amount)
+{
+	unsigned int shift = pct->batch_shift;
+	unsigned int level, first = 0;
+	unsigned long carry;
+	int cpu;
+
+	preempt_disable();
+	carry = percpu_counter_tree_carry(this_cpu_add_return(*pct->counters,
+							      amount),
+					  amount, shift);
+	cpu = smp_processor_id();
+
+	for (level = 1; carry && level < pct->nr_levels; level++) {
+		struct percpu_counter_tree_item *item;
+		unsigned long count;
+
+		item = &pct->items[first + (cpu >> (level * PERCPU_COUNTER_TREE_ARITY_SHIFT))];
+		count = atomic_long_add_return(carry, &item->count);
+
+		shift += PERCPU_COUNTER_TREE_ARITY_SHIFT;
+		carry = percpu_counter_tree_carry(count, carry, shift);
+		first += percpu_counter_tree_level_items(level);
+	}
+
+	if (carry)
+		atomic_long_add(carry, &pct->root->count);
+	preempt_enable();
+}
+EXPORT_SYMBOL(percpu_counter_tree_add);
+
+/*
+ * Add up all the per-cpu counts. The CPU counts are never reset or folded, so
+ * unlike __percpu_counter_sum() this takes no lock, and offline CPUs keep
+ * their share of the count.
+ */
+long percpu_counter_tree_sum(struct percpu_counter_tree *pct)
+{
+	unsigned long sum = pct->bias;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += READ_ONCE(*per_cpu_ptr(pct->counters, cpu));
+
+	return sum;
+}
+EXPORT_SYMBOL(percpu_counter_tree_sum);
+
+/*
+ * Compare counter against given value.
+ * Return 1 if greater, 0 if equal and -1 if less
+ */
+int percpu_counter_tree_compare(struct percpu_counter_tree *pct, long rhs)
+{
+	long count;
+
+	count = percpu_counter_tree_read(pct);
+	/* Check to see if the approximate value is sufficient for comparison */
+	if (count > rhs)
+		return 1;
+	if (count + pct->accuracy <= rhs)
+		return -1;
+
+	/* Need to use precise count */
+	count = percpu_counter_tree_sum(pct);
+	if (count > rhs)
+		return 1;
+	else if (count < rhs)
+		return -1;
+	else
+		return 0;
+}
+EXPORT_SYMBOL(percpu_counter_tree_compare);
+
+/*
+ * Compare counter, and add amount if total is: less than or equal to limit if
+ * amount is positive, or greater than or equal to limit if amount is negative.
+ * Return true if amount is added, or false if total would be beyond the limit.
+ *
+ * Like __percpu_counter_limited_add(), the precise sum is only taken when the
+ * approximate value, its accuracy and the batches other CPUs might be adding
+ * at the same time do not settle it. Amounts larger than a batch are decided
+ * under the lock, so that they don't race with each other.
+ */
+bool percpu_counter_tree_limited_add(struct percpu_counter_tree *pct,
+				     long limit, long amount)
+{
+	long batch = 1L << pct->batch_shift;
+	long count, unknown;
+	unsigned long flags;
+	bool good = false;
+
+	if (amount == 0)
+		return true;
+
+	local_irq_save(flags);
+	count = percpu_counter_tree_read(pct);
+	unknown = (long)num_online_cpus() << pct->batch_shift;
+
+	/* Skip taking the lock when safe */
+	if (abs(amount) <= batch &&
+	    ((amount > 0 && count + pct->accuracy + unknown + amount <= limit) ||
+	     (amount < 0 && count - unknown + amount >= limit))) {
+		percpu_counter_tree_add(pct, amount);
+		local_irq_restore(flags);
+		return true;
+	}
+
+	raw_spin_lock(&pct->lock);
+	count = percpu_counter_tree_read(pct);
+
+	/* Beyond the limit even at the most favourable end of the error bound */
+	if ((amount > 0 && count - unknown + amount > limit) ||
+	    (amount < 0 && count + pct->accuracy + unknown + amount < limit))
+		goto out;
+
+	/* Need to use precise count unless within the limit at the other end */
+	if (!((amount > 0 && count + pct->accuracy + unknown + amount <= limit) ||
+	      (amount < 0 && count - unknown + amount >= limit))) {
+		count = percpu_counter_tree_sum(pct) + amount;
+		if ((amount > 0 && count > limit) || (amount < 0 && count < limit))
+			goto out;
+	}
+
+	percpu_counter_tree_add(pct, amount);
+	good = true;
+out:
+	raw_spin_unlock(&pct->lock);
+	local_irq_restore(flags);
+	return good;
+}
+EXPORT_SYMBOL(percpu_counter_tree_limited_add);
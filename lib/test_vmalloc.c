@@ -56,6 +56,8 @@ __param(int, run_test_mask, 7,
 		"\t\tid: 1024, name: vm_map_ram_test\n"
 		"\t\tid: 2048, name: no_block_alloc_test\n"
 		"\t\tid: 4096, name: vrealloc_test\n"
+		"\t\tid: 8192, name: mid_size_churn_alloc_test\n"
+		"\t\tid: 16384, name: mid_size_lazy_purge_test\n"
 		/* Add a new test case description here. */
 );
 
@@ -482,6 +484,65 @@ static int vrealloc_test(void)
 	return 0;
 }
 
+/*
+ * A size between 64K and 2M, what BPF programs and modules typically
+ * ask for, rounded to a power of two so that sizes repeat.
+ */
+static unsigned long mid_size(void)
+{
+	return SZ_64K << get_random_u32_below(ilog2(SZ_2M / SZ_64K) + 1);
+}
+
+static int mid_size_churn_alloc_test(void)
+{
+	void *ptr;
+	int i;
+
+	for (i = 0; i < test_loop_count; i++) {
+		ptr = vmalloc(mid_size());
+		if (!ptr)
+			return -1;
+
+		*((__u8 *)ptr) = 0;
+
+		vfree(ptr);
+	}
+
+	return 0;
+}
+
+#define MID_SIZE_BATCH 64
+
+/*
+ * Free in batches, so that the lazily freed space keeps crossing the
+ * purge threshold while allocations go on.
+ */
+static int mid_size_lazy_purge_test(void)
+{
+	void *ptr[MID_SIZE_BATCH];
+	int i, j, rv = 0;
+
+	for (i = 0; i < test_loop_count / MID_SIZE_BATCH; i++) {
+		for (j = 0; j < MID_SIZE_BATCH; j++) {
+			ptr[j] = vmalloc(mid_size());
+			if (!ptr[j]) {
+				rv = -1;
+				break;
+			}
+
+			*((__u8 *)ptr[j]) = 0;
+		}
+
+		while (j--)
+			vfree(ptr[j]);
+
+		if (rv)
+			break;
+	}
+
+	return rv;
+}
+
 struct test_case_desc {
 	const char *test_name;
 	int (*test_func)(void);
@@ -502,6 +563,8 @@ static struct test_case_desc test_case_array[] = {
 	{ "vm_map_ram_test", vm_map_ram_test, },
 	{ "no_block_alloc_test", no_block_alloc_test, true },
 	{ "vrealloc_test", vrealloc_test, },
+	{ "mid_size_churn_alloc_test", mid_size_churn_alloc_test, },
+	{ "mid_size_lazy_purge_test", mid_size_lazy_purge_test, },
 	/* Add a new test case here. */
 };
 
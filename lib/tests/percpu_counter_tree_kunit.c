@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * KUnit tests and benchmark for hierarchical percpu counters.
+ */
+
+#include <kunit/test.h>
+#include <linux/ktime.h>
+#include <linux/percpu_counter.h>
+#include <linux/percpu_counter_tree.h>
+#include <linux/random.h>
+#include <linux/workqueue.h>
+
+#define NR_BENCH_OPS	(1 << 20)
+#define NR_CPU_ADDS	10000
+
+static struct percpu_counter_tree *cpu_pct;
+static atomic_t cpu_adders;
+
+static void expect_bounded(struct kunit *test, struct percpu_counter_tree *pct,
+			   long expected)
+{
+	long approx = percpu_counter_tree_read(pct);
+
+	KUNIT_EXPECT_EQ(test, percpu_counter_tree_sum(pct), expected);
+	KUNIT_EXPECT_LE(test, approx, expected);
+	KUNIT_EXPECT_LT(test, expected - approx, pct->accuracy);
+}
+
+static void percpu_counter_tree_test_add(struct kunit *test)
+{
+	struct percpu_counter_tree pct;
+	long expected = 1000;
+	int i;
+
+	KUNIT_ASSERT_EQ(test, percpu_counter_tree_init(&pct, expected, 0, GFP_KERNEL), 0);
+	expect_bounded(test, &pct, expected);
+
+	for (i = 0; i < NR_CPU_ADDS; i++) {
+		long amount = (long)get_random_u32_below(4096) - 2048;
+
+		percpu_counter_tree_add(&pct, amount);
+		expected += amount;
+		expect_bounded(test, &pct, expected);
+	}
+
+	percpu_counter_tree_sub(&pct, expected + 12345);
+	expect_bounded(test, &pct, -12345);
+
+	percpu_counter_tree_destroy(&pct);
+}
+
+static void percpu_counter_tree_test_compare(struct kunit *test)
+{
+	struct percpu_counter_tree pct;
+	long count;
+
+	KUNIT_ASSERT_EQ(test, percpu_counter_tree_init(&pct, 0, 4, GFP_KERNEL), 0);
+
+	for (count = 0; count < 1000; count++) {
+		KUNIT_EXPECT_EQ(test, percpu_counter_tree_compare(&pct, count), 0);
+		KUNIT_EXPECT_EQ(test, percpu_counter_tree_compare(&pct, count - 1), 1);
+		KUNIT_EXPECT_EQ(test, percpu_counter_tree_compare(&pct, count + 1), -1);
+		percpu_counter_tree_add(&pct, 1);
+	}
+
+	percpu_counter_tree_destroy(&pct);
+}
+
+static void percpu_counter_tree_test_limited_add(struct kunit *test)
+{
+	struct percpu_counter_tree pct;
+	long limit = 100000;
+	long count = 0;
+
+	KUNIT_ASSERT_EQ(test, percpu_counter_tree_init(&pct, 0, 0, GFP_KERNEL), 0);
+
+	while (percpu_counter_tree_limited_add(&pct, limit, 7))
+		count += 7;
+	KUNIT_EXPECT_EQ(test, count, limit - limit % 7);
+	KUNIT_EXPECT_EQ(test, percpu_counter_tree_sum(&pct), count);
+
+	KUNIT_EXPECT_FALSE(test, percpu_counter_tree_limited_add(&pct, 0, -count - 1));
+	KUNIT_EXPECT_TRUE(test, percpu_counter_tree_limited_add(&pct, 0, -count));
+	expect_bounded(test, &pct, 0);
+
+	percpu_counter_tree_destroy(&pct);
+}
+
+static void cpu_add_workfn(struct work_struct *work)
+{
+	int i;
+
+	for (i = 0; i < NR_CPU_ADDS; i++)
+		percpu_counter_tree_add(cpu_pct, 3);
+	atomic_inc(&cpu_adders);
+}
+
+static void percpu_counter_tree_test_cpus(struct kunit *test)
+{
+	struct percpu_counter_tree pct;
+
+	KUNIT_ASSERT_EQ(test, percpu_counter_tree_init(&pct, 0, 0, GFP_KERNEL), 0);
+
+	cpu_pct = &pct;
+	atomic_set(&cpu_adders, 0);
+	KUNIT_ASSERT_EQ(test, schedule_on_each_cpu(cpu_add_workfn), 0);
+
+	expect_bounded(test, &pct, 3L * NR_CPU_ADDS * atomic_read(&cpu_adders));
+
+	percpu_counter_tree_destroy(&pct);
+}
+
+static void percpu_counter_tree_bench(struct kunit *test)
+{
+	struct percpu_counter_tree pct;
+	struct percpu_counter fbc;
+	ktime_t start;
+	u64 ns[4];
+	int i;
+
+	KUNIT_ASSERT_EQ(test, percpu_counter_tree_init(&pct, 0, 0, GFP_KERNEL), 0);
+	KUNIT_ASSERT_EQ(test, percpu_counter_init(&fbc, 0, GFP_KERNEL), 0);
+
+	start = ktime_get();
+	for (i = 0; i < NR_BENCH_OPS; i++)
+		percpu_counter_add(&fbc, 1);
+	ns[0] = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	start = ktime_get();
+	for (i = 0; i < NR_BENCH_OPS; i++)
+		percpu_counter_tree_add(&pct, 1);
+	ns[1] = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	/* Compare within the flat error bound, where the flat counter has to sum */
+	start = ktime_get();
+	for (i = 0; i < NR_BENCH_OPS / 64; i++)
+		percpu_counter_compare(&fbc, NR_BENCH_OPS + percpu_counter_batch);
+	ns[2] = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	start = ktime_get();
+	for (i = 0; i < NR_BENCH_OPS / 64; i++)
+		percpu_counter_tree_compare(&pct, NR_BENCH_OPS + pct.accuracy);
+	ns[3] = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	kunit_info(test, "%u CPUs, add: flat %llu ns, tree %llu ns (per %d ops)\n",
+		   num_online_cpus(), ns[0], ns[1], NR_BENCH_OPS);
+	kunit_info(test, "compare near value: flat %llu ns, tree %llu ns (per %d ops)\n",
+		   ns[2], ns[3], NR_BENCH_OPS / 64);
+	kunit_info(test, "error bound: flat %lld, tree %ld\n",
+		   (s64)percpu_counter_batch * num_online_cpus(), pct.accuracy);
+
+	percpu_counter_destroy(&fbc);
+	percpu_counter_tree_destroy(&pct);
+}
+
+static struct kunit_case percpu_counter_tree_test_cases[] = {
+	KUNIT_CASE(percpu_counter_tree_test_add),
+	KUNIT_CASE(percpu_counter_tree_test_compare),
+	KUNIT_CASE(percpu_counter_tree_test_limited_add),
+	KUNIT_CASE(percpu_counter_tree_test_cpus),
+	KUNIT_CASE_SLOW(percpu_counter_tree_bench),
+	{}
+};
+
+static struct kunit_suite percpu_counter_tree_test_suite = {
+	.name = "percpu_counter_tree",
+	.test_cases = percpu_counter_tree_test_cases,
+};
+
+kunit_test_suite(percpu_counter_tree_test_suite);
+
+MODULE_DESCRIPTION("KUnit tests for hierarchical percpu counters");
+MODULE_LICENSE("GPL");
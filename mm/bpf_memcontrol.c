@@ -159,6 +159,22 @@ __bpf_kfunc void bpf_mem_cgroup_flush_stats(struct mem_cgroup *memcg)
 	mem_cgroup_flush_stats(memcg);
 }
 
+/**
+ * bpf_mem_cgroup_flush_stats_bounded - Flush memory cgroup's statistics if stale
+ * @memcg: memory cgroup
+ * @max_age: accepted age of the statistics in milliseconds
+ *
+ * Propagate memory cgroup's statistics up the cgroup tree unless they were
+ * propagated less than @max_age milliseconds ago.
+ *
+ * Returns the age of the statistics in milliseconds.
+ */
+__bpf_kfunc u32 bpf_mem_cgroup_flush_stats_bounded(struct mem_cgroup *memcg,
+						   u32 max_age)
+{
+	return mem_cgroup_flush_stats_bounded(memcg, max_age);
+}
+
 __bpf_kfunc_end_defs();
 
 BTF_KFUNCS_START(bpf_memcontrol_kfuncs)
@@ -171,6 +187,7 @@ BTF_ID_FLAGS(func, bpf_mem_cgroup_memory_events)
 BTF_ID_FLAGS(func, bpf_mem_cgroup_usage)
 BTF_ID_FLAGS(func, bpf_mem_cgroup_page_state)
 BTF_ID_FLAGS(func, bpf_mem_cgroup_flush_stats, KF_SLEEPABLE)
+BTF_ID_FLAGS(func, bpf_mem_cgroup_flush_stats_bounded, KF_SLEEPABLE)
 
 BTF_KFUNCS_END(bpf_memcontrol_kfuncs)
 
@@ -24,6 +24,7 @@
 #include <linux/page_owner.h>
 #include <linux/psi.h>
 #include <linux/cpuset.h>
+#include <linux/workqueue.h>
 #include "internal.h"
 
 #ifdef CONFIG_COMPACTION
@@ -32,6 +33,9 @@
  */
 #define HPAGE_FRAG_CHECK_INTERVAL_MSEC	(500)
 
+/* Upper limit of a node's compact_workers */
+#define KCOMPACTD_MAX_WORKERS	8
+
 static inline void count_compact_event(enum vm_event_item item)
 {
 	count_vm_event(item);
@@ -2248,6 +2252,35 @@ static bool should_proactive_compact_node(pg_data_t *pgdat)
 	return fragmentation_score_node(pgdat) > wmark_high;
 }
 
+/* Number of free blocks of @order on @pgdat, counting larger ones as several */
+static unsigned long node_free_blocks(pg_data_t *pgdat, unsigned int order)
+{
+	unsigned long nr = 0;
+	int zoneid, o;
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+		for (o = order; o < NR_PAGE_ORDERS; o++)
+			nr += data_race(zone->free_area[o].nr_free) << (o - order);
+	}
+
+	return nr;
+}
+
+static bool should_target_compact_node(pg_data_t *pgdat)
+{
+	unsigned long target_nr = READ_ONCE(pgdat->kcompactd_target_nr);
+
+	if (!target_nr || kswapd_is_running(pgdat))
+		return false;
+
+	return node_free_blocks(pgdat,
+			READ_ONCE(pgdat->kcompactd_target_order)) < target_nr;
+}
+
 static enum compact_result __compact_finished(struct compact_control *cc)
 {
 	unsigned int order;
@@ -2274,6 +2307,20 @@ static enum compact_result __compact_finished(struct compact_control *cc)
 			return COMPACT_PARTIAL_SKIPPED;
 	}
 
+	if (cc->target_nr) {
+		pg_data_t *pgdat = cc->zone->zone_pgdat;
+
+		if (kswapd_is_running(pgdat))
+			return COMPACT_PARTIAL_SKIPPED;
+
+		if (node_free_blocks(pgdat, cc->target_order) < cc->target_nr)
+			ret = COMPACT_CONTINUE;
+		else
+			ret = COMPACT_SUCCESS;
+
+		goto out;
+	}
+
 	if (cc->proactive_compaction) {
 		int score, wmark_low;
 		pg_data_t *pgdat;
@@ -2555,6 +2602,11 @@ compact_zone(struct compact_control *cc, struct capture_control *capc)
 
 	cc->migratetype = gfp_migratetype(cc->gfp_mask);
 
+	if (cc->range_end_pfn) {
+		start_pfn = max(start_pfn, cc->range_start_pfn);
+		end_pfn = min(end_pfn, cc->range_end_pfn);
+	}
+
 	if (!is_via_compact_memory(cc->order)) {
 		ret = compaction_suit_allocation_order(cc->zone, cc->order,
 						       cc->highest_zoneidx,
@@ -3031,14 +3083,114 @@ static ssize_t compact_store(struct device *dev,
 }
 static DEVICE_ATTR_WO(compact);
 
+/* Have kcompactd look at a new free block target right away */
+static void kcompactd_target_changed(pg_data_t *pgdat)
+{
+	if (!pgdat->kcompactd || !READ_ONCE(pgdat->kcompactd_target_nr))
+		return;
+
+	pgdat->proactive_compact_trigger = true;
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+static ssize_t compact_workers_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n",
+			  max(READ_ONCE(NODE_DATA(dev->id)->kcompactd_workers), 1U));
+}
+
+static ssize_t compact_workers_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	unsigned int nr_workers;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &nr_workers);
+	if (ret)
+		return ret;
+	if (!nr_workers || nr_workers > KCOMPACTD_MAX_WORKERS)
+		return -EINVAL;
+
+	WRITE_ONCE(NODE_DATA(dev->id)->kcompactd_workers, nr_workers);
+	return count;
+}
+static DEVICE_ATTR_RW(compact_workers);
+
+static ssize_t compact_target_order_show(struct device *dev,
+					 struct device_attribute *attr,
+					 char *buf)
+{
+	return sysfs_emit(buf, "%u\n",
+			  READ_ONCE(NODE_DATA(dev->id)->kcompactd_target_order));
+}
+
+static ssize_t compact_target_order_store(struct device *dev,
+					  struct device_attribute *attr,
+					  const char *buf, size_t count)
+{
+	pg_data_t *pgdat = NODE_DATA(dev->id);
+	unsigned int order;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &order);
+	if (ret)
+		return ret;
+	if (order > MAX_PAGE_ORDER)
+		return -EINVAL;
+
+	WRITE_ONCE(pgdat->kcompactd_target_order, order);
+	kcompactd_target_changed(pgdat);
+	return count;
+}
+static DEVICE_ATTR_RW(compact_target_order);
+
+static ssize_t compact_target_nr_show(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%lu\n",
+			  READ_ONCE(NODE_DATA(dev->id)->kcompactd_target_nr));
+}
+
+static ssize_t compact_target_nr_store(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t count)
+{
+	pg_data_t *pgdat = NODE_DATA(dev->id);
+	unsigned long nr;
+	int ret;
+
+	ret = kstrtoul(buf, 0, &nr);
+	if (ret)
+		return ret;
+
+	WRITE_ONCE(pgdat->kcompactd_target_nr, nr);
+	kcompactd_target_changed(pgdat);
+	return count;
+}
+static DEVICE_ATTR_RW(compact_target_nr);
+
+static struct attribute *compaction_node_attrs[] = {
+	&dev_attr_compact.attr,
+	&dev_attr_compact_workers.attr,
+	&dev_attr_compact_target_order.attr,
+	&dev_attr_compact_target_nr.attr,
+	NULL,
+};
+
+static const struct attribute_group compaction_node_group = {
+	.attrs = compaction_node_attrs,
+};
+
 int compaction_register_node(struct node *node)
 {
-	return device_create_file(&node->dev, &dev_attr_compact);
+	return sysfs_create_group(&node->dev.kobj, &compaction_node_group);
 }
 
 void compaction_unregister_node(struct node *node)
 {
-	device_remove_file(&node->dev, &dev_attr_compact);
+	sysfs_remove_group(&node->dev.kobj, &compaction_node_group);
 }
 #endif /* CONFIG_SYSFS && CONFIG_NUMA */
 
@@ -3180,6 +3332,122 @@ void wakeup_kcompactd(pg_data_t *pgdat, int order, int highest_zoneidx)
 	wake_up_interruptible(&pgdat->kcompactd_wait);
 }
 
+/* One of the disjoint pfn ranges a zone is cut into for parallel compaction */
+struct kcompactd_slice {
+	struct work_struct work;
+	struct zone *zone;
+	unsigned long start_pfn;
+	unsigned long end_pfn;
+	unsigned int target_order;
+	unsigned long target_nr;
+};
+
+static void kcompactd_compact_slice(struct kcompactd_slice *slice)
+{
+	struct compact_control cc = {
+		.order = -1,
+		.mode = MIGRATE_SYNC_LIGHT,
+		.ignore_skip_hint = true,
+		.whole_zone = true,
+		.gfp_mask = GFP_KERNEL,
+		.zone = slice->zone,
+		.range_start_pfn = slice->start_pfn,
+		.range_end_pfn = slice->end_pfn,
+		.target_order = slice->target_order,
+		.target_nr = slice->target_nr,
+	};
+
+	compact_zone(&cc, NULL);
+
+	count_compact_events(KCOMPACTD_WORKER_MIGRATE_SCANNED,
+			     cc.total_migrate_scanned);
+	count_compact_events(KCOMPACTD_WORKER_FREE_SCANNED,
+			     cc.total_free_scanned);
+}
+
+static void kcompactd_slice_workfn(struct work_struct *work)
+{
+	struct kcompactd_slice *slice = container_of(work,
+					struct kcompactd_slice, work);
+
+	/* Behave like kcompactd towards filesystems while compacting for it */
+	current->flags |= PF_KCOMPACTD;
+	kcompactd_compact_slice(slice);
+	current->flags &= ~PF_KCOMPACTD;
+}
+
+/*
+ * Compact @pgdat until it has the number of free blocks of the order set
+ * through the node's compact_target_* files. Each zone is cut into up to
+ * compact_workers disjoint ranges, aligned to the target order, and each
+ * range is compacted on its own: kcompactd takes the first one and workers
+ * on this node the others. Returns true if free blocks were gained.
+ */
+static bool kcompactd_compact_target(pg_data_t *pgdat)
+{
+	struct kcompactd_slice slices[KCOMPACTD_MAX_WORKERS];
+	unsigned int nr_workers = clamp(READ_ONCE(pgdat->kcompactd_workers),
+					1U, KCOMPACTD_MAX_WORKERS);
+	unsigned int order = READ_ONCE(pgdat->kcompactd_target_order);
+	unsigned long target_nr = READ_ONCE(pgdat->kcompactd_target_nr);
+	unsigned long align = max_t(unsigned long, pageblock_nr_pages,
+				    1UL << order);
+	unsigned long nr_free, prev_free;
+	int zoneid, i, nr;
+
+	prev_free = node_free_blocks(pgdat, order);
+	count_compact_event(KCOMPACTD_TARGET_WAKE);
+
+	for (zoneid = 0; zoneid < pgdat->nr_zones; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+		unsigned long pfn, next, chunk;
+
+		if (!populated_zone(zone))
+			continue;
+
+		if (kthread_should_stop() ||
+		    node_free_blocks(pgdat, order) >= target_nr)
+			break;
+
+		chunk = ALIGN(DIV_ROUND_UP(zone->spanned_pages, nr_workers),
+			      align);
+		for (nr = 0, pfn = zone->zone_start_pfn; pfn < zone_end_pfn(zone);
+		     nr++, pfn = next) {
+			next = zone_end_pfn(zone);
+			if (nr < nr_workers - 1)
+				next = min(ALIGN_DOWN(pfn + chunk, align), next);
+
+			slices[nr].zone = zone;
+			slices[nr].start_pfn = pfn;
+			slices[nr].end_pfn = next;
+			slices[nr].target_order = order;
+			slices[nr].target_nr = target_nr;
+		}
+
+		for (i = 1; i < nr; i++) {
+			INIT_WORK_ONSTACK(&slices[i].work, kcompactd_slice_workfn);
+			queue_work_node(pgdat->node_id, system_dfl_long_wq,
+					&slices[i].work);
+		}
+
+		kcompactd_compact_slice(&slices[0]);
+
+		for (i = 1; i < nr; i++) {
+			flush_work(&slices[i].work);
+			destroy_work_on_stack(&slices[i].work);
+		}
+
+		/* Let the pages freed by migration merge in the free lists */
+		drain_all_pages(zone);
+	}
+
+	nr_free = node_free_blocks(pgdat, order);
+	if (nr_free >= target_nr)
+		count_compact_event(KCOMPACTD_TARGET_MET);
+
+	return nr_free > prev_free;
+}
+
 /*
  * The background compaction daemon, started as a kernel thread
  * from the init process.
@@ -3203,7 +3471,8 @@ static int kcompactd(void *p)
 		 * Avoid the unnecessary wakeup for proactive compaction
 		 * when it is disabled.
 		 */
-		if (!sysctl_compaction_proactiveness)
+		if (!sysctl_compaction_proactiveness &&
+		    !READ_ONCE(pgdat->kcompactd_target_nr))
 			timeout = MAX_SCHEDULE_TIMEOUT;
 		trace_mm_compaction_kcompactd_sleep(pgdat->node_id);
 		if (wait_event_freezable_timeout(pgdat->kcompactd_wait,
@@ -3243,6 +3512,10 @@ static int kcompactd(void *p)
 				timeout =
 				   default_timeout << COMPACT_MAX_DEFER_SHIFT;
 		}
+		/* Likewise when the free block target cannot be approached */
+		if (should_target_compact_node(pgdat) &&
+		    !kcompactd_compact_target(pgdat))
+			timeout = default_timeout << COMPACT_MAX_DEFER_SHIFT;
 		if (unlikely(pgdat->proactive_compact_trigger))
 			pgdat->proactive_compact_trigger = false;
 	}
@@ -1052,6 +1052,12 @@ struct compact_control {
 					 * ensure forward progress.
 					 */
 	bool alloc_contig;		/* alloc_contig_range allocation */
+	/* Whole-zone scan limited to this pfn range, if range_end_pfn set */
+	unsigned long range_start_pfn;
+	unsigned long range_end_pfn;
+	/* kcompactd: stop once the node has this many free target_order blocks */
+	unsigned long target_nr;
+	unsigned int target_order;
 };
 
 /*
@@ -74,7 +74,7 @@ static DEFINE_MUTEX(khugepaged_mutex);
  * no_pte_table or vmas every 10 second.
  */
 static unsigned int khugepaged_pages_to_scan __read_mostly;
-static unsigned int khugepaged_pages_collapsed;
+static atomic_t khugepaged_pages_collapsed;
 static unsigned int khugepaged_full_scans;
 static unsigned int khugepaged_scan_sleep_millisecs __read_mostly = 10000;
 /* during fragmentation poll the hugepage allocator once every minute */
@@ -101,6 +101,14 @@ static struct kmem_cache *mm_slot_cache __ro_after_init;
 
 #define KHUGEPAGED_MIN_MTHP_ORDER	2
 
+/*
+ * khugepaged itself plus up to KHUGEPAGED_MAX_SCAN_THREADS - 1 helpers, each
+ * scanning a different mm off the shared list.
+ */
+#define KHUGEPAGED_MAX_SCAN_THREADS	8
+static unsigned int khugepaged_scan_threads __read_mostly = 1;
+static int khugepaged_set_scan_threads(unsigned int nr_threads);
+
 struct collapse_control {
 	bool is_khugepaged;
 
@@ -120,21 +128,44 @@ struct collapse_control {
 /**
  * struct khugepaged_scan - cursor for scanning
  * @mm_head: the head of the mm list to scan
- * @mm_slot: the current mm_slot we are scanning
- * @address: the next address inside that to be scanned
+ * @mm_slot: the next mm_slot to hand out to a scanning thread
  *
  * There is only the one khugepaged_scan instance of this cursor structure.
  */
 struct khugepaged_scan {
 	struct list_head mm_head;
 	struct mm_slot *mm_slot;
-	unsigned long address;
 };
 
 static struct khugepaged_scan khugepaged_scan = {
 	.mm_head = LIST_HEAD_INIT(khugepaged_scan.mm_head),
 };
 
+/**
+ * struct khugepaged_worker - state of one scanning thread
+ * @task: the thread, NULL if not running
+ * @mm_slot: the mm_slot this thread is scanning, NULL between mms
+ * @address: the next address inside that to be scanned
+ * @cc: the collapse control of this thread
+ *
+ * Entry 0 is khugepaged itself, the others are helpers started according to
+ * khugepaged_scan_threads. @mm_slot is protected by khugepaged_mm_lock.
+ */
+struct khugepaged_worker {
+	struct task_struct *task;
+	struct mm_slot *mm_slot;
+	unsigned long address;
+	struct collapse_control *cc;
+};
+
+static struct collapse_control khugepaged_collapse_control = {
+	.is_khugepaged = true,
+};
+
+static struct khugepaged_worker khugepaged_workers[KHUGEPAGED_MAX_SCAN_THREADS] = {
+	[0] = { .cc = &khugepaged_collapse_control },
+};
+
 #ifdef CONFIG_SYSFS
 static ssize_t scan_sleep_millisecs_show(struct kobject *kobj,
 					 struct kobj_attribute *attr,
@@ -213,7 +244,7 @@ static ssize_t pages_collapsed_show(struct kobject *kobj,
 				    struct kobj_attribute *attr,
 				    char *buf)
 {
-	return sysfs_emit(buf, "%u\n", khugepaged_pages_collapsed);
+	return sysfs_emit(buf, "%u\n", atomic_read(&khugepaged_pages_collapsed));
 }
 static struct kobj_attribute pages_collapsed_attr =
 	__ATTR_RO(pages_collapsed);
@@ -227,6 +258,34 @@ static ssize_t full_scans_show(struct kobject *kobj,
 static struct kobj_attribute full_scans_attr =
 	__ATTR_RO(full_scans);
 
+static ssize_t scan_threads_show(struct kobject *kobj,
+				 struct kobj_attribute *attr,
+				 char *buf)
+{
+	return sysfs_emit(buf, "%u\n", READ_ONCE(khugepaged_scan_threads));
+}
+static ssize_t scan_threads_store(struct kobject *kobj,
+				  struct kobj_attribute *attr,
+				  const char *buf, size_t count)
+{
+	unsigned int nr_threads;
+	int err;
+
+	err = kstrtouint(buf, 10, &nr_threads);
+	if (err || !nr_threads || nr_threads > KHUGEPAGED_MAX_SCAN_THREADS)
+		return -EINVAL;
+
+	mutex_lock(&khugepaged_mutex);
+	WRITE_ONCE(khugepaged_scan_threads, nr_threads);
+	if (khugepaged_thread)
+		err = khugepaged_set_scan_threads(nr_threads);
+	mutex_unlock(&khugepaged_mutex);
+
+	return err ? err : count;
+}
+static struct kobj_attribute scan_threads_attr =
+	__ATTR_RW(scan_threads);
+
 static ssize_t defrag_show(struct kobject *kobj,
 			   struct kobj_attribute *attr, char *buf)
 {
@@ -335,6 +394,7 @@ static struct attribute *khugepaged_attr[] = {
 	&pages_to_scan_attr.attr,
 	&pages_collapsed_attr.attr,
 	&full_scans_attr.attr,
+	&scan_threads_attr.attr,
 	&scan_sleep_millisecs_attr.attr,
 	&alloc_sleep_millisecs_attr.attr,
 	NULL,
@@ -597,6 +657,31 @@ void khugepaged_enter_vma(struct vm_area_struct *vma,
 		__khugepaged_enter(vma->vm_mm);
 }
 
+/* Is any scanning thread working on @slot? */
+static bool khugepaged_slot_busy(struct mm_slot *slot)
+{
+	int i;
+
+	lockdep_assert_held(&khugepaged_mm_lock);
+
+	for (i = 0; i < KHUGEPAGED_MAX_SCAN_THREADS; i++) {
+		if (khugepaged_workers[i].mm_slot == slot)
+			return true;
+	}
+	return false;
+}
+
+/* Move the hand-out cursor past @slot, before it is removed or claimed */
+static void khugepaged_scan_advance(struct mm_slot *slot)
+{
+	lockdep_assert_held(&khugepaged_mm_lock);
+
+	if (!list_is_last(&slot->mm_node, &khugepaged_scan.mm_head))
+		khugepaged_scan.mm_slot = list_next_entry(slot, mm_node);
+	else
+		khugepaged_scan.mm_slot = NULL;
+}
+
 void __khugepaged_exit(struct mm_struct *mm)
 {
 	struct mm_slot *slot;
@@ -604,7 +689,9 @@ void __khugepaged_exit(struct mm_struct *mm)
 
 	spin_lock(&khugepaged_mm_lock);
 	slot = mm_slot_lookup(mm_slots_hash, mm);
-	if (slot && khugepaged_scan.mm_slot != slot) {
+	if (slot && !khugepaged_slot_busy(slot)) {
+		if (khugepaged_scan.mm_slot == slot)
+			khugepaged_scan_advance(slot);
 		hash_del(&slot->hash);
 		list_del(&slot->mm_node);
 		free = 1;
@@ -979,10 +1066,6 @@ static void khugepaged_alloc_sleep(void)
 	remove_wait_queue(&khugepaged_wait, &wait);
 }
 
-static struct collapse_control khugepaged_collapse_control = {
-	.is_khugepaged = true,
-};
-
 static bool collapse_scan_abort(int nid, struct collapse_control *cc)
 {
 	int i;
@@ -1801,6 +1884,8 @@ static void collect_mm_slot(struct mm_slot *slot)
 
 	if (collapse_test_exit(mm)) {
 		/* free mm_slot */
+		if (khugepaged_scan.mm_slot == slot)
+			khugepaged_scan_advance(slot);
 		hash_del(&slot->hash);
 		list_del(&slot->mm_node);
 
@@ -2835,32 +2920,51 @@ static enum scan_result collapse_single_pmd(unsigned long addr,
 	}
 end:
 	if (cc->is_khugepaged && result == SCAN_SUCCEED)
-		++khugepaged_pages_collapsed;
+		atomic_inc(&khugepaged_pages_collapsed);
 	return result;
 }
 
+/* Pick the next mm on the list that no other thread is scanning */
+static struct mm_slot *khugepaged_claim_mm_slot(struct khugepaged_worker *w)
+{
+	struct mm_slot *slot;
+	int i;
+
+	lockdep_assert_held(&khugepaged_mm_lock);
+
+	if (w->mm_slot)
+		return w->mm_slot;
+
+	/* Every other thread holds at most one mm, so this many tries do */
+	for (i = 0; i < KHUGEPAGED_MAX_SCAN_THREADS; i++) {
+		slot = khugepaged_scan.mm_slot ?:
+		       list_first_entry(&khugepaged_scan.mm_head,
+					struct mm_slot, mm_node);
+		khugepaged_scan_advance(slot);
+		if (!khugepaged_slot_busy(slot)) {
+			w->mm_slot = slot;
+			w->address = 0;
+			return slot;
+		}
+	}
+	return NULL;
+}
+
 static void collapse_scan_mm_slot(unsigned int progress_max,
-		enum scan_result *result, struct collapse_control *cc)
+		enum scan_result *result, struct khugepaged_worker *w)
 	__releases(&khugepaged_mm_lock)
 	__acquires(&khugepaged_mm_lock)
 {
+	struct collapse_control *cc = w->cc;
+	struct mm_slot *slot = w->mm_slot;
 	struct vma_iterator vmi;
-	struct mm_slot *slot;
 	struct mm_struct *mm;
 	struct vm_area_struct *vma;
 	unsigned int progress_prev = cc->progress;
+	bool full_scan = false;
 
 	lockdep_assert_held(&khugepaged_mm_lock);
 	*result = SCAN_FAIL;
-
-	if (khugepaged_scan.mm_slot) {
-		slot = khugepaged_scan.mm_slot;
-	} else {
-		slot = list_first_entry(&khugepaged_scan.mm_head,
-				     struct mm_slot, mm_node);
-		khugepaged_scan.address = 0;
-		khugepaged_scan.mm_slot = slot;
-	}
 	spin_unlock(&khugepaged_mm_lock);
 
 	mm = slot->mm;
@@ -2876,7 +2980,7 @@ static void collapse_scan_mm_slot(unsigned int progress_max,
 	if (unlikely(collapse_test_exit_or_disable(mm)))
 		goto breakouterloop;
 
-	vma_iter_init(&vmi, mm, khugepaged_scan.address);
+	vma_iter_init(&vmi, mm, w->address);
 	for_each_vma(vmi, vma) {
 		unsigned long hstart, hend;
 
@@ -2891,29 +2995,28 @@ static void collapse_scan_mm_slot(unsigned int progress_max,
 		}
 		hstart = ALIGN(vma->vm_start, HPAGE_PMD_SIZE);
 		hend = ALIGN_DOWN(vma->vm_end, HPAGE_PMD_SIZE);
-		if (khugepaged_scan.address > hend) {
+		if (w->address > hend) {
 			cc->progress++;
 			continue;
 		}
-		if (khugepaged_scan.address < hstart)
-			khugepaged_scan.address = hstart;
-		VM_BUG_ON(khugepaged_scan.address & ~HPAGE_PMD_MASK);
+		if (w->address < hstart)
+			w->address = hstart;
+		VM_BUG_ON(w->address & ~HPAGE_PMD_MASK);
 
-		while (khugepaged_scan.address < hend) {
+		while (w->address < hend) {
 			bool lock_dropped = false;
 
 			cond_resched();
 			if (unlikely(collapse_test_exit_or_disable(mm)))
 				goto breakouterloop;
 
-			VM_WARN_ON_ONCE(khugepaged_scan.address < hstart ||
-				  khugepaged_scan.address + HPAGE_PMD_SIZE >
-				  hend);
+			VM_WARN_ON_ONCE(w->address < hstart ||
+				  w->address + HPAGE_PMD_SIZE > hend);
 
-			*result = collapse_single_pmd(khugepaged_scan.address,
+			*result = collapse_single_pmd(w->address,
 						      vma, &lock_dropped, cc);
 			/* move to next address */
-			khugepaged_scan.address += HPAGE_PMD_SIZE;
+			w->address += HPAGE_PMD_SIZE;
 			if (lock_dropped)
 				/*
 				 * We released mmap_lock so break loop.  Note
@@ -2932,30 +3035,26 @@ static void collapse_scan_mm_slot(unsigned int progress_max,
 breakouterloop_mmap_lock:
 
 	spin_lock(&khugepaged_mm_lock);
-	VM_BUG_ON(khugepaged_scan.mm_slot != slot);
+	VM_BUG_ON(w->mm_slot != slot);
 	/*
 	 * Release the current mm_slot if this mm is about to die, or
 	 * if we scanned all vmas of this mm, or THP got disabled.
 	 */
 	if (collapse_test_exit_or_disable(mm) || !vma) {
+		if (list_is_last(&slot->mm_node, &khugepaged_scan.mm_head)) {
+			khugepaged_full_scans++;
+			full_scan = true;
+		}
 		/*
 		 * Make sure that if mm_users is reaching zero while
 		 * khugepaged runs here, khugepaged_exit will find
-		 * mm_slot not pointing to the exiting mm.
+		 * no thread pointing to the exiting mm.
 		 */
-		if (!list_is_last(&slot->mm_node, &khugepaged_scan.mm_head)) {
-			khugepaged_scan.mm_slot = list_next_entry(slot, mm_node);
-			khugepaged_scan.address = 0;
-		} else {
-			khugepaged_scan.mm_slot = NULL;
-			khugepaged_full_scans++;
-		}
-
+		w->mm_slot = NULL;
 		collect_mm_slot(slot);
 	}
 
-	trace_mm_khugepaged_scan(mm, cc->progress - progress_prev,
-				 khugepaged_scan.mm_slot == NULL);
+	trace_mm_khugepaged_scan(mm, cc->progress - progress_prev, full_scan);
 }
 
 static int khugepaged_has_work(void)
@@ -2969,9 +3068,10 @@ static int khugepaged_wait_event(void)
 		kthread_should_stop();
 }
 
-static void khugepaged_do_scan(struct collapse_control *cc)
+static void khugepaged_do_scan(struct khugepaged_worker *w)
 {
 	const unsigned int progress_max = READ_ONCE(khugepaged_pages_to_scan);
+	struct collapse_control *cc = w->cc;
 	unsigned int pass_through_head = 0;
 	bool wait = true;
 	enum scan_result result = SCAN_SUCCEED;
@@ -2986,11 +3086,12 @@ static void khugepaged_do_scan(struct collapse_control *cc)
 			break;
 
 		spin_lock(&khugepaged_mm_lock);
-		if (!khugepaged_scan.mm_slot)
+		if (!w->mm_slot && !khugepaged_scan.mm_slot)
 			pass_through_head++;
 		if (khugepaged_has_work() &&
-		    pass_through_head < 2)
-			collapse_scan_mm_slot(progress_max, &result, cc);
+		    pass_through_head < 2 &&
+		    khugepaged_claim_mm_slot(w))
+			collapse_scan_mm_slot(progress_max, &result, w);
 		else
 			cc->progress = progress_max;
 		spin_unlock(&khugepaged_mm_lock);
@@ -3037,27 +3138,74 @@ static void khugepaged_wait_work(void)
 		wait_event_freezable(khugepaged_wait, khugepaged_wait_event());
 }
 
-static int khugepaged(void *none)
+static int khugepaged(void *data)
 {
+	struct khugepaged_worker *w = data;
 	struct mm_slot *slot;
 
 	set_freezable();
 	set_user_nice(current, MAX_NICE);
 
 	while (!kthread_should_stop()) {
-		khugepaged_do_scan(&khugepaged_collapse_control);
+		khugepaged_do_scan(w);
 		khugepaged_wait_work();
 	}
 
 	spin_lock(&khugepaged_mm_lock);
-	slot = khugepaged_scan.mm_slot;
-	khugepaged_scan.mm_slot = NULL;
+	slot = w->mm_slot;
+	w->mm_slot = NULL;
 	if (slot)
 		collect_mm_slot(slot);
 	spin_unlock(&khugepaged_mm_lock);
 	return 0;
 }
 
+/*
+ * Start or stop the helper threads so that nr_threads threads, khugepaged
+ * included, scan the mm list. Called with khugepaged_mutex held.
+ */
+static int khugepaged_set_scan_threads(unsigned int nr_threads)
+{
+	struct khugepaged_worker *w;
+	unsigned int i;
+	int err = 0;
+
+	lockdep_assert_held(&khugepaged_mutex);
+
+	for (i = 1; i < KHUGEPAGED_MAX_SCAN_THREADS; i++) {
+		w = &khugepaged_workers[i];
+
+		if (i >= nr_threads) {
+			if (!w->task)
+				continue;
+			kthread_stop(w->task);
+			w->task = NULL;
+			kfree(w->cc);
+			w->cc = NULL;
+			continue;
+		}
+		if (w->task || err)
+			continue;
+
+		w->cc = kzalloc_obj(*w->cc);
+		if (!w->cc) {
+			err = -ENOMEM;
+			continue;
+		}
+		w->cc->is_khugepaged = true;
+		w->task = kthread_run(khugepaged, w, "khugepaged:%d", i);
+		if (IS_ERR(w->task)) {
+			err = PTR_ERR(w->task);
+			w->task = NULL;
+			kfree(w->cc);
+			w->cc = NULL;
+		}
+	}
+	if (err)
+		pr_err("khugepaged: failed to start scan threads: %d\n", err);
+	return err;
+}
+
 void set_recommended_min_free_kbytes(void)
 {
 	struct zone *zone;
@@ -3116,7 +3264,8 @@ int start_stop_khugepaged(void)
 	mutex_lock(&khugepaged_mutex);
 	if (hugepage_enabled()) {
 		if (!khugepaged_thread)
-			khugepaged_thread = kthread_run(khugepaged, NULL,
+			khugepaged_thread = kthread_run(khugepaged,
+							&khugepaged_workers[0],
 							"khugepaged");
 		if (IS_ERR(khugepaged_thread)) {
 			pr_err("khugepaged: kthread_run(khugepaged) failed\n");
@@ -3124,12 +3273,17 @@ int start_stop_khugepaged(void)
 			khugepaged_thread = NULL;
 			goto fail;
 		}
+		khugepaged_workers[0].task = khugepaged_thread;
+		/* The helpers are optional, khugepaged alone still makes progress */
+		khugepaged_set_scan_threads(khugepaged_scan_threads);
 
 		if (!list_empty(&khugepaged_scan.mm_head))
 			wake_up_interruptible(&khugepaged_wait);
 	} else if (khugepaged_thread) {
+		khugepaged_set_scan_threads(1);
 		kthread_stop(khugepaged_thread);
 		khugepaged_thread = NULL;
+		khugepaged_workers[0].task = NULL;
 	}
 	set_recommended_min_free_kbytes();
 fail:
@@ -29,6 +29,7 @@
 #include <linux/delay.h>
 #include <linux/kthread.h>
 #include <linux/wait.h>
+#include <linux/workqueue.h>
 #include <linux/slab.h>
 #include <linux/rbtree.h>
 #include <linux/memory.h>
@@ -40,6 +41,8 @@
 #include <linux/oom.h>
 #include <linux/numa.h>
 #include <linux/pagewalk.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -144,6 +147,47 @@ struct ksm_scan {
 	unsigned long seqnr;
 };
 
+/*
+ * ksmd gathers up to KSM_SCAN_BATCH pages at the ksm_scan cursor, has helpers
+ * on each node checksum the pages that live there, and only then goes through
+ * the stable and unstable trees with them one by one.
+ */
+#define KSM_SCAN_BATCH		256
+#define KSM_HASH_CHUNK		16
+#define KSM_MAX_SCAN_THREADS	8
+
+struct ksm_scan_item {
+	struct ksm_rmap_item *rmap_item;
+	struct page *page;
+	unsigned int checksum;
+	bool hashed;
+};
+
+struct ksm_hash_work {
+	struct work_struct work;
+	int nid;
+};
+
+/**
+ * struct ksm_node_scan - checksumming of the pages of one node in a batch
+ * @next: next index into ksm_scan_order[] to claim
+ * @start: first index of this node's pages in ksm_scan_order[]
+ * @end: index past the last of this node's pages in ksm_scan_order[]
+ * @nr_queued: number of @work queued for the current batch
+ * @pages_hashed: pages checksummed on this node so far
+ * @hash_ns: time spent checksumming them
+ * @work: the helpers of this node
+ */
+struct ksm_node_scan {
+	atomic_t next;
+	unsigned int start;
+	unsigned int end;
+	unsigned int nr_queued;
+	atomic_long_t pages_hashed;
+	atomic64_t hash_ns;
+	struct ksm_hash_work work[KSM_MAX_SCAN_THREADS];
+};
+
 /**
  * struct ksm_stable_node - node of the stable rbtree
  * @node: rb node of this ksm page in the stable tree
@@ -284,6 +328,17 @@ static unsigned int ksm_thread_pages_to_scan = DEFAULT_PAGES_TO_SCAN;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Number of helpers checksumming pages on each node for ksmd */
+static unsigned int ksm_scan_threads = 1;
+
+/* The batch being scanned by ksmd, see ksm_do_scan() */
+static struct ksm_scan_item ksm_scan_batch[KSM_SCAN_BATCH];
+static unsigned short ksm_scan_order[KSM_SCAN_BATCH];
+static struct ksm_node_scan *ksm_node_scan;	/* nr_node_ids entries */
+
+/* CPU time the helpers spent on behalf of ksmd, for the scan time advisor */
+static atomic64_t ksm_scan_helpers_ns = ATOMIC64_INIT(0);
+
 /* Checksum of an empty (zeroed) page */
 static unsigned int zero_checksum __read_mostly;
 
@@ -418,7 +473,8 @@ static void scan_time_advisor(void)
 	scan_time = scan_time ? scan_time : 1;
 
 	/* Calculate CPU consumption of ksmd background thread */
-	cpu_time = task_sched_runtime(current);
+	cpu_time = task_sched_runtime(current) +
+		   atomic64_read(&ksm_scan_helpers_ns);
 	cpu_time_diff = cpu_time - advisor_ctx.cpu_time;
 	cpu_time_diff_ms = cpu_time_diff / 1000 / 1000;
 
@@ -2248,8 +2304,10 @@ static void stable_tree_append(struct ksm_rmap_item *rmap_item,
  * @page: the page that we are searching identical page to.
  * @rmap_item: the reverse mapping into the virtual address of this page
  */
-static void cmp_and_merge_page(struct page *page, struct ksm_rmap_item *rmap_item)
+static void cmp_and_merge_page(struct ksm_scan_item *item)
 {
+	struct ksm_rmap_item *rmap_item = item->rmap_item;
+	struct page *page = item->page;
 	struct folio *folio = page_folio(page);
 	struct ksm_rmap_item *tree_rmap_item;
 	struct page *tree_page = NULL;
@@ -2286,7 +2344,7 @@ static void cmp_and_merge_page(struct page *page, struct ksm_rmap_item *rmap_ite
 		 * don't want to insert it in the unstable tree, and we don't want
 		 * to waste our time searching for something identical to it there.
 		 */
-		checksum = calc_checksum(page);
+		checksum = item->hashed ? item->checksum : calc_checksum(page);
 		if (rmap_item->oldchecksum != checksum) {
 			rmap_item->oldchecksum = checksum;
 			return;
@@ -2574,7 +2632,14 @@ static struct mm_walk_ops ksm_next_page_ops = {
 	.walk_lock = PGWALK_RDLOCK,
 };
 
-static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
+/*
+ * Returns the rmap_item and page at the ksm_scan cursor, and advances it.
+ * Returns NULL at the end of a full scan, and also at the end of the current
+ * mm if !@may_leave_mm: moving on frees the rmap_items of an mm that exited,
+ * which must not happen while the caller still has some of them in hand.
+ */
+static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page,
+						     bool may_leave_mm)
 {
 	struct mm_struct *mm;
 	struct ksm_mm_slot *mm_slot;
@@ -2650,7 +2715,7 @@ static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
 
 	mmap_read_lock(mm);
 	if (ksm_test_exit(mm))
-		goto no_vmas;
+		goto mm_end;
 
 	for_each_vma(vmi, vma) {
 		if (!(vma->vm_flags & VM_MERGEABLE))
@@ -2712,8 +2777,13 @@ static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
 		}
 	}
 
+mm_end:
+	if (!may_leave_mm) {
+		mmap_read_unlock(mm);
+		return NULL;
+	}
+
 	if (ksm_test_exit(mm)) {
-no_vmas:
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &mm_slot->rmap_list;
 	}
@@ -2776,23 +2846,148 @@ static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
 	return NULL;
 }
 
-/**
- * ksm_do_scan  - the ksm scanner main worker function.
- * @scan_npages:  number of pages we want to scan before we return.
+static void ksm_hash_node(int nid, bool helper)
+{
+	struct ksm_node_scan *ns = &ksm_node_scan[nid];
+	unsigned long nr_hashed = 0;
+	u64 start = local_clock();
+	unsigned int i, end;
+	u64 delta;
+
+	while ((i = atomic_fetch_add(KSM_HASH_CHUNK, &ns->next)) < ns->end) {
+		end = min(i + KSM_HASH_CHUNK, ns->end);
+		nr_hashed += end - i;
+		for (; i < end; i++) {
+			struct ksm_scan_item *item;
+
+			item = &ksm_scan_batch[ksm_scan_order[i]];
+			item->checksum = calc_checksum(item->page);
+			item->hashed = true;
+		}
+		cond_resched();
+	}
+
+	if (nr_hashed) {
+		delta = local_clock() - start;
+		atomic_long_add(nr_hashed, &ns->pages_hashed);
+		atomic64_add(delta, &ns->hash_ns);
+		if (helper)
+			atomic64_add(delta, &ksm_scan_helpers_ns);
+	}
+}
+
+static void ksm_hash_workfn(struct work_struct *work)
+{
+	struct ksm_hash_work *hw = container_of(work, struct ksm_hash_work, work);
+
+	ksm_hash_node(hw->nid, true);
+}
+
+/*
+ * Checksum the pages of the batch that cmp_and_merge_page() is going to need
+ * the checksum of, each by a helper on the node the page lives on. ksmd joins
+ * in, so the batch completes even if the helpers are slow to get CPU time.
  */
-static void ksm_do_scan(unsigned int scan_npages)
+static void ksm_hash_batch(unsigned int nr)
+{
+	unsigned int nr_threads = READ_ONCE(ksm_scan_threads);
+	unsigned int i, pos = 0;
+	int nid;
+
+	/* Group the pages by node, in ksm_scan_order[] */
+	for (nid = 0; nid < nr_node_ids; nid++)
+		ksm_node_scan[nid].end = 0;
+	for (i = 0; i < nr; i++) {
+		struct ksm_scan_item *item = &ksm_scan_batch[i];
+
+		if (folio_test_ksm(page_folio(item->page)))
+			continue;
+		ksm_node_scan[page_to_nid(item->page)].end++;
+	}
+	for (nid = 0; nid < nr_node_ids; nid++) {
+		struct ksm_node_scan *ns = &ksm_node_scan[nid];
+
+		ns->start = pos;
+		pos += ns->end;
+		ns->end = ns->start;
+	}
+	for (i = 0; i < nr; i++) {
+		struct ksm_scan_item *item = &ksm_scan_batch[i];
+
+		if (folio_test_ksm(page_folio(item->page)))
+			continue;
+		ksm_scan_order[ksm_node_scan[page_to_nid(item->page)].end++] = i;
+	}
+
+	for (nid = 0; nid < nr_node_ids; nid++) {
+		struct ksm_node_scan *ns = &ksm_node_scan[nid];
+		unsigned int nr_chunks = DIV_ROUND_UP(ns->end - ns->start,
+						      KSM_HASH_CHUNK);
+
+		atomic_set(&ns->next, ns->start);
+		/* Leave one chunk to ksmd */
+		ns->nr_queued = nr_chunks ? min(nr_threads, nr_chunks - 1) : 0;
+		for (i = 0; i < ns->nr_queued; i++)
+			queue_work_node(nid, system_dfl_wq, &ns->work[i].work);
+	}
+
+	for (nid = 0; nid < nr_node_ids; nid++)
+		ksm_hash_node(nid, false);
+
+	for (nid = 0; nid < nr_node_ids; nid++) {
+		struct ksm_node_scan *ns = &ksm_node_scan[nid];
+
+		for (i = 0; i < ns->nr_queued; i++)
+			flush_work(&ns->work[i].work);
+	}
+}
+
+/*
+ * Gather up to @max pages at the ksm_scan cursor into ksm_scan_batch[],
+ * stopping early at the end of an mm.
+ */
+static unsigned int ksm_scan_gather(unsigned int max)
 {
 	struct ksm_rmap_item *rmap_item;
+	unsigned int nr = 0;
 	struct page *page;
 
-	while (scan_npages-- && likely(!freezing(current))) {
+	while (nr < max) {
 		cond_resched();
-		rmap_item = scan_get_next_rmap_item(&page);
+		rmap_item = scan_get_next_rmap_item(&page, !nr);
 		if (!rmap_item)
+			break;
+		ksm_scan_batch[nr].rmap_item = rmap_item;
+		ksm_scan_batch[nr].page = page;
+		ksm_scan_batch[nr].hashed = false;
+		nr++;
+	}
+
+	return nr;
+}
+
+/**
+ * ksm_do_scan  - the ksm scanner main worker function.
+ * @scan_npages:  number of pages we want to scan before we return.
+ */
+static void ksm_do_scan(unsigned int scan_npages)
+{
+	unsigned int i, nr;
+
+	while (scan_npages && likely(!freezing(current))) {
+		nr = ksm_scan_gather(min(scan_npages, KSM_SCAN_BATCH));
+		if (!nr)
 			return;
-		cmp_and_merge_page(page, rmap_item);
-		put_page(page);
-		ksm_pages_scanned++;
+		scan_npages -= nr;
+
+		ksm_hash_batch(nr);
+
+		for (i = 0; i < nr; i++) {
+			cond_resched();
+			cmp_and_merge_page(&ksm_scan_batch[i]);
+			put_page(ksm_scan_batch[i].page);
+			ksm_pages_scanned++;
+		}
 	}
 }
 
@@ -3506,6 +3701,29 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t scan_threads_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", ksm_scan_threads);
+}
+
+static ssize_t scan_threads_store(struct kobject *kobj,
+				  struct kobj_attribute *attr,
+				  const char *buf, size_t count)
+{
+	unsigned int nr_threads;
+	int err;
+
+	err = kstrtouint(buf, 10, &nr_threads);
+	if (err || nr_threads > KSM_MAX_SCAN_THREADS)
+		return -EINVAL;
+
+	WRITE_ONCE(ksm_scan_threads, nr_threads);
+
+	return count;
+}
+KSM_ATTR(scan_threads);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -3941,6 +4159,7 @@ KSM_ATTR(advisor_target_scan_time);
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
+	&scan_threads_attr.attr,
 	&run_attr.attr,
 	&pages_scanned_attr.attr,
 	&pages_shared_attr.attr,
@@ -3974,6 +4193,26 @@ static const struct attribute_group ksm_attr_group = {
 };
 #endif /* CONFIG_SYSFS */
 
+static int __init ksm_scan_init(void)
+{
+	int nid, i;
+
+	ksm_node_scan = kcalloc(nr_node_ids, sizeof(*ksm_node_scan), GFP_KERNEL);
+	if (!ksm_node_scan)
+		return -ENOMEM;
+
+	for (nid = 0; nid < nr_node_ids; nid++) {
+		for (i = 0; i < KSM_MAX_SCAN_THREADS; i++) {
+			struct ksm_hash_work *hw = &ksm_node_scan[nid].work[i];
+
+			INIT_WORK(&hw->work, ksm_hash_workfn);
+			hw->nid = nid;
+		}
+	}
+
+	return 0;
+}
+
 static int __init ksm_init(void)
 {
 	struct task_struct *ksm_thread;
@@ -3988,6 +4227,10 @@ static int __init ksm_init(void)
 	if (err)
 		goto out;
 
+	err = ksm_scan_init();
+	if (err)
+		goto out_free;
+
 	ksm_thread = kthread_run(ksm_scan_thread, NULL, "ksmd");
 	if (IS_ERR(ksm_thread)) {
 		pr_err("ksm: creating kthread failed\n");
@@ -4014,8 +4257,43 @@ static int __init ksm_init(void)
 	return 0;
 
 out_free:
+	kfree(ksm_node_scan);
+	ksm_node_scan = NULL;
 	ksm_slab_free();
 out:
 	return err;
 }
 subsys_initcall(ksm_init);
+
+#ifdef CONFIG_DEBUG_FS
+/* Per node: "node<nid> <pages checksummed> <msecs spent checksumming>" */
+static int ksm_node_scan_stats_show(struct seq_file *m, void *v)
+{
+	int nid;
+
+	for_each_node_state(nid, N_MEMORY) {
+		struct ksm_node_scan *ns = &ksm_node_scan[nid];
+
+		seq_printf(m, "node%d %lu %llu\n", nid,
+			   atomic_long_read(&ns->pages_hashed),
+			   div_u64(atomic64_read(&ns->hash_ns), NSEC_PER_MSEC));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ksm_node_scan_stats);
+
+static int __init ksm_debugfs_init(void)
+{
+	struct dentry *root;
+
+	if (!ksm_node_scan)
+		return 0;
+
+	root = debugfs_create_dir("ksm", NULL);
+	debugfs_create_file("node_scan_stats", 0444, root, NULL,
+			    &ksm_node_scan_stats_fops);
+	return 0;
+}
+late_initcall(ksm_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
@@ -640,6 +640,9 @@ struct memcg_vmstats {
 
 	/* Stats updates since the last flush */
 	atomic_long_t		stats_updates;
+
+	/* jiffies_64 when this subtree was last flushed */
+	u64			flush_time;
 };
 
 /*
@@ -656,12 +659,18 @@ struct memcg_vmstats {
  *    (MEMCG_CHARGE_BATCH * nr_cpus) update events. Though this optimization
  *    will let stats be out of sync by atmost (MEMCG_CHARGE_BATCH * nr_cpus) but
  *    only for 2 seconds due to (1).
+ *
+ * 3) Readers that accept stats up to some age, memory.stat and memory.numa_stat
+ *    with the memory_stat_staleness mount option, skip the flush while the last
+ *    flush covering the memcg is recent enough. The periodic flusher then runs
+ *    at least twice per staleness period so that they rarely have to flush.
  */
 static void flush_memcg_stats_dwork(struct work_struct *w);
 static DECLARE_DEFERRABLE_WORK(stats_flush_dwork, flush_memcg_stats_dwork);
 static u64 flush_last_time;
 
 #define FLUSH_TIME (2UL*HZ)
+#define FLUSH_TIME_MIN (HZ/10UL)
 
 static bool memcg_vmstats_needs_flush(struct memcg_vmstats *vmstats)
 {
@@ -704,6 +713,7 @@ static inline void memcg_rstat_updated(struct mem_cgroup *memcg, long val,
 static void __mem_cgroup_flush_stats(struct mem_cgroup *memcg, bool force)
 {
 	bool needs_flush = memcg_vmstats_needs_flush(memcg->vmstats);
+	u64 now;
 
 	trace_memcg_flush_stats(memcg, atomic_long_read(&memcg->vmstats->stats_updates),
 		force, needs_flush);
@@ -713,8 +723,27 @@ static void __mem_cgroup_flush_stats(struct mem_cgroup *memcg, bool force)
 
 	if (mem_cgroup_is_root(memcg))
 		WRITE_ONCE(flush_last_time, jiffies_64);
+	now = get_jiffies_64();
 
 	css_rstat_flush(&memcg->css);
+
+	/*
+	 * Only publish the flush once it is complete, so that bounded readers
+	 * don't skip their own flush on stats that aren't flushed yet. The
+	 * start time keeps the age an upper bound.
+	 */
+	WRITE_ONCE(memcg->vmstats->flush_time, now);
+}
+
+/* How old, in jiffies, the last flush that covered @memcg is */
+static u64 memcg_stats_age(struct mem_cgroup *memcg)
+{
+	u64 flush_time = 0;
+
+	for (; memcg; memcg = parent_mem_cgroup(memcg))
+		flush_time = max(flush_time, READ_ONCE(memcg->vmstats->flush_time));
+
+	return min_t(u64, get_jiffies_64() - flush_time, MAX_JIFFY_OFFSET);
 }
 
 /*
@@ -737,6 +766,44 @@ void mem_cgroup_flush_stats(struct mem_cgroup *memcg)
 	__mem_cgroup_flush_stats(memcg, false);
 }
 
+/*
+ * mem_cgroup_flush_stats_bounded - flush the stats unless they are fresh enough
+ * @memcg: root of the subtree to flush
+ * @max_age: how old, in msecs, the caller accepts the stats to be
+ *
+ * Like mem_cgroup_flush_stats(), but skips the flush, and with it the global
+ * rstat lock, as long as the last flush that covered @memcg happened at most
+ * @max_age msecs ago. A @max_age of 0 always falls back to
+ * mem_cgroup_flush_stats().
+ *
+ * Returns the age in msecs of the stats the caller is about to read.
+ */
+unsigned int mem_cgroup_flush_stats_bounded(struct mem_cgroup *memcg,
+					    unsigned int max_age)
+{
+	u64 age;
+
+	if (mem_cgroup_disabled())
+		return 0;
+
+	if (!memcg)
+		memcg = root_mem_cgroup;
+
+	age = memcg_stats_age(memcg);
+	if (max_age && age <= msecs_to_jiffies(max_age))
+		return jiffies_to_msecs(age);
+
+	__mem_cgroup_flush_stats(memcg, false);
+
+	return jiffies_to_msecs(memcg_stats_age(memcg));
+}
+
+/* How old memory.stat and memory.numa_stat may be, see memory_stat_staleness */
+static unsigned int memcg_stat_staleness(void)
+{
+	return READ_ONCE(cgrp_dfl_root.memory_stat_staleness);
+}
+
 void mem_cgroup_flush_stats_ratelimited(struct mem_cgroup *memcg)
 {
 	/* Only flush if the periodic flusher is one full cycle late */
@@ -744,6 +811,23 @@ void mem_cgroup_flush_stats_ratelimited(struct mem_cgroup *memcg)
 		mem_cgroup_flush_stats(memcg);
 }
 
+/*
+ * Flush often enough that bounded readers find the stats within their
+ * staleness, but no more than every FLUSH_TIME_MIN. Readers with a smaller
+ * staleness than twice that still get it, by flushing themselves. A staleness
+ * of 0 means there are no bounded readers, keep the default period.
+ */
+static unsigned long flush_memcg_stats_period(void)
+{
+	unsigned int staleness = memcg_stat_staleness();
+
+	if (!staleness)
+		return FLUSH_TIME;
+
+	return clamp_t(unsigned long, msecs_to_jiffies(staleness) / 2,
+		       FLUSH_TIME_MIN, FLUSH_TIME);
+}
+
 static void flush_memcg_stats_dwork(struct work_struct *w)
 {
 	/*
@@ -751,7 +835,8 @@ static void flush_memcg_stats_dwork(struct work_struct *w)
 	 * in latency-sensitive paths is as cheap as possible.
 	 */
 	__mem_cgroup_flush_stats(root_mem_cgroup, true);
-	queue_delayed_work(system_dfl_wq, &stats_flush_dwork, FLUSH_TIME);
+	queue_delayed_work(system_dfl_wq, &stats_flush_dwork,
+			   flush_memcg_stats_period());
 }
 
 unsigned long memcg_page_state(struct mem_cgroup *memcg, int idx)
@@ -1690,8 +1775,14 @@ static bool memcg_accounts_hugetlb(void)
 }
 #endif /* CONFIG_HUGETLB_PAGE */
 
-static void memcg_stat_format(struct mem_cgroup *memcg, struct seq_buf *s)
+/*
+ * @staleness is how old, in msecs, the stats may be, 0 to always flush. Only
+ * memory.stat reads accept stale stats, the OOM report flushes.
+ */
+static void memcg_stat_format(struct mem_cgroup *memcg, struct seq_buf *s,
+			      unsigned int staleness)
 {
+	unsigned int age;
 	int i;
 
 	/*
@@ -1704,7 +1795,7 @@ static void memcg_stat_format(struct mem_cgroup *memcg, struct seq_buf *s)
 	 *
 	 * Current memory state:
 	 */
-	mem_cgroup_flush_stats(memcg);
+	age = mem_cgroup_flush_stats_bounded(memcg, staleness);
 
 	for (i = 0; i < ARRAY_SIZE(memory_stats); i++) {
 		u64 size;
@@ -1746,12 +1837,17 @@ static void memcg_stat_format(struct mem_cgroup *memcg, struct seq_buf *s)
 			       vm_event_name(memcg_vm_event_stat[i]),
 			       memcg_events(memcg, memcg_vm_event_stat[i]));
 	}
+
+	/* Let readers that accept stale stats know how stale they are */
+	if (staleness)
+		seq_buf_printf(s, "stat_age_ms %u\n", age);
 }
 
-static void memory_stat_format(struct mem_cgroup *memcg, struct seq_buf *s)
+static void memory_stat_format(struct mem_cgroup *memcg, struct seq_buf *s,
+			       unsigned int staleness)
 {
 	if (cgroup_subsys_on_dfl(memory_cgrp_subsys))
-		memcg_stat_format(memcg, s);
+		memcg_stat_format(memcg, s, staleness);
 	else
 		memcg1_stat_format(memcg, s);
 	if (seq_buf_has_overflowed(s))
@@ -1825,7 +1921,7 @@ void mem_cgroup_print_oom_meminfo(struct mem_cgroup *memcg)
 	pr_cont_cgroup_path(memcg->css.cgroup);
 	pr_cont(":");
 	seq_buf_init(&s, buf, SEQ_BUF_SIZE);
-	memory_stat_format(memcg, &s);
+	memory_stat_format(memcg, &s, 0);
 	seq_buf_do_printk(&s, KERN_INFO);
 }
 
@@ -4911,7 +5007,7 @@ int memory_stat_show(struct seq_file *m, void *v)
 	if (!buf)
 		return -ENOMEM;
 	seq_buf_init(&s, buf, SEQ_BUF_SIZE);
-	memory_stat_format(memcg, &s);
+	memory_stat_format(memcg, &s, memcg_stat_staleness());
 	seq_puts(m, buf);
 	kfree(buf);
 	return 0;
@@ -4930,7 +5026,7 @@ static int memory_numa_stat_show(struct seq_file *m, void *v)
 	int i;
 	struct mem_cgroup *memcg = mem_cgroup_from_seq(m);
 
-	mem_cgroup_flush_stats(memcg);
+	mem_cgroup_flush_stats_bounded(memcg, memcg_stat_staleness());
 
 	for (i = 0; i < ARRAY_SIZE(memory_stats); i++) {
 		int nid;
@@ -5871,11 +5967,13 @@ bool obj_cgroup_may_zswap(struct obj_cgroup *objcg)
  * obj_cgroup_charge_zswap - charge compression backend memory
  * @objcg: the object cgroup
  * @size: size of compressed object
+ * @nr_pages: number of pages compressed into the object
  *
  * This forces the charge after obj_cgroup_may_zswap() allowed
  * compression and storage in zswap for this cgroup to go ahead.
  */
-void obj_cgroup_charge_zswap(struct obj_cgroup *objcg, size_t size)
+void obj_cgroup_charge_zswap(struct obj_cgroup *objcg, size_t size,
+			     unsigned int nr_pages)
 {
 	struct mem_cgroup *memcg;
 
@@ -5894,8 +5992,8 @@ void obj_cgroup_charge_zswap(struct obj_cgroup *objcg, size_t size)
 	rcu_read_lock();
 	memcg = obj_cgroup_memcg(objcg);
 	mod_memcg_state(memcg, MEMCG_ZSWAP_B, size);
-	mod_memcg_state(memcg, MEMCG_ZSWAPPED, 1);
-	if (size == PAGE_SIZE)
+	mod_memcg_state(memcg, MEMCG_ZSWAPPED, nr_pages);
+	if (nr_pages == 1 && size == PAGE_SIZE)
 		mod_memcg_state(memcg, MEMCG_ZSWAP_INCOMP, 1);
 	rcu_read_unlock();
 }
@@ -5904,10 +6002,12 @@ void obj_cgroup_charge_zswap(struct obj_cgroup *objcg, size_t size)
  * obj_cgroup_uncharge_zswap - uncharge compression backend memory
  * @objcg: the object cgroup
  * @size: size of compressed object
+ * @nr_pages: number of pages compressed into the object
  *
  * Uncharges zswap memory on page in.
  */
-void obj_cgroup_uncharge_zswap(struct obj_cgroup *objcg, size_t size)
+void obj_cgroup_uncharge_zswap(struct obj_cgroup *objcg, size_t size,
+			       unsigned int nr_pages)
 {
 	struct mem_cgroup *memcg;
 
@@ -5922,8 +6022,8 @@ void obj_cgroup_uncharge_zswap(struct obj_cgroup *objcg, size_t size)
 	rcu_read_lock();
 	memcg = obj_cgroup_memcg(objcg);
 	mod_memcg_state(memcg, MEMCG_ZSWAP_B, -size);
-	mod_memcg_state(memcg, MEMCG_ZSWAPPED, -1);
-	if (size == PAGE_SIZE)
+	mod_memcg_state(memcg, MEMCG_ZSWAPPED, -(int)nr_pages);
+	if (nr_pages == 1 && size == PAGE_SIZE)
 		mod_memcg_state(memcg, MEMCG_ZSWAP_INCOMP, -1);
 	rcu_read_unlock();
 }
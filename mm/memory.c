@@ -135,9 +135,61 @@ static const struct ctl_table mmu_sysctl_table[] = {
 	},
 };
 
+/*
+ * fork() copies the page tables of VMAs that span at least this many
+ * megabytes with several threads. Zero, the default, always copies them
+ * serially.
+ */
+static unsigned int sysctl_fork_parallel_copy_mb __read_mostly;
+
+#if defined(CONFIG_TRANSPARENT_HUGEPAGE) || defined(CONFIG_HUGETLBFS)
+/*
+ * Huge folios of at least this many megabytes are zeroed at fault time
+ * with the help of idle CPUs of their node. Zero, the default, always
+ * zeroes them on the faulting CPU.
+ */
+static unsigned int sysctl_zero_huge_parallel_mb __read_mostly;
+
+/*
+ * Zero the part of a huge folio away from the faulting address with
+ * non-temporal stores, where the architecture supports them, so that it
+ * does not evict the working set from the caches.
+ */
+static unsigned int sysctl_zero_huge_nocache __read_mostly;
+#endif
+
+static const struct ctl_table vm_memory_sysctl_table[] = {
+	{
+		.procname	= "fork_parallel_copy_mb",
+		.data		= &sysctl_fork_parallel_copy_mb,
+		.maxlen		= sizeof(sysctl_fork_parallel_copy_mb),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec,
+	},
+#if defined(CONFIG_TRANSPARENT_HUGEPAGE) || defined(CONFIG_HUGETLBFS)
+	{
+		.procname	= "zero_huge_parallel_mb",
+		.data		= &sysctl_zero_huge_parallel_mb,
+		.maxlen		= sizeof(sysctl_zero_huge_parallel_mb),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec,
+	},
+	{
+		.procname	= "zero_huge_nocache",
+		.data		= &sysctl_zero_huge_nocache,
+		.maxlen		= sizeof(sysctl_zero_huge_nocache),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
+#endif
+};
+
 static int __init init_mm_sysctl(void)
 {
 	register_sysctl_init("kernel", mmu_sysctl_table);
+	register_sysctl_init("vm", vm_memory_sysctl_table);
 	return 0;
 }
 
@@ -1503,16 +1555,158 @@ vma_needs_copy(struct vm_area_struct *dst_vma, struct vm_area_struct *src_vma)
 	return false;
 }
 
+static int
+copy_pgd_range(struct vm_area_struct *dst_vma, struct vm_area_struct *src_vma,
+	       unsigned long addr, unsigned long end)
+{
+	pgd_t *src_pgd, *dst_pgd;
+	unsigned long next;
+
+	dst_pgd = pgd_offset(dst_vma->vm_mm, addr);
+	src_pgd = pgd_offset(src_vma->vm_mm, addr);
+	do {
+		next = pgd_addr_end(addr, end);
+		if (pgd_none_or_clear_bad(src_pgd))
+			continue;
+		if (unlikely(copy_p4d_range(dst_vma, src_vma, dst_pgd, src_pgd,
+					    addr, next)))
+			return -ENOMEM;
+	} while (dst_pgd++, src_pgd++, addr = next, addr != end);
+	return 0;
+}
+
+/*
+ * The parallel copy hands out naturally aligned chunks of the VMA, so that
+ * no two threads ever fill the same page table. Upper level tables may be
+ * shared, but those are populated under the page table lock anyway.
+ */
+#define FORK_COPY_CHUNK		max_t(unsigned long, SZ_256M, PMD_SIZE)
+#define FORK_COPY_MAX_THREADS	16
+
+struct copy_range_job {
+	struct vm_area_struct *dst_vma;
+	struct vm_area_struct *src_vma;
+	struct mem_cgroup *memcg;
+	atomic_long_t next;
+	unsigned long chunk;
+	unsigned long end;
+	int ret;
+};
+
+/*
+ * A chunk must never cut through a PUD leaf entry, which DAX and pfnmap VMAs
+ * can have, or copy_pud_range() would copy it twice. Those are handed out in
+ * PUD sized chunks, which with large PUDs leaves them on the serial path.
+ */
+static unsigned long fork_copy_chunk(struct vm_area_struct *vma)
+{
+	if (vma_is_dax(vma) || (vma->vm_flags & (VM_PFNMAP | VM_MIXEDMAP)))
+		return max_t(unsigned long, FORK_COPY_CHUNK, PUD_SIZE);
+	return FORK_COPY_CHUNK;
+}
+
+struct copy_range_work {
+	struct work_struct work;
+	struct copy_range_job *job;
+};
+
+static void copy_range_chunks(struct copy_range_job *job)
+{
+	unsigned long start = job->src_vma->vm_start;
+	unsigned long addr, end;
+
+	while (!READ_ONCE(job->ret)) {
+		addr = atomic_long_fetch_add(job->chunk, &job->next);
+		if (addr >= job->end)
+			break;
+		end = min(addr + job->chunk, job->end);
+		if (copy_pgd_range(job->dst_vma, job->src_vma,
+				   max(addr, start), end))
+			WRITE_ONCE(job->ret, -ENOMEM);
+	}
+}
+
+static void copy_range_workfn(struct work_struct *work)
+{
+	struct copy_range_work *cw = container_of(work, struct copy_range_work,
+						  work);
+	struct mem_cgroup *old_memcg;
+
+	/* Charge the page tables like the forking task would */
+	old_memcg = set_active_memcg(cw->job->memcg);
+	copy_range_chunks(cw->job);
+	set_active_memcg(old_memcg);
+}
+
+/*
+ * Copy the page tables of a large VMA with the help of workers. The forking
+ * task holds the mmap_lock and the VMA write locks on behalf of all of them,
+ * and takes its share of chunks while waiting for them.
+ */
+static int copy_pgd_range_parallel(struct vm_area_struct *dst_vma,
+				   struct vm_area_struct *src_vma)
+{
+	unsigned long chunk = fork_copy_chunk(src_vma);
+	struct copy_range_work *works;
+	struct copy_range_job job;
+	unsigned int i, nr_works;
+
+	nr_works = min(num_online_cpus(), FORK_COPY_MAX_THREADS);
+	nr_works = min_t(unsigned long, nr_works,
+			 DIV_ROUND_UP(src_vma->vm_end, chunk) -
+			 src_vma->vm_start / chunk) - 1;
+	if (!nr_works)
+		goto serial;
+
+	works = kmalloc_array(nr_works, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		goto serial;
+
+	job.dst_vma = dst_vma;
+	job.src_vma = src_vma;
+	job.memcg = get_mem_cgroup_from_current();
+	atomic_long_set(&job.next, ALIGN_DOWN(src_vma->vm_start, chunk));
+	job.chunk = chunk;
+	job.end = src_vma->vm_end;
+	job.ret = 0;
+
+	for (i = 0; i < nr_works; i++) {
+		works[i].job = &job;
+		INIT_WORK(&works[i].work, copy_range_workfn);
+		queue_work(system_dfl_wq, &works[i].work);
+	}
+
+	copy_range_chunks(&job);
+
+	for (i = 0; i < nr_works; i++)
+		flush_work(&works[i].work);
+
+	mem_cgroup_put(job.memcg);
+	kfree(works);
+	return job.ret;
+
+serial:
+	return copy_pgd_range(dst_vma, src_vma, src_vma->vm_start,
+			      src_vma->vm_end);
+}
+
+static bool copy_in_parallel(struct vm_area_struct *src_vma)
+{
+	unsigned long min_size = READ_ONCE(sysctl_fork_parallel_copy_mb);
+
+	if (!min_size)
+		return false;
+	return src_vma->vm_end - src_vma->vm_start >= min_size << 20;
+}
+
 int
 copy_page_range(struct vm_area_struct *dst_vma, struct vm_area_struct *src_vma)
 {
-	pgd_t *src_pgd, *dst_pgd;
 	unsigned long addr = src_vma->vm_start;
 	unsigned long end = src_vma->vm_end;
 	struct mm_struct *dst_mm = dst_vma->vm_mm;
 	struct mm_struct *src_mm = src_vma->vm_mm;
 	struct mmu_notifier_range range;
-	unsigned long next;
 	bool is_cow;
 	int ret;
 
@@ -1545,19 +1739,10 @@ copy_page_range(struct vm_area_struct *dst_vma, struct vm_area_struct *src_vma)
 		raw_write_seqcount_begin(&src_mm->write_protect_seq);
 	}
 
-	ret = 0;
-	dst_pgd = pgd_offset(dst_mm, addr);
-	src_pgd = pgd_offset(src_mm, addr);
-	do {
-		next = pgd_addr_end(addr, end);
-		if (pgd_none_or_clear_bad(src_pgd))
-			continue;
-		if (unlikely(copy_p4d_range(dst_vma, src_vma, dst_pgd, src_pgd,
-					    addr, next))) {
-			ret = -ENOMEM;
-			break;
-		}
-	} while (dst_pgd++, src_pgd++, addr = next, addr != end);
+	if (copy_in_parallel(src_vma))
+		ret = copy_pgd_range_parallel(dst_vma, src_vma);
+	else
+		ret = copy_pgd_range(dst_vma, src_vma, addr, end);
 
 	if (is_cow) {
 		raw_write_seqcount_end(&src_mm->write_protect_seq);
@@ -4627,12 +4812,12 @@ static bool can_swapin_thp(struct vm_fault *vmf, pte_t *ptep, int nr_pages)
 		return false;
 	/*
 	 * swap_read_folio() can't handle the case a large folio is hybridly
-	 * from different backends. And they are likely corner cases. Similar
-	 * things might be added once zswap support large folios.
+	 * from different backends. And they are likely corner cases. The
+	 * same goes for a range that is only partially in zswap.
 	 */
 	if (swap_pte_batch(ptep, nr_pages, pte) != nr_pages)
 		return false;
-	return true;
+	return zswap_can_load_large(softleaf_from_pte(pte), nr_pages);
 }
 
 static inline unsigned long thp_swap_suitable_orders(pgoff_t swp_offset,
@@ -4677,10 +4862,10 @@ static unsigned long thp_swapin_suitable_orders(struct vm_fault *vmf)
 
 	/*
 	 * A large swapped out folio could be partially or fully in zswap. We
-	 * lack handling for such cases, so fallback to swapping in order-0
-	 * folio.
+	 * only handle that when zswap stores large folios in chunks, otherwise
+	 * fallback to swapping in order-0 folio.
 	 */
-	if (!zswap_never_enabled())
+	if (!zswap_large_swapin_allowed())
 		return 0;
 
 	entry = softleaf_from_pte(vmf->orig_pte);
@@ -7356,7 +7541,7 @@ static inline int process_huge_page(
 }
 
 static void clear_contig_highpages(struct page *page, unsigned long addr,
-				   unsigned int nr_pages)
+				   unsigned int nr_pages, bool nocache)
 {
 	unsigned int i, count;
 	/*
@@ -7376,7 +7561,13 @@ static void clear_contig_highpages(struct page *page, unsigned long addr,
 		cond_resched();
 
 		count = min(unit, nr_pages - i);
-		clear_user_highpages(page + i, addr + i * PAGE_SIZE, count);
+		if (nocache)
+			clear_user_highpages_nocache(page + i,
+						     addr + i * PAGE_SIZE,
+						     count);
+		else
+			clear_user_highpages(page + i, addr + i * PAGE_SIZE,
+					     count);
 	}
 }
 
@@ -7389,6 +7580,133 @@ static void clear_contig_highpages(struct page *page, unsigned long addr,
  */
 #define FOLIO_ZERO_LOCALITY_RADIUS	2
 
+/*
+ * Huge folios are zeroed in parallel by up to FOLIO_ZERO_MAX_THREADS
+ * helpers besides the faulting task, each chunk they grab being at least
+ * FOLIO_ZERO_MIN_CHUNK pages.
+ */
+#define FOLIO_ZERO_MIN_CHUNK	(SZ_256K >> PAGE_SHIFT)
+#define FOLIO_ZERO_MAX_THREADS	8
+
+struct folio_zero_job {
+	struct folio *folio;
+	unsigned long base_addr;
+	/* Pages left for the faulting task to clear last */
+	struct range local;
+	atomic_long_t next;
+	long chunk;
+	bool nocache;
+};
+
+struct folio_zero_work {
+	struct work_struct work;
+	struct folio_zero_job *job;
+};
+
+static void folio_zero_range(struct folio_zero_job *job, long start, long end)
+{
+	if (start >= end)
+		return;
+	clear_contig_highpages(folio_page(job->folio, start),
+			       job->base_addr + start * PAGE_SIZE,
+			       end - start, job->nocache);
+}
+
+static void folio_zero_chunks(struct folio_zero_job *job)
+{
+	const long nr_pages = folio_nr_pages(job->folio);
+	long start, end;
+
+	for (;;) {
+		start = atomic_long_fetch_add(job->chunk, &job->next);
+		if (start >= nr_pages)
+			break;
+		end = min(start + job->chunk, nr_pages);
+
+		/* Skip the neighbourhood of the fault */
+		folio_zero_range(job, start, min_t(long, end,
+						   job->local.start));
+		folio_zero_range(job, max_t(long, start, job->local.end + 1),
+				 end);
+	}
+}
+
+static void folio_zero_workfn(struct work_struct *work)
+{
+	struct folio_zero_work *zw = container_of(work, struct folio_zero_work,
+						  work);
+
+	folio_zero_chunks(zw->job);
+}
+
+/* How many helpers are worth waking up to zero @folio? */
+static unsigned int folio_zero_nr_helpers(struct folio *folio)
+{
+	unsigned long min_size = READ_ONCE(sysctl_zero_huge_parallel_mb);
+	unsigned int nr = 0, max;
+	int cpu;
+
+	if (!min_size || folio_size(folio) < min_size << 20)
+		return 0;
+
+	max = min_t(unsigned long, FOLIO_ZERO_MAX_THREADS,
+		    folio_nr_pages(folio) / FOLIO_ZERO_MIN_CHUNK - 1);
+
+	/* Only borrow CPUs that have nothing better to do */
+	for_each_cpu_and(cpu, cpumask_of_node(folio_nid(folio)),
+			 cpu_online_mask) {
+		if (nr >= max)
+			break;
+		if (idle_cpu(cpu))
+			nr++;
+	}
+
+	return nr;
+}
+
+/*
+ * Zero everything but @local in @folio with the help of the idle CPUs of
+ * the folio's node. The helpers run on the unbound workqueue, queued to
+ * that node, and the faulting task takes its share of chunks while it
+ * waits for them.
+ */
+static bool folio_zero_parallel(struct folio *folio, unsigned long base_addr,
+				const struct range *local)
+{
+	struct folio_zero_work works[FOLIO_ZERO_MAX_THREADS];
+	struct folio_zero_job job;
+	unsigned int i, nr_works;
+	int nid = folio_nid(folio);
+
+	nr_works = folio_zero_nr_helpers(folio);
+	if (!nr_works)
+		return false;
+
+	job.folio = folio;
+	job.base_addr = base_addr;
+	job.local = *local;
+	atomic_long_set(&job.next, 0);
+	/* A few chunks per thread, to even out the helpers' progress */
+	job.chunk = max_t(long, FOLIO_ZERO_MIN_CHUNK,
+			  folio_nr_pages(folio) / ((nr_works + 1) * 4));
+	job.nocache = READ_ONCE(sysctl_zero_huge_nocache);
+
+	for (i = 0; i < nr_works; i++) {
+		works[i].job = &job;
+		INIT_WORK_ONSTACK(&works[i].work, folio_zero_workfn);
+		queue_work_node(nid, system_dfl_wq, &works[i].work);
+	}
+
+	folio_zero_chunks(&job);
+
+	for (i = 0; i < nr_works; i++) {
+		flush_work(&works[i].work);
+		destroy_work_on_stack(&works[i].work);
+	}
+
+	return true;
+}
+
 /**
  * folio_zero_user - Zero a folio which will be mapped to userspace.
  * @folio: The folio to zero.
@@ -7400,6 +7718,7 @@ void folio_zero_user(struct folio *folio, unsigned long addr_hint)
 	const long fault_idx = (addr_hint - base_addr) / PAGE_SIZE;
 	const struct range pg = DEFINE_RANGE(0, folio_nr_pages(folio) - 1);
 	const long radius = FOLIO_ZERO_LOCALITY_RADIUS;
+	const bool nocache = READ_ONCE(sysctl_zero_huge_nocache);
 	struct range r[3];
 	int i;
 
@@ -7417,13 +7736,20 @@ void folio_zero_user(struct folio *folio, unsigned long addr_hint)
 	/* Region to the right of the fault: always valid for the common fault_idx=0 case. */
 	r[0] = DEFINE_RANGE(r[2].end + 1, pg.end);
 
-	for (i = 0; i < ARRAY_SIZE(r); i++) {
+	if (folio_zero_parallel(folio, base_addr, &r[2]))
+		i = 2;
+	else
+		i = 0;
+
+	for (; i < ARRAY_SIZE(r); i++) {
 		const unsigned long addr = base_addr + r[i].start * PAGE_SIZE;
 		const long nr_pages = (long)range_len(&r[i]);
 		struct page *page = folio_page(folio, r[i].start);
 
+		/* The neighbourhood of the fault is always kept cache hot */
 		if (nr_pages > 0)
-			clear_contig_highpages(page, addr, nr_pages);
+			clear_contig_highpages(page, addr, nr_pages,
+					       i != 2 && nocache);
 	}
 }
 
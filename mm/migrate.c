@@ -856,7 +856,7 @@ EXPORT_SYMBOL(folio_migrate_flags);
 
 static int __migrate_folio(struct address_space *mapping, struct folio *dst,
 			   struct folio *src, void *src_private,
-			   enum migrate_mode mode)
+			   enum migrate_mode mode, bool copy)
 {
 	int rc, expected_count = folio_expected_ref_count(src) + 1;
 
@@ -864,9 +864,11 @@ static int __migrate_folio(struct address_space *mapping, struct folio *dst,
 	if (folio_ref_count(src) != expected_count)
 		return -EAGAIN;
 
-	rc = folio_mc_copy(dst, src);
-	if (unlikely(rc))
-		return rc;
+	if (copy) {
+		rc = folio_mc_copy(dst, src);
+		if (unlikely(rc))
+			return rc;
+	}
 
 	rc = __folio_migrate_mapping(mapping, dst, src, expected_count);
 	if (rc)
@@ -895,7 +897,7 @@ int migrate_folio(struct address_space *mapping, struct folio *dst,
 		  struct folio *src, enum migrate_mode mode)
 {
 	BUG_ON(folio_test_writeback(src));	/* Writeback must be complete */
-	return __migrate_folio(mapping, dst, src, NULL, mode);
+	return __migrate_folio(mapping, dst, src, NULL, mode, true);
 }
 EXPORT_SYMBOL(migrate_folio);
 
@@ -1051,7 +1053,8 @@ EXPORT_SYMBOL_GPL(buffer_migrate_folio_norefs);
 int filemap_migrate_folio(struct address_space *mapping,
 		struct folio *dst, struct folio *src, enum migrate_mode mode)
 {
-	return __migrate_folio(mapping, dst, src, folio_get_private(src), mode);
+	return __migrate_folio(mapping, dst, src, folio_get_private(src), mode,
+			       true);
 }
 EXPORT_SYMBOL_GPL(filemap_migrate_folio);
 
@@ -1077,6 +1080,36 @@ static int fallback_migrate_folio(struct address_space *mapping,
 	return migrate_folio(mapping, dst, src, mode);
 }
 
+/*
+ * Can the contents of @src be copied ahead of move_to_new_folio()? Only
+ * folios migrated by __migrate_folio() are, as that is where the copy
+ * can be skipped.
+ */
+static bool migrate_folio_copy_early(struct folio *src)
+{
+	struct address_space *mapping;
+
+	if (unlikely(page_has_movable_ops(&src->page)))
+		return false;
+
+	mapping = folio_mapping(src);
+	if (!mapping)
+		return true;
+	if (mapping_inaccessible(mapping))
+		return false;
+	return mapping->a_ops->migrate_folio == migrate_folio ||
+	       mapping->a_ops->migrate_folio == filemap_migrate_folio;
+}
+
+/* The src_private that ->migrate_folio() hands to __migrate_folio() */
+static void *migrate_folio_private(struct address_space *mapping,
+				   struct folio *src)
+{
+	if (mapping && mapping->a_ops->migrate_folio == filemap_migrate_folio)
+		return folio_get_private(src);
+	return NULL;
+}
+
 /*
  * Move a src folio to a newly allocated dst folio.
  *
@@ -1085,12 +1118,15 @@ static int fallback_migrate_folio(struct address_space *mapping,
  *
  * On success, the src folio was replaced by the dst folio.
  *
+ * @copied is set if migrate_folios_copy() already copied the contents of
+ * src to dst, which it only does for folios using __migrate_folio().
+ *
  * Return value:
  *   < 0 - error code
  *     0 - success
  */
 static int move_to_new_folio(struct folio *dst, struct folio *src,
-				enum migrate_mode mode)
+				enum migrate_mode mode, bool copied)
 {
 	struct address_space *mapping = folio_mapping(src);
 	int rc = -EAGAIN;
@@ -1098,7 +1134,11 @@ static int move_to_new_folio(struct folio *dst, struct folio *src,
 	VM_BUG_ON_FOLIO(!folio_test_locked(src), src);
 	VM_BUG_ON_FOLIO(!folio_test_locked(dst), dst);
 
-	if (!mapping)
+	if (copied)
+		rc = __migrate_folio(mapping, dst, src,
+				     migrate_folio_private(mapping, src),
+				     mode, false);
+	else if (!mapping)
 		rc = migrate_folio(mapping, dst, src, mode);
 	else if (mapping_inaccessible(mapping))
 		rc = -EOPNOTSUPP;
@@ -1353,7 +1393,7 @@ static int migrate_folio_unmap(new_folio_t get_new_folio,
 static int migrate_folio_move(free_folio_t put_new_folio, unsigned long private,
 			      struct folio *src, struct folio *dst,
 			      enum migrate_mode mode, enum migrate_reason reason,
-			      struct list_head *ret)
+			      struct list_head *ret, bool copied)
 {
 	int rc;
 	int old_folio_state = 0;
@@ -1379,7 +1419,7 @@ static int migrate_folio_move(free_folio_t put_new_folio, unsigned long private,
 		src_partially_mapped = folio_test_partially_mapped(src);
 	}
 
-	rc = move_to_new_folio(dst, src, mode);
+	rc = move_to_new_folio(dst, src, mode, copied);
 	if (rc)
 		goto out;
 
@@ -1536,7 +1576,7 @@ static int unmap_and_move_huge_page(new_folio_t get_new_folio,
 	}
 
 	if (!folio_mapped(src))
-		rc = move_to_new_folio(dst, src, mode);
+		rc = move_to_new_folio(dst, src, mode, false);
 
 	if (page_was_mapped)
 		remove_migration_ptes(src, !rc ? dst : src, ttu);
@@ -1713,6 +1753,204 @@ static int migrate_hugetlbs(struct list_head *from, new_folio_t get_new_folio,
 	return nr_failed;
 }
 
+/*
+ * The copy phase of a batch is split in chunks of this many pages, which
+ * up to vm.migrate_copy_threads workers on the destination node copy
+ * alongside the migrating task. Zero, the default, copies serially.
+ */
+#define MIGRATE_COPY_CHUNK		(SZ_256K >> PAGE_SHIFT)
+#define MIGRATE_COPY_MAX_THREADS	8
+#define MIGRATE_COPY_MAX_FOLIOS		NR_MAX_BATCHED_MIGRATION
+
+static unsigned int sysctl_migrate_copy_threads __read_mostly;
+static const unsigned int migrate_copy_max_threads = MIGRATE_COPY_MAX_THREADS;
+
+static const struct ctl_table migrate_sysctl_table[] = {
+	{
+		.procname	= "migrate_copy_threads",
+		.data		= &sysctl_migrate_copy_threads,
+		.maxlen		= sizeof(sysctl_migrate_copy_threads),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= (void *)&migrate_copy_max_threads,
+	},
+};
+
+static int __init migrate_sysctl_init(void)
+{
+	register_sysctl_init("vm", migrate_sysctl_table);
+	return 0;
+}
+subsys_initcall(migrate_sysctl_init);
+
+struct migrate_copy_job {
+	spinlock_t lock;		/* protects the cursor below */
+	struct list_head *src_head;
+	struct folio *src;
+	struct folio *dst;
+	long off;
+	unsigned int idx;
+
+	/* Folios copied in full, and folios a chunk of failed to copy */
+	unsigned long *copied;
+	unsigned long *failed;
+};
+
+struct migrate_copy_work {
+	struct work_struct work;
+	struct migrate_copy_job *job;
+};
+
+/* Too big for the stack with large HPAGE_PMD_NR, allocated per batch */
+struct migrate_copy_ctl {
+	struct migrate_copy_job job;
+	struct migrate_copy_work works[MIGRATE_COPY_MAX_THREADS];
+	DECLARE_BITMAP(copied, MIGRATE_COPY_MAX_FOLIOS);
+	DECLARE_BITMAP(failed, MIGRATE_COPY_MAX_FOLIOS);
+};
+
+/* Move the cursor to the next folio that can be copied early, if any */
+static void migrate_copy_advance(struct migrate_copy_job *job)
+{
+	while (!list_entry_is_head(job->src, job->src_head, lru)) {
+		if (job->idx >= MIGRATE_COPY_MAX_FOLIOS)
+			break;
+		/*
+		 * Like __migrate_folio(), don't bother if the folio has extra
+		 * references: moving it would fail with -EAGAIN anyway.
+		 */
+		if (migrate_folio_copy_early(job->src) &&
+		    folio_ref_count(job->src) ==
+		    folio_expected_ref_count(job->src) + 1) {
+			__set_bit(job->idx, job->copied);
+			return;
+		}
+		job->src = list_next_entry(job->src, lru);
+		job->dst = list_next_entry(job->dst, lru);
+		job->idx++;
+	}
+	job->src = NULL;
+}
+
+static void migrate_copy_chunks(struct migrate_copy_job *job)
+{
+	struct folio *src, *dst;
+	unsigned int idx;
+	long i, end;
+
+	for (;;) {
+		spin_lock(&job->lock);
+		src = job->src;
+		if (!src) {
+			spin_unlock(&job->lock);
+			break;
+		}
+		dst = job->dst;
+		idx = job->idx;
+		i = job->off;
+		end = min(i + MIGRATE_COPY_CHUNK, folio_nr_pages(src));
+		job->off = end;
+		if (end == folio_nr_pages(src)) {
+			job->src = list_next_entry(src, lru);
+			job->dst = list_next_entry(dst, lru);
+			job->off = 0;
+			job->idx++;
+			migrate_copy_advance(job);
+		}
+		spin_unlock(&job->lock);
+
+		for (; i < end; i++) {
+			if (copy_mc_highpage(folio_page(dst, i),
+					     folio_page(src, i))) {
+				set_bit(idx, job->failed);
+				break;
+			}
+			cond_resched();
+		}
+	}
+}
+
+static void migrate_copy_workfn(struct work_struct *work)
+{
+	struct migrate_copy_work *cw = container_of(work,
+				struct migrate_copy_work, work);
+
+	migrate_copy_chunks(cw->job);
+}
+
+/*
+ * Copy the contents of the unmapped folios of a batch to their destination
+ * with the help of workers on the destination node, before they are moved
+ * one by one. The folios stay locked and unmapped throughout, so this only
+ * moves the copy earlier within the unmap -> copy -> remap sequence of
+ * each folio; move_to_new_folio() re-checks the references and finishes
+ * the migration without copying for the folios marked in the returned
+ * control's copied bitmap. Returns NULL, and leaves all the copying to
+ * move_to_new_folio(), if nothing was copied early; free with kfree().
+ */
+static struct migrate_copy_ctl *migrate_folios_copy(struct list_head *src_folios,
+						    struct list_head *dst_folios)
+{
+	unsigned int threads = READ_ONCE(sysctl_migrate_copy_threads);
+	struct migrate_copy_ctl *ctl;
+	struct migrate_copy_job *job;
+	struct folio *folio;
+	unsigned long nr_pages = 0;
+	unsigned int i, nr_works;
+	int nid;
+
+	if (!threads || list_empty(src_folios))
+		return NULL;
+
+	list_for_each_entry(folio, src_folios, lru)
+		nr_pages += folio_nr_pages(folio);
+	nr_works = min_t(unsigned long, threads,
+			 DIV_ROUND_UP(nr_pages, MIGRATE_COPY_CHUNK) - 1);
+	if (!nr_works)
+		return NULL;
+
+	/* We may be migrating for reclaim: just copy serially on failure */
+	ctl = kzalloc(sizeof(*ctl), GFP_NOWAIT | __GFP_NOWARN);
+	if (!ctl)
+		return NULL;
+
+	job = &ctl->job;
+	spin_lock_init(&job->lock);
+	job->src_head = src_folios;
+	job->src = list_first_entry(src_folios, struct folio, lru);
+	job->dst = list_first_entry(dst_folios, struct folio, lru);
+	job->copied = ctl->copied;
+	job->failed = ctl->failed;
+	migrate_copy_advance(job);
+	if (!job->src) {
+		kfree(ctl);
+		return NULL;
+	}
+
+	nid = folio_nid(job->dst);
+	for (i = 0; i < nr_works; i++) {
+		ctl->works[i].job = job;
+		INIT_WORK(&ctl->works[i].work, migrate_copy_workfn);
+		queue_work_node(nid, system_dfl_wq, &ctl->works[i].work);
+	}
+
+	migrate_copy_chunks(job);
+
+	/*
+	 * Workers that did not get to run have nothing left to do: don't
+	 * wait for them to be scheduled, which may take a while when we are
+	 * migrating for reclaim.
+	 */
+	for (i = 0; i < nr_works; i++)
+		cancel_work_sync(&ctl->works[i].work);
+
+	/* Let move_to_new_folio() copy, and report, what failed here */
+	bitmap_andnot(ctl->copied, ctl->copied, ctl->failed,
+		      MIGRATE_COPY_MAX_FOLIOS);
+	return ctl;
+}
+
 static void migrate_folios_move(struct list_head *src_folios,
 		struct list_head *dst_folios,
 		free_folio_t put_new_folio, unsigned long private,
@@ -1722,11 +1960,15 @@ static void migrate_folios_move(struct list_head *src_folios,
 		int *retry, int *thp_retry, int *nr_failed,
 		int *nr_retry_pages)
 {
+	struct migrate_copy_ctl *ctl;
 	struct folio *folio, *folio2, *dst, *dst2;
+	unsigned int idx = 0;
 	bool is_thp;
 	int nr_pages;
 	int rc;
 
+	ctl = migrate_folios_copy(src_folios, dst_folios);
+
 	dst = list_first_entry(dst_folios, struct folio, lru);
 	dst2 = list_next_entry(dst, lru);
 	list_for_each_entry_safe(folio, folio2, src_folios, lru) {
@@ -1736,8 +1978,10 @@ static void migrate_folios_move(struct list_head *src_folios,
 		cond_resched();
 
 		rc = migrate_folio_move(put_new_folio, private,
-				folio, dst, mode,
-				reason, ret_folios);
+				folio, dst, mode, reason, ret_folios,
+				ctl && idx < MIGRATE_COPY_MAX_FOLIOS &&
+				test_bit(idx, ctl->copied));
+		idx++;
 		/*
 		 * The rules are:
 		 *	0: folio will be freed
@@ -1763,6 +2007,7 @@ static void migrate_folios_move(struct list_head *src_folios,
 		dst = dst2;
 		dst2 = list_next_entry(dst, lru);
 	}
+	kfree(ctl);
 }
 
 static void migrate_folios_undo(struct list_head *src_folios,
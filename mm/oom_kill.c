@@ -1125,6 +1125,13 @@ bool out_of_memory(struct oom_control *oc)
 		return true;
 	}
 
+	/*
+	 * Exited tasks may still be freeing their memory in the background,
+	 * see mmput_exit(). Wait for that rather than kill another task.
+	 */
+	if (!is_memcg_oom(oc) && !is_sysrq_oom(oc) && mm_teardown_pending())
+		return true;
+
 	/*
 	 * The OOM killer does not compensate for IO-less reclaim.
 	 * But mem_cgroup_oom() has to invoke the OOM killer even
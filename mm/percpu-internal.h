@@ -107,6 +107,27 @@ extern int pcpu_nr_empty_pop_pages;
 extern struct pcpu_chunk *pcpu_first_chunk;
 extern struct pcpu_chunk *pcpu_reserved_chunk;
 
+/*
+ * Small areas freed on a CPU are kept in a cache there, to be handed out to
+ * the next allocation of the same size without taking pcpu_alloc_mutex or
+ * pcpu_lock. Cached areas stay allocated in their chunk.
+ */
+#define PCPU_CACHE_MAX_SIZE	64
+#define PCPU_CACHE_NR_SIZES	(PCPU_CACHE_MAX_SIZE >> PCPU_MIN_ALLOC_SHIFT)
+#define PCPU_CACHE_DEPTH	8
+
+struct pcpu_area_cache {
+	spinlock_t		lock;		/* remote CPUs take it to drain */
+	unsigned char		nr[PCPU_CACHE_NR_SIZES];
+	void __percpu		*areas[PCPU_CACHE_NR_SIZES][PCPU_CACHE_DEPTH];
+#ifdef CONFIG_PERCPU_STATS
+	unsigned long		nr_hit;		/* allocations served */
+	unsigned long		nr_put;		/* frees kept */
+#endif
+};
+
+DECLARE_PER_CPU(struct pcpu_area_cache, pcpu_area_cache);
+
 /**
  * pcpu_chunk_nr_blocks - converts nr_pages to # of md_blocks
  * @chunk: chunk of interest
@@ -175,6 +196,10 @@ struct percpu_stats {
 	u32 nr_max_chunks;	/* max # of live chunks */
 	size_t min_alloc_size;	/* min allocation size */
 	size_t max_alloc_size;	/* max allocation size */
+	u64 nr_lock_contended;	/* # of times pcpu_lock was contended */
+	u64 nr_mutex_contended;	/* # of times pcpu_alloc_mutex was contended,
+				   protected by pcpu_alloc_mutex */
+	u64 nr_cache_drained;	/* # of cached areas given back to chunks */
 };
 
 extern struct percpu_stats pcpu_stats;
@@ -233,6 +258,45 @@ static inline void pcpu_stats_area_dealloc(struct pcpu_chunk *chunk)
 	chunk->nr_alloc--;
 }
 
+/*
+ * pcpu_lock_irqsave - take pcpu_lock, counting whether it was contended
+ */
+#define pcpu_lock_irqsave(flags)					\
+	do {								\
+		if (!spin_trylock_irqsave(&pcpu_lock, flags)) {		\
+			spin_lock_irqsave(&pcpu_lock, flags);		\
+			pcpu_stats.nr_lock_contended++;			\
+		}							\
+	} while (0)
+
+static inline void pcpu_stats_mutex_contended(void)
+{
+	pcpu_stats.nr_mutex_contended++;
+}
+
+/*
+ * pcpu_stats_cache_drained - count cached areas given back to their chunks
+ *
+ * CONTEXT:
+ * pcpu_lock.
+ */
+static inline void pcpu_stats_cache_drained(int nr)
+{
+	lockdep_assert_held(&pcpu_lock);
+
+	pcpu_stats.nr_cache_drained += nr;
+}
+
+static inline void pcpu_stats_cache_hit(struct pcpu_area_cache *cache)
+{
+	cache->nr_hit++;
+}
+
+static inline void pcpu_stats_cache_put(struct pcpu_area_cache *cache)
+{
+	cache->nr_put++;
+}
+
 /*
  * pcpu_stats_chunk_alloc - increment chunk stats
  */
@@ -283,6 +347,24 @@ static inline void pcpu_stats_chunk_dealloc(void)
 {
 }
 
+#define pcpu_lock_irqsave(flags)	spin_lock_irqsave(&pcpu_lock, flags)
+
+static inline void pcpu_stats_mutex_contended(void)
+{
+}
+
+static inline void pcpu_stats_cache_drained(int nr)
+{
+}
+
+static inline void pcpu_stats_cache_hit(struct pcpu_area_cache *cache)
+{
+}
+
+static inline void pcpu_stats_cache_put(struct pcpu_area_cache *cache)
+{
+}
+
 #endif /* !CONFIG_PERCPU_STATS */
 
 #endif
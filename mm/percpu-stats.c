@@ -131,8 +131,29 @@ static void chunk_map_stats(struct seq_file *m, struct pcpu_chunk *chunk,
 	seq_putc(m, '\n');
 }
 
+/*
+ * Sums up the caches of freed areas over all CPUs.
+ */
+static void area_cache_stats(unsigned long *nr_hit, unsigned long *nr_put,
+			     unsigned long *nr_cached)
+{
+	unsigned int cpu;
+	int idx;
+
+	*nr_hit = *nr_put = *nr_cached = 0;
+	for_each_possible_cpu(cpu) {
+		struct pcpu_area_cache *cache = per_cpu_ptr(&pcpu_area_cache, cpu);
+
+		*nr_hit += data_race(cache->nr_hit);
+		*nr_put += data_race(cache->nr_put);
+		for (idx = 0; idx < PCPU_CACHE_NR_SIZES; idx++)
+			*nr_cached += data_race(cache->nr[idx]);
+	}
+}
+
 static int percpu_stats_show(struct seq_file *m, void *v)
 {
+	unsigned long nr_hit, nr_put, nr_cached;
 	struct pcpu_chunk *chunk;
 	int slot, max_nr_alloc;
 	int *buffer;
@@ -147,6 +168,8 @@ static int percpu_stats_show(struct seq_file *m, void *v)
 	if (!buffer)
 		return -ENOMEM;
 
+	area_cache_stats(&nr_hit, &nr_put, &nr_cached);
+
 	spin_lock_irq(&pcpu_lock);
 
 	/* if the buffer allocated earlier is too small */
@@ -190,6 +213,17 @@ static int percpu_stats_show(struct seq_file *m, void *v)
 	P("empty_pop_pages", pcpu_nr_empty_pop_pages);
 	seq_putc(m, '\n');
 
+	seq_printf(m,
+			"Contention Stats:\n"
+			"----------------------------------------\n");
+	PU(nr_lock_contended);
+	PU(nr_mutex_contended);
+	P("nr_cache_hit", nr_hit);
+	P("nr_cache_put", nr_put);
+	P("nr_cached", nr_cached);
+	PU(nr_cache_drained);
+	seq_putc(m, '\n');
+
 #undef PU
 
 	seq_printf(m,
@@ -70,6 +70,7 @@
 
 #include <linux/bitmap.h>
 #include <linux/cpumask.h>
+#include <linux/cpuhotplug.h>
 #include <linux/memblock.h>
 #include <linux/err.h>
 #include <linux/list.h>
@@ -1718,6 +1719,172 @@ static void pcpu_alloc_tag_free_hook(struct pcpu_chunk *chunk, int off, size_t s
 }
 #endif
 
+DEFINE_PER_CPU(struct pcpu_area_cache, pcpu_area_cache);
+static bool pcpu_area_cache_enabled __read_mostly;
+
+/* Take an area of @size and @align out of the cache of this CPU */
+static void __percpu *pcpu_area_cache_get(size_t size, size_t align)
+{
+	int idx = (size >> PCPU_MIN_ALLOC_SHIFT) - 1;
+	struct pcpu_area_cache *cache;
+	void __percpu *ptr = NULL;
+	unsigned long flags;
+	int i;
+
+	if (size > PCPU_CACHE_MAX_SIZE || !READ_ONCE(pcpu_area_cache_enabled))
+		return NULL;
+
+	/* Migrating away only means using another CPU's cache */
+	cache = raw_cpu_ptr(&pcpu_area_cache);
+	spin_lock_irqsave(&cache->lock, flags);
+	for (i = cache->nr[idx] - 1; i >= 0; i--) {
+		void *addr = __pcpu_ptr_to_addr(cache->areas[idx][i]);
+
+		if (IS_ALIGNED((unsigned long)addr, align)) {
+			ptr = cache->areas[idx][i];
+			cache->areas[idx][i] = cache->areas[idx][--cache->nr[idx]];
+			pcpu_stats_cache_hit(cache);
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+
+	return ptr;
+}
+
+/*
+ * Check whether the balance work needs to run after an area of @chunk has
+ * been freed.
+ */
+static bool pcpu_chunk_area_freed(struct pcpu_chunk *chunk)
+{
+	lockdep_assert_held(&pcpu_lock);
+
+	/*
+	 * If there are more than one fully free chunks, wake up grim reaper.
+	 * If the chunk is isolated, it may be in the process of being
+	 * reclaimed.  Let reclaim manage cleaning up of that chunk.
+	 */
+	if (!chunk->isolated && chunk->free_bytes == pcpu_unit_size) {
+		struct pcpu_chunk *pos;
+
+		list_for_each_entry(pos, &pcpu_chunk_lists[pcpu_free_slot], list)
+			if (pos != chunk)
+				return true;
+	} else if (pcpu_should_reclaim_chunk(chunk)) {
+		pcpu_isolate_chunk(chunk);
+		return true;
+	}
+
+	return false;
+}
+
+/* Give cached areas back to their chunks */
+static void pcpu_area_cache_release(void __percpu **ptrs, int nr)
+{
+	bool need_balance = false;
+	unsigned long flags;
+	int i;
+
+	pcpu_lock_irqsave(flags);
+	for (i = 0; i < nr; i++) {
+		void *addr = __pcpu_ptr_to_addr(ptrs[i]);
+		struct pcpu_chunk *chunk = pcpu_chunk_addr_search(addr);
+
+		pcpu_free_area(chunk, addr - chunk->base_addr);
+		need_balance |= pcpu_chunk_area_freed(chunk);
+	}
+	pcpu_stats_cache_drained(nr);
+	spin_unlock_irqrestore(&pcpu_lock, flags);
+
+	if (need_balance)
+		pcpu_schedule_balance_work();
+}
+
+/*
+ * Keep the area at @off in @chunk, which @ptr points to, in the cache of this
+ * CPU instead of freeing it. Returns false if it is not small enough.
+ */
+static bool pcpu_area_cache_put(struct pcpu_chunk *chunk, int off,
+				void __percpu *ptr)
+{
+	int bit_off = off / PCPU_MIN_ALLOC_SIZE;
+	struct pcpu_area_cache *cache;
+	void __percpu *evict = NULL;
+	unsigned long flags;
+	int end, idx;
+	size_t size;
+
+	if (!READ_ONCE(pcpu_area_cache_enabled) ||
+	    chunk == pcpu_reserved_chunk || data_race(chunk->isolated))
+		return false;
+
+	/*
+	 * The bits of an allocated area in the allocation and boundary maps
+	 * don't change until it is freed, so its size can be read off them
+	 * without pcpu_lock. Invalid frees are left to the slow path to catch.
+	 */
+	if (!test_bit(bit_off, chunk->alloc_map) ||
+	    !test_bit(bit_off, chunk->bound_map))
+		return false;
+	end = find_next_bit(chunk->bound_map,
+			    min(pcpu_chunk_map_bits(chunk),
+				bit_off + PCPU_CACHE_NR_SIZES + 1),
+			    bit_off + 1);
+	if (end - bit_off > PCPU_CACHE_NR_SIZES)
+		return false;
+	idx = end - bit_off - 1;
+	size = (end - bit_off) * PCPU_MIN_ALLOC_SIZE;
+
+	/* Unaccount it before anyone can take it out of the cache */
+	pcpu_alloc_tag_free_hook(chunk, off, size);
+	pcpu_memcg_free_hook(chunk, off, size);
+	trace_percpu_free_percpu(chunk->base_addr, off, ptr);
+
+	cache = raw_cpu_ptr(&pcpu_area_cache);
+	spin_lock_irqsave(&cache->lock, flags);
+	if (cache->nr[idx] == PCPU_CACHE_DEPTH) {
+		/* Make room by giving back the area cached the longest */
+		evict = cache->areas[idx][0];
+		memmove(&cache->areas[idx][0], &cache->areas[idx][1],
+			(PCPU_CACHE_DEPTH - 1) * sizeof(evict));
+		cache->nr[idx]--;
+	}
+	cache->areas[idx][cache->nr[idx]++] = ptr;
+	pcpu_stats_cache_put(cache);
+	spin_unlock_irqrestore(&cache->lock, flags);
+
+	if (evict)
+		pcpu_area_cache_release(&evict, 1);
+
+	return true;
+}
+
+static void pcpu_area_cache_drain(unsigned int cpu)
+{
+	struct pcpu_area_cache *cache = per_cpu_ptr(&pcpu_area_cache, cpu);
+	void __percpu *ptrs[PCPU_CACHE_DEPTH];
+	unsigned long flags;
+	int idx, nr;
+
+	for (idx = 0; idx < PCPU_CACHE_NR_SIZES; idx++) {
+		spin_lock_irqsave(&cache->lock, flags);
+		nr = cache->nr[idx];
+		memcpy(ptrs, cache->areas[idx], nr * sizeof(ptrs[0]));
+		cache->nr[idx] = 0;
+		spin_unlock_irqrestore(&cache->lock, flags);
+
+		if (nr)
+			pcpu_area_cache_release(ptrs, nr);
+	}
+}
+
+static int pcpu_area_cache_cpu_dead(unsigned int cpu)
+{
+	pcpu_area_cache_drain(cpu);
+	return 0;
+}
+
 /**
  * pcpu_alloc - the percpu allocator
  * @size: size of area to allocate in bytes
@@ -1777,21 +1944,37 @@ void __percpu *pcpu_alloc_noprof(size_t size, size_t align, bool reserved,
 	if (unlikely(!pcpu_memcg_pre_alloc_hook(size, gfp, &objcg)))
 		return NULL;
 
+	if (!reserved) {
+		ptr = pcpu_area_cache_get(size, align);
+		if (ptr) {
+			void *addr = __pcpu_ptr_to_addr(ptr);
+
+			chunk = pcpu_chunk_addr_search(addr);
+			off = addr - chunk->base_addr;
+			goto area_cached;
+		}
+	}
+
 	if (!is_atomic) {
 		/*
 		 * pcpu_balance_workfn() allocates memory under this mutex,
 		 * and it may wait for memory reclaim. Allow current task
 		 * to become OOM victim, in case of memory pressure.
 		 */
-		if (gfp & __GFP_NOFAIL) {
+		if (mutex_trylock(&pcpu_alloc_mutex)) {
+			/* uncontended */
+		} else if (gfp & __GFP_NOFAIL) {
 			mutex_lock(&pcpu_alloc_mutex);
+			pcpu_stats_mutex_contended();
 		} else if (mutex_lock_killable(&pcpu_alloc_mutex)) {
 			pcpu_memcg_post_alloc_hook(objcg, NULL, 0, size);
 			return NULL;
+		} else {
+			pcpu_stats_mutex_contended();
 		}
 	}
 
-	spin_lock_irqsave(&pcpu_lock, flags);
+	pcpu_lock_irqsave(flags);
 
 	/* serve reserved allocations from the reserved chunk if available */
 	if (reserved && pcpu_reserved_chunk) {
@@ -1847,10 +2030,10 @@ void __percpu *pcpu_alloc_noprof(size_t size, size_t align, bool reserved,
 			goto fail;
 		}
 
-		spin_lock_irqsave(&pcpu_lock, flags);
+		pcpu_lock_irqsave(flags);
 		pcpu_chunk_relocate(chunk, -1);
 	} else {
-		spin_lock_irqsave(&pcpu_lock, flags);
+		pcpu_lock_irqsave(flags);
 	}
 
 	goto restart;
@@ -1888,6 +2071,7 @@ void __percpu *pcpu_alloc_noprof(size_t size, size_t align, bool reserved,
 		mutex_unlock(&pcpu_alloc_mutex);
 	}
 
+area_cached:
 	/* clear the areas and return address relative to base address */
 	for_each_possible_cpu(cpu)
 		memset((void *)pcpu_chunk_addr(chunk, cpu, 0) + off, 0, size);
@@ -2207,7 +2391,15 @@ static void pcpu_balance_workfn(struct work_struct *work)
 	 * dependency through pcpu_alloc_mutex
 	 */
 	unsigned int flags = memalloc_noio_save();
+	unsigned int cpu;
+
 	mutex_lock(&pcpu_alloc_mutex);
+
+	/* Cached areas would pin the chunks waiting to be depopulated */
+	if (!list_empty(&pcpu_chunk_lists[pcpu_to_depopulate_slot]))
+		for_each_possible_cpu(cpu)
+			pcpu_area_cache_drain(cpu);
+
 	spin_lock_irq(&pcpu_lock);
 
 	pcpu_balance_free(false);
@@ -2235,7 +2427,7 @@ void free_percpu(void __percpu *ptr)
 	struct pcpu_chunk *chunk;
 	unsigned long flags;
 	int size, off;
-	bool need_balance = false;
+	bool need_balance;
 
 	if (!ptr)
 		return;
@@ -2246,7 +2438,10 @@ void free_percpu(void __percpu *ptr)
 	chunk = pcpu_chunk_addr_search(addr);
 	off = addr - chunk->base_addr;
 
-	spin_lock_irqsave(&pcpu_lock, flags);
+	if (pcpu_area_cache_put(chunk, off, ptr))
+		return;
+
+	pcpu_lock_irqsave(flags);
 	size = pcpu_free_area(chunk, off);
 	if (size == 0) {
 		spin_unlock_irqrestore(&pcpu_lock, flags);
@@ -2260,23 +2455,7 @@ void free_percpu(void __percpu *ptr)
 
 	pcpu_memcg_free_hook(chunk, off, size);
 
-	/*
-	 * If there are more than one fully free chunks, wake up grim reaper.
-	 * If the chunk is isolated, it may be in the process of being
-	 * reclaimed.  Let reclaim manage cleaning up of that chunk.
-	 */
-	if (!chunk->isolated && chunk->free_bytes == pcpu_unit_size) {
-		struct pcpu_chunk *pos;
-
-		list_for_each_entry(pos, &pcpu_chunk_lists[pcpu_free_slot], list)
-			if (pos != chunk) {
-				need_balance = true;
-				break;
-			}
-	} else if (pcpu_should_reclaim_chunk(chunk)) {
-		pcpu_isolate_chunk(chunk);
-		need_balance = true;
-	}
+	need_balance = pcpu_chunk_area_freed(chunk);
 
 	trace_percpu_free_percpu(chunk->base_addr, off, ptr);
 
@@ -3382,7 +3561,17 @@ unsigned long pcpu_nr_pages(void)
  */
 static int __init percpu_enable_async(void)
 {
+	unsigned int cpu;
+	int ret;
+
 	pcpu_async_enabled = true;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu(pcpu_area_cache, cpu).lock);
+	ret = cpuhp_setup_state_nocalls(CPUHP_BP_PREPARE_DYN, "mm/percpu:dead",
+					NULL, pcpu_area_cache_cpu_dead);
+	WRITE_ONCE(pcpu_area_cache_enabled, ret >= 0);
+
 	return 0;
 }
 subsys_initcall(percpu_enable_async);
@@ -74,6 +74,14 @@
  * determines the size of the readahead, to which any requested read
  * size may be added.
  *
+ * With CONFIG_READAHEAD_PATTERNS, two more access patterns are recognized.
+ * A few sequential streams that are interleaved on the same file are
+ * remembered, so that a stream carries on with its own readahead window
+ * when it is returned to.  Cache misses that are not sequential are also
+ * checked for fixed-size reads at a constant stride; once the stride has
+ * repeated, the blocks predicted to come next are read ahead, and each
+ * block that the reader reaches causes one more to be read.
+ *
  * Readahead requests are sent to the filesystem using the ->readahead()
  * address space operation, for which mpage_readahead() is a canonical
  * implementation.  ->readahead() should normally initiate reads on all
@@ -574,6 +582,169 @@ static unsigned long ractl_max_pages(struct readahead_control *ractl,
 	return max_pages;
 }
 
+#ifdef CONFIG_READAHEAD_PATTERNS
+/*
+ * A stride must repeat this many times before blocks are prefetched ahead of
+ * the reader, and at most this many blocks are kept in flight.
+ */
+#define RA_STRIDE_CONFIRM	2
+#define RA_STRIDE_DEPTH		4
+
+/*
+ * Save the current window as an interleaved stream before it gets replaced,
+ * dropping the least recently used one.
+ */
+static void ra_save_stream(struct file_ra_state *ra)
+{
+	if (!ra->size)
+		return;
+
+	memmove(&ra->streams[1], &ra->streams[0],
+		sizeof(ra->streams[0]) * (FILE_RA_STREAMS - 1));
+	ra->streams[0].start = ra->start;
+	ra->streams[0].size = ra->size;
+	ra->streams[0].async_size = ra->async_size;
+}
+
+/*
+ * If @index continues one of the saved streams, make it the current window
+ * again, and save the current window in its place.
+ */
+static bool ra_resume_stream(struct readahead_control *ractl, pgoff_t index)
+{
+	struct file_ra_state *ra = ractl->ra;
+	struct file_ra_stream *stream, cur;
+	int i;
+
+	for (i = 0; i < FILE_RA_STREAMS; i++) {
+		stream = &ra->streams[i];
+		if (!stream->size || index < stream->start ||
+		    index > stream->start + stream->size)
+			continue;
+
+		cur.start = ra->start;
+		cur.size = ra->size;
+		cur.async_size = ra->async_size;
+		ra->start = stream->start;
+		ra->size = stream->size;
+		ra->async_size = stream->async_size;
+		*stream = cur;
+
+		count_vm_event(RA_STREAM_RESUME);
+		trace_page_cache_ra_stream(ractl->mapping->host, index, ra);
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Read the next predicted block, marking its first folio so that the reader
+ * reaching it is noticed by page_cache_async_ra().
+ */
+static void ra_stride_prefetch(struct readahead_control *ractl)
+{
+	struct file_ra_state *ra = ractl->ra;
+
+	ractl->_index = ra->stride_next;
+	do_page_cache_ra(ractl, ra->stride_nr, ra->stride_nr);
+	ra->stride_next += ra->stride;
+	count_vm_event(RA_STRIDE_ISSUED);
+}
+
+/*
+ * Learn the distance between non-sequential misses. Once the same stride was
+ * seen RA_STRIDE_CONFIRM times with the same request size, read the missed
+ * block and prefetch the ones that are predicted to follow it.
+ */
+static bool ra_stride_sync(struct readahead_control *ractl, pgoff_t index,
+		unsigned long req_count, unsigned long max_pages)
+{
+	struct file_ra_state *ra = ractl->ra;
+	unsigned long stride = index - ra->stride_prev;
+	unsigned long i, depth;
+
+	/* The prefetched block was not there in time, or the pattern broke */
+	if (ra->stride_count >= RA_STRIDE_CONFIRM)
+		count_vm_event(RA_STRIDE_MISS);
+
+	if (index > ra->stride_prev && stride == ra->stride &&
+	    req_count == ra->stride_nr) {
+		if (ra->stride_count < RA_STRIDE_CONFIRM)
+			ra->stride_count++;
+	} else {
+		ra->stride = index > ra->stride_prev ? stride : 0;
+		ra->stride_nr = req_count;
+		ra->stride_count = 0;
+	}
+	ra->stride_prev = index;
+
+	if (ra->stride_count < RA_STRIDE_CONFIRM ||
+	    ra->stride <= req_count || req_count > max_pages)
+		return false;
+
+	do_page_cache_ra(ractl, req_count, 0);
+
+	ra->stride_next = index + ra->stride;
+	depth = clamp_t(unsigned long, max_pages / req_count, 1,
+			RA_STRIDE_DEPTH);
+	for (i = 0; i < depth; i++)
+		ra_stride_prefetch(ractl);
+
+	trace_page_cache_ra_stride(ractl->mapping->host, index, ra, false);
+	return true;
+}
+
+/*
+ * The reader reached a prefetched block: count the hit and keep the same
+ * number of blocks in flight.
+ */
+static bool ra_stride_async(struct readahead_control *ractl, pgoff_t index)
+{
+	struct file_ra_state *ra = ractl->ra;
+	unsigned long offset;
+
+	if (ra->stride_count < RA_STRIDE_CONFIRM ||
+	    ra->stride <= ra->stride_nr ||
+	    index <= ra->stride_prev || index >= ra->stride_next)
+		return false;
+
+	offset = (index - ra->stride_prev) % ra->stride;
+	if (offset >= ra->stride_nr)
+		return false;
+
+	count_vm_event(RA_STRIDE_HIT);
+	ra->stride_prev = index - offset;
+	ra_stride_prefetch(ractl);
+
+	trace_page_cache_ra_stride(ractl->mapping->host, index, ra, true);
+	return true;
+}
+#else
+static inline void ra_save_stream(struct file_ra_state *ra)
+{
+}
+
+static inline bool ra_resume_stream(struct readahead_control *ractl,
+		pgoff_t index)
+{
+	return false;
+}
+
+static inline bool ra_stride_sync(struct readahead_control *ractl,
+		pgoff_t index, unsigned long req_count,
+		unsigned long max_pages)
+{
+	return false;
+}
+
+static inline bool ra_stride_async(struct readahead_control *ractl,
+		pgoff_t index)
+{
+	return false;
+}
+#endif /* CONFIG_READAHEAD_PATTERNS */
+
 void page_cache_sync_ra(struct readahead_control *ractl,
 		unsigned long req_count)
 {
@@ -618,6 +789,22 @@ void page_cache_sync_ra(struct readahead_control *ractl,
 		goto readit;
 	}
 
+	/*
+	 * A cache miss in one of the other streams interleaved on this file:
+	 * carry on with its window as if it was a sequential miss.
+	 */
+	if (ra_resume_stream(ractl, index)) {
+		ra->start = index;
+		ra->size = get_next_ra_size(ra, max_pages);
+		ra->async_size = ra->size > req_count ? ra->size - req_count :
+							ra->size >> 1;
+		goto readit;
+	}
+
+	/* Blocks read at a constant stride */
+	if (ra_stride_sync(ractl, index, req_count, max_pages))
+		return;
+
 	/*
 	 * Query the page cache and look for the traces(cached history pages)
 	 * that a sequential stream would leave behind.
@@ -640,6 +827,7 @@ void page_cache_sync_ra(struct readahead_control *ractl,
 	 */
 	if (miss == ULONG_MAX)
 		contig_count *= 2;
+	ra_save_stream(ra);
 	ra->start = index;
 	ra->size = min(contig_count + req_count, max_pages);
 	ra->async_size = 1;
@@ -674,6 +862,9 @@ void page_cache_async_ra(struct readahead_control *ractl,
 	if (blk_cgroup_congested())
 		return;
 
+	if (ra_stride_async(ractl, index))
+		return;
+
 	max_pages = ractl_max_pages(ractl, req_count);
 	/*
 	 * It's the expected callback index, assume sequential access.
@@ -681,6 +872,9 @@ void page_cache_async_ra(struct readahead_control *ractl,
 	 */
 	expected = round_down(ra->start + ra->size - ra->async_size,
 			folio_nr_pages(folio));
+	if (index != expected && ra_resume_stream(ractl, index))
+		expected = round_down(ra->start + ra->size - ra->async_size,
+				folio_nr_pages(folio));
 	if (index == expected) {
 		ra->start += ra->size;
 		/*
@@ -704,6 +898,7 @@ void page_cache_async_ra(struct readahead_control *ractl,
 	if (!start || start - index > max_pages)
 		return;
 
+	ra_save_stream(ra);
 	ra->start = start;
 	ra->size = start - index;	/* old async_size */
 	ra->size += req_count;
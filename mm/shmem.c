@@ -62,7 +62,7 @@ static struct vfsmount *shm_mnt __ro_after_init;
 #include <linux/backing-dev.h>
 #include <linux/writeback.h>
 #include <linux/folio_batch.h>
-#include <linux/percpu_counter.h>
+#include <linux/percpu_counter_tree.h>
 #include <linux/falloc.h>
 #include <linux/splice.h>
 #include <linux/security.h>
@@ -97,6 +97,13 @@ static struct vfsmount *shm_mnt __ro_after_init;
 /* Symlink up to this size is kmalloc'ed instead of using a swappable page */
 #define SHORT_SYMLINK_LEN 128
 
+/* Per-CPU batch of used_blocks, so that PMD sized charges skip its lock */
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+#define SHMEM_BLOCKS_BATCH max_t(unsigned int, HPAGE_PMD_NR, PERCPU_COUNTER_TREE_BATCH)
+#else
+#define SHMEM_BLOCKS_BATCH PERCPU_COUNTER_TREE_BATCH
+#endif
+
 /*
  * shmem_fallocate communicates with shmem_fault or shmem_writeout via
  * inode->i_private (with i_rwsem making sure that it has only one user at
@@ -229,13 +236,13 @@ int shmem_inode_acct_blocks(struct inode *inode, long pages)
 
 	might_sleep();	/* when quotas */
 	if (sbinfo->max_blocks) {
-		if (!percpu_counter_limited_add(&sbinfo->used_blocks,
-						sbinfo->max_blocks, pages))
+		if (!percpu_counter_tree_limited_add(&sbinfo->used_blocks,
+						     sbinfo->max_blocks, pages))
 			goto unacct;
 
 		err = dquot_alloc_block_nodirty(inode, pages);
 		if (err) {
-			percpu_counter_sub(&sbinfo->used_blocks, pages);
+			percpu_counter_tree_sub(&sbinfo->used_blocks, pages);
 			goto unacct;
 		}
 	} else {
@@ -260,7 +267,7 @@ static void shmem_inode_unacct_blocks(struct inode *inode, long pages)
 	dquot_free_block_nodirty(inode, pages);
 
 	if (sbinfo->max_blocks)
-		percpu_counter_sub(&sbinfo->used_blocks, pages);
+		percpu_counter_tree_sub(&sbinfo->used_blocks, pages);
 	shmem_unacct_blocks(info->flags, pages);
 }
 
@@ -3767,7 +3774,7 @@ static int shmem_statfs(struct dentry *dentry, struct kstatfs *buf)
 		buf->f_blocks = sbinfo->max_blocks;
 		buf->f_bavail =
 		buf->f_bfree  = sbinfo->max_blocks -
-				percpu_counter_sum(&sbinfo->used_blocks);
+				percpu_counter_tree_sum(&sbinfo->used_blocks);
 	}
 	if (sbinfo->max_inodes) {
 		buf->f_files = sbinfo->max_inodes;
@@ -4733,8 +4740,8 @@ static int shmem_reconfigure(struct fs_context *fc)
 			err = "Cannot retroactively limit size";
 			goto out;
 		}
-		if (percpu_counter_compare(&sbinfo->used_blocks,
-					   ctx->blocks) > 0) {
+		if (percpu_counter_tree_compare(&sbinfo->used_blocks,
+						ctx->blocks) > 0) {
 			err = "Too small a size for current use";
 			goto out;
 		}
@@ -4900,7 +4907,7 @@ static void shmem_put_super(struct super_block *sb)
 	shmem_disable_quotas(sb);
 #endif
 	free_percpu(sbinfo->ino_batch);
-	percpu_counter_destroy(&sbinfo->used_blocks);
+	percpu_counter_tree_destroy(&sbinfo->used_blocks);
 	mpol_put(sbinfo->mpol);
 #ifdef CONFIG_TMPFS_XATTR
 	simple_xattr_cache_cleanup(&sbinfo->xa_cache);
@@ -4992,7 +4999,8 @@ static int shmem_fill_super(struct super_block *sb, struct fs_context *fc)
 	ctx->mpol = NULL;
 
 	raw_spin_lock_init(&sbinfo->stat_lock);
-	if (percpu_counter_init(&sbinfo->used_blocks, 0, GFP_KERNEL))
+	if (percpu_counter_tree_init(&sbinfo->used_blocks, 0, SHMEM_BLOCKS_BATCH,
+				     GFP_KERNEL))
 		goto failed;
 	spin_lock_init(&sbinfo->shrinklist_lock);
 	INIT_LIST_HEAD(&sbinfo->shrinklist);
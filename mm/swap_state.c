@@ -22,6 +22,7 @@
 #include <linux/vmalloc.h>
 #include <linux/huge_mm.h>
 #include <linux/shmem_fs.h>
+#include <linux/zswap.h>
 #include "internal.h"
 #include "swap_table.h"
 #include "swap.h"
@@ -442,6 +443,13 @@ static struct folio *__swap_cache_alloc(struct swap_cluster_info *ci,
 	/* Double check the range is still not in conflict */
 	spin_lock(&ci->lock);
 	err = __swap_cache_add_check(ci, targ_entry, nr_pages, &shadow, &memcg_id);
+	/*
+	 * With the range free of other swap cache folios, zswap writeback and
+	 * invalidation can't change it until the folio is added. A range that
+	 * became partially in zswap can't be read, use a smaller order.
+	 */
+	if (!err && order && !zswap_can_load_large(entry, nr_pages))
+		err = -EBUSY;
 	if (unlikely(err)) {
 		spin_unlock(&ci->lock);
 		folio_put(folio);
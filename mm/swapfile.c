@@ -7,6 +7,7 @@
  */
 
 #include <linux/blkdev.h>
+#include <linux/debugfs.h>
 #include <linux/mm.h>
 #include <linux/sched/mm.h>
 #include <linux/sched/task.h>
@@ -410,6 +411,13 @@ static inline unsigned int cluster_offset(struct swap_info_struct *si,
 	return cluster_index(si, ci) * SWAPFILE_CLUSTER;
 }
 
+/* The shard holding the cluster while it is free or nonfull */
+static inline struct swap_cluster_shard *cluster_shard(struct swap_info_struct *si,
+						       struct swap_cluster_info *ci)
+{
+	return &si->shards[cluster_index(si, ci) / si->shard_clusters];
+}
+
 static void swap_cluster_free_table_folio_rcu_cb(struct rcu_head *head)
 {
 	struct folio *folio;
@@ -569,28 +577,65 @@ swap_cluster_populate(struct swap_info_struct *si,
 	spin_lock(&ci->lock);
 
 	if (ret) {
-		move_cluster(si, ci, &si->free_clusters, CLUSTER_FLAG_FREE);
+		move_cluster(si, ci, &cluster_shard(si, ci)->free_clusters,
+			     CLUSTER_FLAG_FREE);
 		spin_unlock(&ci->lock);
 		return NULL;
 	}
 	return ci;
 }
 
+/* The lock protecting the cluster list that a cluster with @flags is on */
+static spinlock_t *cluster_list_lock(struct swap_info_struct *si,
+				     struct swap_cluster_info *ci,
+				     enum swap_cluster_flags flags)
+{
+	if (flags == CLUSTER_FLAG_FREE || flags == CLUSTER_FLAG_NONFULL)
+		return &cluster_shard(si, ci)->lock;
+	return &si->lock;
+}
+
+static void lock_cluster_list(struct swap_info_struct *si, spinlock_t *lock)
+{
+	if (spin_trylock(lock))
+		return;
+	atomic_long_inc(&si->nr_lock_contended);
+	spin_lock(lock);
+}
+
 static void move_cluster(struct swap_info_struct *si,
 			 struct swap_cluster_info *ci, struct list_head *list,
 			 enum swap_cluster_flags new_flags)
 {
+	spinlock_t *lock = cluster_list_lock(si, ci, new_flags);
+
 	VM_WARN_ON(ci->flags == new_flags);
 
 	BUILD_BUG_ON(1 << sizeof(ci->flags) * BITS_PER_BYTE < CLUSTER_FLAG_MAX);
 	lockdep_assert_held(&ci->lock);
 
-	spin_lock(&si->lock);
+	/*
+	 * The old and new lists may be under different locks, take the
+	 * cluster off the old one first. Being off-list for a moment is
+	 * fine, list walkers skip clusters whose lock is held.
+	 */
+	if (ci->flags != CLUSTER_FLAG_NONE) {
+		spinlock_t *old_lock = cluster_list_lock(si, ci, ci->flags);
+
+		if (old_lock != lock) {
+			lock_cluster_list(si, old_lock);
+			list_del(&ci->list);
+			spin_unlock(old_lock);
+			ci->flags = CLUSTER_FLAG_NONE;
+		}
+	}
+
+	lock_cluster_list(si, lock);
 	if (ci->flags == CLUSTER_FLAG_NONE)
 		list_add_tail(&ci->list, list);
 	else
 		list_move_tail(&ci->list, list);
-	spin_unlock(&si->lock);
+	spin_unlock(lock);
 	ci->flags = new_flags;
 }
 
@@ -607,7 +652,8 @@ static void __free_cluster(struct swap_info_struct *si, struct swap_cluster_info
 {
 	swap_cluster_assert_empty(ci, 0, SWAPFILE_CLUSTER, false);
 	swap_cluster_free_table(ci);
-	move_cluster(si, ci, &si->free_clusters, CLUSTER_FLAG_FREE);
+	move_cluster(si, ci, &cluster_shard(si, ci)->free_clusters,
+		     CLUSTER_FLAG_FREE);
 	ci->order = 0;
 }
 
@@ -619,14 +665,17 @@ static void __free_cluster(struct swap_info_struct *si, struct swap_cluster_info
  *
  * Note it's possible that all clusters on a list are contented so
  * this returns NULL for an non-empty list.
+ *
+ * @lock is the lock of @list, si->lock or the lock of its shard.
  */
 static struct swap_cluster_info *isolate_lock_cluster(
-		struct swap_info_struct *si, struct list_head *list)
+		struct swap_info_struct *si, struct list_head *list,
+		spinlock_t *lock)
 {
 	struct swap_cluster_info *ci, *found = NULL;
 	u8 flags = CLUSTER_FLAG_NONE;
 
-	spin_lock(&si->lock);
+	lock_cluster_list(si, lock);
 	list_for_each_entry(ci, list, list) {
 		if (!spin_trylock(&ci->lock))
 			continue;
@@ -642,11 +691,11 @@ static struct swap_cluster_info *isolate_lock_cluster(
 		found = ci;
 		break;
 	}
-	spin_unlock(&si->lock);
+	spin_unlock(lock);
 
 	/* Cluster's table is freed when and only when it's on the free list. */
 	if (found && flags == CLUSTER_FLAG_FREE) {
-		VM_WARN_ON_ONCE(list != &si->free_clusters);
+		VM_WARN_ON_ONCE(list != &cluster_shard(si, found)->free_clusters);
 		VM_WARN_ON_ONCE(cluster_table_is_alloced(found));
 		return swap_cluster_populate(si, found);
 	}
@@ -747,7 +796,8 @@ static void partial_free_cluster(struct swap_info_struct *si,
 	lockdep_assert_held(&ci->lock);
 
 	if (ci->flags != CLUSTER_FLAG_NONFULL)
-		move_cluster(si, ci, &si->nonfull_clusters[ci->order],
+		move_cluster(si, ci,
+			     &cluster_shard(si, ci)->nonfull_clusters[ci->order],
 			     CLUSTER_FLAG_NONFULL);
 }
 
@@ -1014,13 +1064,14 @@ static unsigned int alloc_swap_scan_cluster(struct swap_info_struct *si,
 
 static unsigned int alloc_swap_scan_list(struct swap_info_struct *si,
 					 struct list_head *list,
+					 spinlock_t *lock,
 					 struct folio *folio,
 					 bool scan_all)
 {
 	unsigned int found = SWAP_ENTRY_INVALID;
 
 	do {
-		struct swap_cluster_info *ci = isolate_lock_cluster(si, list);
+		struct swap_cluster_info *ci = isolate_lock_cluster(si, list, lock);
 		unsigned long offset;
 
 		if (!ci)
@@ -1034,6 +1085,44 @@ static unsigned int alloc_swap_scan_list(struct swap_info_struct *si,
 	return found;
 }
 
+/*
+ * Allocate from the free clusters, or the nonfull clusters of @order, of the
+ * current node's shard first and then from the other shards.
+ */
+static unsigned int alloc_swap_scan_shards(struct swap_info_struct *si,
+					   enum swap_cluster_flags flags,
+					   unsigned int order,
+					   struct folio *folio,
+					   bool scan_all)
+{
+	unsigned int i, nid = numa_node_id() % si->nr_shards;
+	unsigned int found = SWAP_ENTRY_INVALID;
+
+	for (i = 0; i < si->nr_shards; i++) {
+		struct swap_cluster_shard *shard;
+		struct list_head *list;
+
+		shard = &si->shards[(nid + i) % si->nr_shards];
+		if (flags == CLUSTER_FLAG_FREE)
+			list = &shard->free_clusters;
+		else
+			list = &shard->nonfull_clusters[order];
+		/* Racy, but an empty shard is not worth its lock */
+		if (list_empty(list))
+			continue;
+
+		found = alloc_swap_scan_list(si, list, &shard->lock, folio,
+					     scan_all);
+		if (found) {
+			if (i)
+				atomic_long_inc(&si->nr_remote_alloc);
+			break;
+		}
+	}
+
+	return found;
+}
+
 static void swap_reclaim_full_clusters(struct swap_info_struct *si, bool force)
 {
 	long to_scan = 1;
@@ -1045,7 +1134,7 @@ static void swap_reclaim_full_clusters(struct swap_info_struct *si, bool force)
 	if (force)
 		to_scan = swap_usage_in_pages(si) / SWAPFILE_CLUSTER;
 
-	while ((ci = isolate_lock_cluster(si, &si->full_clusters))) {
+	while ((ci = isolate_lock_cluster(si, &si->full_clusters, &si->lock))) {
 		offset = cluster_offset(si, ci);
 		end = min(si->max, offset + SWAPFILE_CLUSTER);
 		to_scan--;
@@ -1129,19 +1218,22 @@ static unsigned long cluster_alloc_swap_entry(struct swap_info_struct *si,
 	 * to spread out the writes.
 	 */
 	if (si->flags & SWP_PAGE_DISCARD) {
-		found = alloc_swap_scan_list(si, &si->free_clusters, folio, false);
+		found = alloc_swap_scan_shards(si, CLUSTER_FLAG_FREE, 0, folio,
+					       false);
 		if (found)
 			goto done;
 	}
 
 	if (order < PMD_ORDER) {
-		found = alloc_swap_scan_list(si, &si->nonfull_clusters[order], folio, true);
+		found = alloc_swap_scan_shards(si, CLUSTER_FLAG_NONFULL, order,
+					       folio, true);
 		if (found)
 			goto done;
 	}
 
 	if (!(si->flags & SWP_PAGE_DISCARD)) {
-		found = alloc_swap_scan_list(si, &si->free_clusters, folio, false);
+		found = alloc_swap_scan_shards(si, CLUSTER_FLAG_FREE, 0, folio,
+					       false);
 		if (found)
 			goto done;
 	}
@@ -1157,7 +1249,8 @@ static unsigned long cluster_alloc_swap_entry(struct swap_info_struct *si,
 		 * failure is not critical. Scanning one cluster still
 		 * keeps the list rotated and reclaimed (for clean swap cache).
 		 */
-		found = alloc_swap_scan_list(si, &si->frag_clusters[order], folio, false);
+		found = alloc_swap_scan_list(si, &si->frag_clusters[order],
+					     &si->lock, folio, false);
 		if (found)
 			goto done;
 	}
@@ -1171,11 +1264,13 @@ static unsigned long cluster_alloc_swap_entry(struct swap_info_struct *si,
 		 * Clusters here have at least one usable slots and can't fail order 0
 		 * allocation, but reclaim may drop si->lock and race with another user.
 		 */
-		found = alloc_swap_scan_list(si, &si->frag_clusters[o], folio, true);
+		found = alloc_swap_scan_list(si, &si->frag_clusters[o],
+					     &si->lock, folio, true);
 		if (found)
 			goto done;
 
-		found = alloc_swap_scan_list(si, &si->nonfull_clusters[o], folio, true);
+		found = alloc_swap_scan_shards(si, CLUSTER_FLAG_NONFULL, o,
+					       folio, true);
 		if (found)
 			goto done;
 	}
@@ -3169,6 +3264,8 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 	mutex_unlock(&swapon_mutex);
 	kfree(p->global_cluster);
 	p->global_cluster = NULL;
+	kfree(p->shards);
+	p->shards = NULL;
 	free_swap_cluster_info(cluster_info, maxpages);
 
 	inode = mapping->host;
@@ -3323,6 +3420,66 @@ static int __init procswaps_init(void)
 __initcall(procswaps_init);
 #endif /* CONFIG_PROC_FS */
 
+#ifdef CONFIG_DEBUG_FS
+/*
+ * Per device: how often cluster list locks were found held and clusters had
+ * to come from another node's shard, then the free and per-order nonfull
+ * cluster counts of each shard, and the per-order frag, full and discard
+ * cluster counts of the device.
+ */
+static int swap_clusters_show(struct seq_file *m, void *v)
+{
+	struct swap_info_struct *si;
+	unsigned int type, i;
+	int o;
+
+	mutex_lock(&swapon_mutex);
+	for (type = 0; (si = swap_type_to_info(type)); type++) {
+		if (!si->swap_file || !si->cluster_info)
+			continue;
+
+		seq_file_path(m, si->swap_file, " \t\n\\");
+		seq_printf(m, " contended %ld remote %ld\n",
+			   atomic_long_read(&si->nr_lock_contended),
+			   atomic_long_read(&si->nr_remote_alloc));
+
+		for (i = 0; i < si->nr_shards; i++) {
+			struct swap_cluster_shard *shard = &si->shards[i];
+
+			spin_lock(&shard->lock);
+			seq_printf(m, "  node %u free %zu nonfull", i,
+				   list_count_nodes(&shard->free_clusters));
+			for (o = 0; o < SWAP_NR_ORDERS; o++)
+				seq_printf(m, " %zu",
+					   list_count_nodes(&shard->nonfull_clusters[o]));
+			spin_unlock(&shard->lock);
+			seq_putc(m, '\n');
+		}
+
+		spin_lock(&si->lock);
+		seq_puts(m, "  frag");
+		for (o = 0; o < SWAP_NR_ORDERS; o++)
+			seq_printf(m, " %zu", list_count_nodes(&si->frag_clusters[o]));
+		seq_printf(m, " full %zu discard %zu\n",
+			   list_count_nodes(&si->full_clusters),
+			   list_count_nodes(&si->discard_clusters));
+		spin_unlock(&si->lock);
+	}
+	mutex_unlock(&swapon_mutex);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(swap_clusters);
+
+static int __init swap_debugfs_init(void)
+{
+	debugfs_create_file("swap_clusters", 0400, NULL, NULL,
+			    &swap_clusters_fops);
+	return 0;
+}
+late_initcall(swap_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
+
 #ifdef MAX_SWAPFILES_CHECK
 static int __init max_swapfiles_check(void)
 {
@@ -3536,6 +3693,12 @@ static int setup_swap_clusters_info(struct swap_info_struct *si,
 		spin_lock_init(&si->global_cluster_lock);
 	}
 
+	si->nr_shards = nr_node_ids;
+	si->shard_clusters = DIV_ROUND_UP(nr_clusters, si->nr_shards);
+	si->shards = kzalloc_objs(*si->shards, si->nr_shards);
+	if (!si->shards)
+		goto err;
+
 	/*
 	 * Mark unusable pages (header page, bad pages, and the EOF part of
 	 * the last cluster) as unavailable. The clusters aren't marked free
@@ -3563,24 +3726,36 @@ static int setup_swap_clusters_info(struct swap_info_struct *si,
 			goto err;
 	}
 
-	INIT_LIST_HEAD(&si->free_clusters);
 	INIT_LIST_HEAD(&si->full_clusters);
 	INIT_LIST_HEAD(&si->discard_clusters);
 
-	for (i = 0; i < SWAP_NR_ORDERS; i++) {
-		INIT_LIST_HEAD(&si->nonfull_clusters[i]);
+	for (i = 0; i < SWAP_NR_ORDERS; i++)
 		INIT_LIST_HEAD(&si->frag_clusters[i]);
+
+	for (i = 0; i < si->nr_shards; i++) {
+		struct swap_cluster_shard *shard = &si->shards[i];
+		int o;
+
+		spin_lock_init(&shard->lock);
+		INIT_LIST_HEAD(&shard->free_clusters);
+		for (o = 0; o < SWAP_NR_ORDERS; o++)
+			INIT_LIST_HEAD(&shard->nonfull_clusters[o]);
 	}
+	atomic_long_set(&si->nr_lock_contended, 0);
+	atomic_long_set(&si->nr_remote_alloc, 0);
 
+	/* cluster_info isn't published yet, cluster_shard() can't be used */
 	for (i = 0; i < nr_clusters; i++) {
 		struct swap_cluster_info *ci = &cluster_info[i];
+		struct swap_cluster_shard *shard;
 
+		shard = &si->shards[i / si->shard_clusters];
 		if (ci->count) {
 			ci->flags = CLUSTER_FLAG_NONFULL;
-			list_add_tail(&ci->list, &si->nonfull_clusters[0]);
+			list_add_tail(&ci->list, &shard->nonfull_clusters[0]);
 		} else {
 			ci->flags = CLUSTER_FLAG_FREE;
-			list_add_tail(&ci->list, &si->free_clusters);
+			list_add_tail(&ci->list, &shard->free_clusters);
 		}
 	}
 
@@ -3797,6 +3972,8 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 bad_swap:
 	kfree(si->global_cluster);
 	si->global_cluster = NULL;
+	kfree(si->shards);
+	si->shards = NULL;
 	inode = NULL;
 	destroy_swap_extents(si, swap_file);
 	free_swap_cluster_info(si->cluster_info, si->max);
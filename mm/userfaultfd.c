@@ -959,6 +959,54 @@ static __always_inline ssize_t mfill_atomic_pte(struct mfill_state *state)
 	return -EOPNOTSUPP;
 }
 
+/*
+ * Fill [state->dst_start, state->dst_start + state->len) with the vma
+ * already locked by mfill_get_vma().  The vma may be dropped and
+ * retaken underneath, and is left locked, if at all, in state->vma.
+ */
+static ssize_t mfill_atomic_range(struct mfill_state *state)
+{
+	unsigned long src_end = state->src_start + state->len;
+	long copied = 0;
+	ssize_t err = 0;
+
+	state->src_addr = state->src_start;
+	state->dst_addr = state->dst_start;
+
+	while (state->src_addr < src_end) {
+		VM_WARN_ON_ONCE(state->dst_addr >=
+				state->dst_start + state->len);
+
+		err = mfill_establish_pmd(state);
+		if (err)
+			break;
+
+		/*
+		 * For shmem mappings, khugepaged is allowed to remove page
+		 * tables under us; pte_offset_map_lock() will deal with that.
+		 */
+
+		err = mfill_atomic_pte(state);
+		cond_resched();
+
+		if (!err) {
+			state->dst_addr += PAGE_SIZE;
+			state->src_addr += PAGE_SIZE;
+			copied += PAGE_SIZE;
+
+			if (fatal_signal_pending(current))
+				err = -EINTR;
+		}
+		if (err)
+			break;
+	}
+
+	VM_WARN_ON_ONCE(copied < 0);
+	VM_WARN_ON_ONCE(err > 0);
+	VM_WARN_ON_ONCE(!copied && !err);
+	return copied ? copied : err;
+}
+
 static __always_inline ssize_t mfill_atomic(struct userfaultfd_ctx *ctx,
 					    unsigned long dst_start,
 					    unsigned long src_start,
@@ -974,8 +1022,8 @@ static __always_inline ssize_t mfill_atomic(struct userfaultfd_ctx *ctx,
 		.src_addr = src_start,
 		.dst_addr = dst_start,
 	};
-	long copied = 0;
-	ssize_t err;
+	ssize_t copied;
+	int err;
 
 	/*
 	 * Sanitize the command parameters:
@@ -989,7 +1037,7 @@ static __always_inline ssize_t mfill_atomic(struct userfaultfd_ctx *ctx,
 
 	err = mfill_get_vma(&state);
 	if (err)
-		goto out;
+		return err;
 
 	/*
 	 * If this is a HUGETLB vma, pass off to appropriate routine
@@ -998,47 +1046,90 @@ static __always_inline ssize_t mfill_atomic(struct userfaultfd_ctx *ctx,
 		return  mfill_atomic_hugetlb(ctx, state.vma, dst_start,
 					     src_start, len, flags);
 
-	while (state.src_addr < src_start + len) {
-		VM_WARN_ON_ONCE(state.dst_addr >= dst_start + len);
+	copied = mfill_atomic_range(&state);
+	mfill_put_vma(&state);
+	return copied;
+}
 
-		err = mfill_establish_pmd(&state);
-		if (err)
-			break;
+static ssize_t mfill_atomic_copy(struct userfaultfd_ctx *ctx, unsigned long dst_start,
+			  unsigned long src_start, unsigned long len,
+			  uffd_flags_t flags)
+{
+	return mfill_atomic(ctx, dst_start, src_start, len,
+			    uffd_flags_set_mode(flags, MFILL_ATOMIC_COPY));
+}
 
-		/*
-		 * For shmem mappings, khugepaged is allowed to remove page
-		 * tables under us; pte_offset_map_lock() will deal with that.
-		 */
+/* Can the range in @state be filled without dropping the locked vma? */
+static bool mfill_vma_covers(struct mfill_state *state)
+{
+	struct vm_area_struct *vma = state->vma;
 
-		err = mfill_atomic_pte(&state);
-		cond_resched();
+	if (!vma || is_vm_hugetlb_page(vma))
+		return false;
 
-		if (!err) {
-			state.dst_addr += PAGE_SIZE;
-			state.src_addr += PAGE_SIZE;
-			copied += PAGE_SIZE;
+	return state->dst_start >= vma->vm_start &&
+	       validate_dst_vma(vma, state->dst_start + state->len);
+}
 
-			if (fatal_signal_pending(current))
-				err = -EINTR;
+/*
+ * UFFDIO_COPY_VEC: copy each range of @vec in order.  Consecutive entries
+ * falling in the same vma are filled under a single vma lock (or
+ * mmap_lock) and map_changing_lock acquisition, which is the common case
+ * when resolving scattered faults of one guest memory region.  Each entry
+ * records in its len how much of it was copied, for the caller to wake.
+ */
+static ssize_t mfill_atomic_copy_vec(struct userfaultfd_ctx *ctx,
+				     struct uffdio_vec *vec, unsigned long nr,
+				     uffd_flags_t flags)
+{
+	struct mfill_state state = (struct mfill_state){
+		.ctx = ctx,
+		.flags = uffd_flags_set_mode(flags, MFILL_ATOMIC_COPY),
+	};
+	ssize_t ret = 0, copied = 0;
+	unsigned long i;
+
+	for (i = 0; i < nr; i++) {
+		state.dst_start = vec[i].dst;
+		state.src_start = vec[i].src;
+		state.len = vec[i].len;
+		state.src_addr = state.src_start;
+		state.dst_addr = state.dst_start;
+
+		if (!mfill_vma_covers(&state)) {
+			mfill_put_vma(&state);
+			ret = mfill_get_vma(&state);
+			if (ret)
+				break;
 		}
-		if (err)
+
+		if (is_vm_hugetlb_page(state.vma)) {
+			/* Drops the locks taken by mfill_get_vma() */
+			ret = mfill_atomic_hugetlb(ctx, state.vma,
+						   state.dst_start,
+						   state.src_start, state.len,
+						   state.flags);
+			state.vma = NULL;
+		} else {
+			ret = mfill_atomic_range(&state);
+		}
+
+		if (ret < 0)
+			break;
+		copied += ret;
+		if (ret != vec[i].len) {
+			vec[i].len = ret;
+			i++;
 			break;
+		}
 	}
-
 	mfill_put_vma(&state);
-out:
-	VM_WARN_ON_ONCE(copied < 0);
-	VM_WARN_ON_ONCE(err > 0);
-	VM_WARN_ON_ONCE(!copied && !err);
-	return copied ? copied : err;
-}
 
-static ssize_t mfill_atomic_copy(struct userfaultfd_ctx *ctx, unsigned long dst_start,
-			  unsigned long src_start, unsigned long len,
-			  uffd_flags_t flags)
-{
-	return mfill_atomic(ctx, dst_start, src_start, len,
-			    uffd_flags_set_mode(flags, MFILL_ATOMIC_COPY));
+	/* Entries past the point of failure were not touched */
+	for (; i < nr; i++)
+		vec[i].len = 0;
+
+	return copied ? copied : ret;
 }
 
 static ssize_t mfill_atomic_zeropage(struct userfaultfd_ctx *ctx,
@@ -1864,95 +1955,30 @@ static void uffd_move_unlock(struct vm_area_struct *dst_vma,
 }
 #endif
 
-/**
- * move_pages - move arbitrary anonymous pages of an existing vma
- * @ctx: pointer to the userfaultfd context
- * @dst_start: start of the destination virtual memory range
- * @src_start: start of the source virtual memory range
- * @len: length of the virtual memory range
- * @mode: flags from uffdio_move.mode
- *
- * It will either use the mmap_lock in read mode or per-vma locks
- *
- * move_pages() remaps arbitrary anonymous pages atomically in zero
- * copy. It only works on non shared anonymous pages because those can
- * be relocated without generating non linear anon_vmas in the rmap
- * code.
- *
- * It provides a zero copy mechanism to handle userspace page faults.
- * The source vma pages should have mapcount == 1, which can be
- * enforced by using madvise(MADV_DONTFORK) on src vma.
- *
- * The thread receiving the page during the userland page fault
- * will receive the faulting page in the source vma through the network,
- * storage or any other I/O device (MADV_DONTFORK in the source vma
- * avoids move_pages() to fail with -EBUSY if the process forks before
- * move_pages() is called), then it will call move_pages() to map the
- * page in the faulting address in the destination vma.
- *
- * This userfaultfd command works purely via pagetables, so it's the
- * most efficient way to move physical non shared anonymous pages
- * across different virtual addresses. Unlike mremap()/mmap()/munmap()
- * it does not create any new vmas. The mapping in the destination
- * address is atomic.
- *
- * It only works if the vma protection bits are identical from the
- * source and destination vma.
- *
- * It can remap non shared anonymous pages within the same vma too.
- *
- * If the source virtual memory range has any unmapped holes, or if
- * the destination virtual memory range is not a whole unmapped hole,
- * move_pages() will fail respectively with -ENOENT or -EEXIST. This
- * provides a very strict behavior to avoid any chance of memory
- * corruption going unnoticed if there are userland race conditions.
- * Only one thread should resolve the userland page fault at any given
- * time for any given faulting address. This means that if two threads
- * try to both call move_pages() on the same destination address at the
- * same time, the second thread will get an explicit error from this
- * command.
- *
- * The command retval will return "len" is successful. The command
- * however can be interrupted by fatal signals or errors. If
- * interrupted it will return the number of bytes successfully
- * remapped before the interruption if any, or the negative error if
- * none. It will never return zero. Either it will return an error or
- * an amount of bytes successfully moved. If the retval reports a
- * "short" remap, the move_pages() command should be repeated by
- * userland with src+retval, dst+reval, len-retval if it wants to know
- * about the error that interrupted it.
- *
- * The UFFDIO_MOVE_MODE_ALLOW_SRC_HOLES flag can be specified to
- * prevent -ENOENT errors to materialize if there are holes in the
- * source virtual range that is being remapped. The holes will be
- * accounted as successfully remapped in the retval of the
- * command. This is mostly useful to remap hugepage naturally aligned
- * virtual regions without knowing if there are transparent hugepage
- * in the regions or not, but preventing the risk of having to split
- * the hugepmd during the remap.
+static void move_pages_unlock(struct userfaultfd_ctx *ctx,
+			      struct vm_area_struct *dst_vma,
+			      struct vm_area_struct *src_vma)
+{
+	up_read(&ctx->map_changing_lock);
+	uffd_move_unlock(dst_vma, src_vma);
+}
+
+/*
+ * Lock the vmas of a move and check the ranges can be moved between
+ * them.  On success the vmas must be released with move_pages_unlock().
  */
-static ssize_t move_pages(struct userfaultfd_ctx *ctx, unsigned long dst_start,
-		   unsigned long src_start, unsigned long len, __u64 mode)
+static int move_pages_lock(struct userfaultfd_ctx *ctx,
+			   unsigned long dst_start, unsigned long src_start,
+			   unsigned long len, struct vm_area_struct **dst_vmap,
+			   struct vm_area_struct **src_vmap)
 {
-	struct mm_struct *mm = ctx->mm;
 	struct vm_area_struct *src_vma, *dst_vma;
-	unsigned long src_addr, dst_addr, src_end;
-	pmd_t *src_pmd, *dst_pmd;
-	long err = -EINVAL;
-	ssize_t moved = 0;
-
-	/* Sanitize the command parameters. */
-	VM_WARN_ON_ONCE(src_start & ~PAGE_MASK);
-	VM_WARN_ON_ONCE(dst_start & ~PAGE_MASK);
-	VM_WARN_ON_ONCE(len & ~PAGE_MASK);
-
-	/* Does the address range wrap, or is the span zero-sized? */
-	VM_WARN_ON_ONCE(src_start + len < src_start);
-	VM_WARN_ON_ONCE(dst_start + len < dst_start);
+	int err;
 
-	err = uffd_move_lock(mm, dst_start, src_start, &dst_vma, &src_vma);
+	err = uffd_move_lock(ctx->mm, dst_start, src_start, &dst_vma,
+			     &src_vma);
 	if (err)
-		goto out;
+		return err;
 
 	/* Re-check after taking map_changing_lock */
 	err = -EAGAIN;
@@ -1979,6 +2005,28 @@ static ssize_t move_pages(struct userfaultfd_ctx *ctx, unsigned long dst_start,
 	if (err)
 		goto out_unlock;
 
+	*dst_vmap = dst_vma;
+	*src_vmap = src_vma;
+	return 0;
+
+out_unlock:
+	move_pages_unlock(ctx, dst_vma, src_vma);
+	return err;
+}
+
+static ssize_t move_pages_locked(struct userfaultfd_ctx *ctx,
+				 struct vm_area_struct *dst_vma,
+				 struct vm_area_struct *src_vma,
+				 unsigned long dst_start,
+				 unsigned long src_start,
+				 unsigned long len, __u64 mode)
+{
+	struct mm_struct *mm = ctx->mm;
+	unsigned long src_addr, dst_addr, src_end;
+	pmd_t *src_pmd, *dst_pmd;
+	long err = 0;
+	ssize_t moved = 0;
+
 	for (src_addr = src_start, dst_addr = dst_start, src_end = src_start + len;
 	     src_addr < src_end;) {
 		spinlock_t *ptl;
@@ -2096,16 +2144,168 @@ static ssize_t move_pages(struct userfaultfd_ctx *ctx, unsigned long dst_start,
 		moved += step_size;
 	}
 
-out_unlock:
-	up_read(&ctx->map_changing_lock);
-	uffd_move_unlock(dst_vma, src_vma);
-out:
 	VM_WARN_ON_ONCE(moved < 0);
 	VM_WARN_ON_ONCE(err > 0);
 	VM_WARN_ON_ONCE(!moved && !err);
 	return moved ? moved : err;
 }
 
+/**
+ * move_pages - move arbitrary anonymous pages of an existing vma
+ * @ctx: pointer to the userfaultfd context
+ * @dst_start: start of the destination virtual memory range
+ * @src_start: start of the source virtual memory range
+ * @len: length of the virtual memory range
+ * @mode: flags from uffdio_move.mode
+ *
+ * It will either use the mmap_lock in read mode or per-vma locks
+ *
+ * move_pages() remaps arbitrary anonymous pages atomically in zero
+ * copy. It only works on non shared anonymous pages because those can
+ * be relocated without generating non linear anon_vmas in the rmap
+ * code.
+ *
+ * It provides a zero copy mechanism to handle userspace page faults.
+ * The source vma pages should have mapcount == 1, which can be
+ * enforced by using madvise(MADV_DONTFORK) on src vma.
+ *
+ * The thread receiving the page during the userland page fault
+ * will receive the faulting page in the source vma through the network,
+ * storage or any other I/O device (MADV_DONTFORK in the source vma
+ * avoids move_pages() to fail with -EBUSY if the process forks before
+ * move_pages() is called), then it will call move_pages() to map the
+ * page in the faulting address in the destination vma.
+ *
+ * This userfaultfd command works purely via pagetables, so it's the
+ * most efficient way to move physical non shared anonymous pages
+ * across different virtual addresses. Unlike mremap()/mmap()/munmap()
+ * it does not create any new vmas. The mapping in the destination
+ * address is atomic.
+ *
+ * It only works if the vma protection bits are identical from the
+ * source and destination vma.
+ *
+ * It can remap non shared anonymous pages within the same vma too.
+ *
+ * If the source virtual memory range has any unmapped holes, or if
+ * the destination virtual memory range is not a whole unmapped hole,
+ * move_pages() will fail respectively with -ENOENT or -EEXIST. This
+ * provides a very strict behavior to avoid any chance of memory
+ * corruption going unnoticed if there are userland race conditions.
+ * Only one thread should resolve the userland page fault at any given
+ * time for any given faulting address. This means that if two threads
+ * try to both call move_pages() on the same destination address at the
+ * same time, the second thread will get an explicit error from this
+ * command.
+ *
+ * The command retval will return "len" is successful. The command
+ * however can be interrupted by fatal signals or errors. If
+ * interrupted it will return the number of bytes successfully
+ * remapped before the interruption if any, or the negative error if
+ * none. It will never return zero. Either it will return an error or
+ * an amount of bytes successfully moved. If the retval reports a
+ * "short" remap, the move_pages() command should be repeated by
+ * userland with src+retval, dst+reval, len-retval if it wants to know
+ * about the error that interrupted it.
+ *
+ * The UFFDIO_MOVE_MODE_ALLOW_SRC_HOLES flag can be specified to
+ * prevent -ENOENT errors to materialize if there are holes in the
+ * source virtual range that is being remapped. The holes will be
+ * accounted as successfully remapped in the retval of the
+ * command. This is mostly useful to remap hugepage naturally aligned
+ * virtual regions without knowing if there are transparent hugepage
+ * in the regions or not, but preventing the risk of having to split
+ * the hugepmd during the remap.
+ */
+static ssize_t move_pages(struct userfaultfd_ctx *ctx, unsigned long dst_start,
+		   unsigned long src_start, unsigned long len, __u64 mode)
+{
+	struct vm_area_struct *src_vma, *dst_vma;
+	ssize_t moved;
+	int err;
+
+	/* Sanitize the command parameters. */
+	VM_WARN_ON_ONCE(src_start & ~PAGE_MASK);
+	VM_WARN_ON_ONCE(dst_start & ~PAGE_MASK);
+	VM_WARN_ON_ONCE(len & ~PAGE_MASK);
+
+	/* Does the address range wrap, or is the span zero-sized? */
+	VM_WARN_ON_ONCE(src_start + len < src_start);
+	VM_WARN_ON_ONCE(dst_start + len < dst_start);
+
+	err = move_pages_lock(ctx, dst_start, src_start, len, &dst_vma,
+			      &src_vma);
+	if (err)
+		return err;
+
+	moved = move_pages_locked(ctx, dst_vma, src_vma, dst_start, src_start,
+				  len, mode);
+	move_pages_unlock(ctx, dst_vma, src_vma);
+	return moved;
+}
+
+/* Can @v be moved without dropping the locked vmas? */
+static bool move_vmas_cover(struct vm_area_struct *dst_vma,
+			    struct vm_area_struct *src_vma,
+			    const struct uffdio_vec *v)
+{
+	return v->dst >= dst_vma->vm_start &&
+	       v->dst + v->len <= dst_vma->vm_end &&
+	       v->src >= src_vma->vm_start &&
+	       v->src + v->len <= src_vma->vm_end;
+}
+
+/*
+ * UFFDIO_MOVE_VEC: the vectored flavour of move_pages().  The vmas and
+ * map_changing_lock are held across consecutive entries as long as they
+ * stay within the same source and destination vmas.  Each entry records
+ * in its len how much of it was moved, for the caller to wake.
+ */
+static ssize_t move_pages_vec(struct userfaultfd_ctx *ctx,
+			      struct uffdio_vec *vec, unsigned long nr,
+			      __u64 mode)
+{
+	struct vm_area_struct *src_vma = NULL, *dst_vma = NULL;
+	ssize_t ret = 0, moved = 0;
+	unsigned long i;
+
+	for (i = 0; i < nr; i++) {
+		struct uffdio_vec *v = &vec[i];
+
+		if (dst_vma && !move_vmas_cover(dst_vma, src_vma, v)) {
+			move_pages_unlock(ctx, dst_vma, src_vma);
+			dst_vma = NULL;
+		}
+		if (!dst_vma) {
+			ret = move_pages_lock(ctx, v->dst, v->src, v->len,
+					      &dst_vma, &src_vma);
+			if (ret) {
+				dst_vma = NULL;
+				break;
+			}
+		}
+
+		ret = move_pages_locked(ctx, dst_vma, src_vma, v->dst, v->src,
+					v->len, mode);
+		if (ret < 0)
+			break;
+		moved += ret;
+		if (ret != v->len) {
+			v->len = ret;
+			i++;
+			break;
+		}
+	}
+	if (dst_vma)
+		move_pages_unlock(ctx, dst_vma, src_vma);
+
+	/* Entries past the point of failure were not touched */
+	for (; i < nr; i++)
+		vec[i].len = 0;
+
+	return moved ? moved : ret;
+}
+
 static bool vma_can_userfault(struct vm_area_struct *vma, vm_flags_t vm_flags,
 		       bool wp_async)
 {
@@ -3496,21 +3696,28 @@ static ssize_t userfaultfd_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	}
 }
 
-static void __wake_userfault(struct userfaultfd_ctx *ctx,
-			     struct userfaultfd_wake_range *range)
+static void __wake_userfault_locked(struct userfaultfd_ctx *ctx,
+				    struct userfaultfd_wake_range *range)
 {
-	spin_lock_irq(&ctx->fault_pending_wqh.lock);
+	lockdep_assert_held(&ctx->fault_pending_wqh.lock);
+
 	/* wake all in the range and autoremove */
 	if (waitqueue_active(&ctx->fault_pending_wqh))
 		__wake_up_locked_key(&ctx->fault_pending_wqh, TASK_NORMAL,
 				     range);
 	if (waitqueue_active(&ctx->fault_wqh))
 		__wake_up(&ctx->fault_wqh, TASK_NORMAL, 1, range);
+}
+
+static void __wake_userfault(struct userfaultfd_ctx *ctx,
+			     struct userfaultfd_wake_range *range)
+{
+	spin_lock_irq(&ctx->fault_pending_wqh.lock);
+	__wake_userfault_locked(ctx, range);
 	spin_unlock_irq(&ctx->fault_pending_wqh.lock);
 }
 
-static __always_inline void wake_userfault(struct userfaultfd_ctx *ctx,
-					   struct userfaultfd_wake_range *range)
+static __always_inline bool userfault_need_wakeup(struct userfaultfd_ctx *ctx)
 {
 	unsigned seq;
 	bool need_wakeup;
@@ -3536,10 +3743,51 @@ static __always_inline void wake_userfault(struct userfaultfd_ctx *ctx,
 			waitqueue_active(&ctx->fault_wqh);
 		cond_resched();
 	} while (read_seqcount_retry(&ctx->refile_seq, seq));
-	if (need_wakeup)
+
+	return need_wakeup;
+}
+
+static __always_inline void wake_userfault(struct userfaultfd_ctx *ctx,
+					   struct userfaultfd_wake_range *range)
+{
+	if (userfault_need_wakeup(ctx))
 		__wake_userfault(ctx, range);
 }
 
+/*
+ * Wake the faults resolved by a vectored ioctl: the barrier and the
+ * waitqueue check are paid once, adjacent entries are coalesced into a
+ * single range and all ranges are woken under one waitqueue lock hold.
+ */
+static void wake_userfault_vec(struct userfaultfd_ctx *ctx,
+			       const struct uffdio_vec *vec, unsigned long nr)
+{
+	struct userfaultfd_wake_range range = { .len = 0 };
+	unsigned long i;
+
+	if (!userfault_need_wakeup(ctx))
+		return;
+
+	spin_lock_irq(&ctx->fault_pending_wqh.lock);
+	for (i = 0; i < nr; i++) {
+		/* Entries are processed in order, the rest was not done */
+		if (!vec[i].len)
+			break;
+		if (range.len && range.start + range.len == vec[i].dst) {
+			range.len += vec[i].len;
+			continue;
+		}
+		/* len == 0 would wake all */
+		if (range.len)
+			__wake_userfault_locked(ctx, &range);
+		range.start = vec[i].dst;
+		range.len = vec[i].len;
+	}
+	if (range.len)
+		__wake_userfault_locked(ctx, &range);
+	spin_unlock_irq(&ctx->fault_pending_wqh.lock);
+}
+
 static __always_inline int validate_unaligned_range(
 	struct mm_struct *mm, __u64 start, __u64 len)
 {
@@ -3970,6 +4218,111 @@ static int userfaultfd_copy(struct userfaultfd_ctx *ctx,
 	return ret;
 }
 
+/*
+ * Copy in the array of a vectored ioctl and validate every entry up
+ * front, so that a malformed entry fails the call before anything is
+ * done.  @src_aligned is false for UFFDIO_COPY_VEC, which like
+ * UFFDIO_COPY accepts a source that is not page aligned.
+ */
+static struct uffdio_vec *uffdio_vec_import(struct mm_struct *mm,
+					    __u64 uvec, __u64 nr,
+					    bool src_aligned)
+{
+	struct uffdio_vec *vec;
+	unsigned long i;
+	int ret;
+
+	if (!nr || nr > UFFDIO_VEC_MAX)
+		return ERR_PTR(-EINVAL);
+
+	vec = memdup_array_user(u64_to_user_ptr(uvec), nr, sizeof(*vec));
+	if (IS_ERR(vec))
+		return vec;
+
+	for (i = 0; i < nr; i++) {
+		ret = validate_range(mm, vec[i].dst, vec[i].len);
+		if (ret)
+			goto out_free;
+		if (src_aligned)
+			ret = validate_range(mm, vec[i].src, vec[i].len);
+		else
+			ret = validate_unaligned_range(mm, vec[i].src,
+						       vec[i].len);
+		if (ret)
+			goto out_free;
+	}
+
+	return vec;
+
+out_free:
+	kfree(vec);
+	return ERR_PTR(ret);
+}
+
+static int userfaultfd_copy_vec(struct userfaultfd_ctx *ctx,
+				unsigned long arg)
+{
+	__s64 ret;
+	struct uffdio_copy_vec uffdio_copy_vec;
+	struct uffdio_copy_vec __user *user_uffdio_copy_vec;
+	struct uffdio_vec *vec;
+	uffd_flags_t flags = 0;
+	__u64 len = 0;
+	unsigned long i;
+
+	user_uffdio_copy_vec = (struct uffdio_copy_vec __user *) arg;
+
+	ret = -EAGAIN;
+	if (unlikely(atomic_read(&ctx->mmap_changing))) {
+		if (unlikely(put_user(ret, &user_uffdio_copy_vec->copy)))
+			return -EFAULT;
+		goto out;
+	}
+
+	ret = -EFAULT;
+	if (copy_from_user(&uffdio_copy_vec, user_uffdio_copy_vec,
+			   /* don't copy "copy" last field */
+			   sizeof(uffdio_copy_vec)-sizeof(__s64)))
+		goto out;
+
+	ret = -EINVAL;
+	if (uffdio_copy_vec.mode & ~(UFFDIO_COPY_MODE_DONTWAKE|
+				     UFFDIO_COPY_MODE_WP))
+		goto out;
+	if (uffdio_copy_vec.mode & UFFDIO_COPY_MODE_WP)
+		flags |= MFILL_ATOMIC_WP;
+
+	vec = uffdio_vec_import(ctx->mm, uffdio_copy_vec.vec,
+				uffdio_copy_vec.nr, false);
+	if (IS_ERR(vec))
+		return PTR_ERR(vec);
+	for (i = 0; i < uffdio_copy_vec.nr; i++)
+		len += vec[i].len;
+
+	if (mmget_not_zero(ctx->mm)) {
+		ret = mfill_atomic_copy_vec(ctx, vec, uffdio_copy_vec.nr,
+					    flags);
+		mmput(ctx->mm);
+	} else {
+		ret = -ESRCH;
+		goto out_free;
+	}
+	if (unlikely(put_user(ret, &user_uffdio_copy_vec->copy))) {
+		ret = -EFAULT;
+		goto out_free;
+	}
+	if (ret < 0)
+		goto out_free;
+	VM_WARN_ON_ONCE(!ret);
+	if (!(uffdio_copy_vec.mode & UFFDIO_COPY_MODE_DONTWAKE))
+		wake_userfault_vec(ctx, vec, uffdio_copy_vec.nr);
+	ret = ret == len ? 0 : -EAGAIN;
+out_free:
+	kfree(vec);
+out:
+	return ret;
+}
+
 static int userfaultfd_zeropage(struct userfaultfd_ctx *ctx,
 				unsigned long arg)
 {
@@ -4273,6 +4626,73 @@ static int userfaultfd_move(struct userfaultfd_ctx *ctx,
 	return ret;
 }
 
+static int userfaultfd_move_vec(struct userfaultfd_ctx *ctx,
+				unsigned long arg)
+{
+	__s64 ret;
+	struct uffdio_move_vec uffdio_move_vec;
+	struct uffdio_move_vec __user *user_uffdio_move_vec;
+	struct mm_struct *mm = ctx->mm;
+	struct uffdio_vec *vec;
+	__u64 len = 0;
+	unsigned long i;
+
+	user_uffdio_move_vec = (struct uffdio_move_vec __user *) arg;
+
+	ret = -EAGAIN;
+	if (unlikely(atomic_read(&ctx->mmap_changing))) {
+		if (unlikely(put_user(ret, &user_uffdio_move_vec->move)))
+			return -EFAULT;
+		goto out;
+	}
+
+	if (copy_from_user(&uffdio_move_vec, user_uffdio_move_vec,
+			   /* don't copy "move" last field */
+			   sizeof(uffdio_move_vec)-sizeof(__s64)))
+		return -EFAULT;
+
+	/* Do not allow cross-mm moves. */
+	if (mm != current->mm)
+		return -EINVAL;
+
+	if (uffdio_move_vec.mode & ~(UFFDIO_MOVE_MODE_ALLOW_SRC_HOLES|
+				     UFFDIO_MOVE_MODE_DONTWAKE))
+		return -EINVAL;
+
+	vec = uffdio_vec_import(mm, uffdio_move_vec.vec, uffdio_move_vec.nr,
+				true);
+	if (IS_ERR(vec))
+		return PTR_ERR(vec);
+	for (i = 0; i < uffdio_move_vec.nr; i++)
+		len += vec[i].len;
+
+	if (mmget_not_zero(mm)) {
+		ret = move_pages_vec(ctx, vec, uffdio_move_vec.nr,
+				     uffdio_move_vec.mode);
+		mmput(mm);
+	} else {
+		ret = -ESRCH;
+		goto out_free;
+	}
+
+	if (unlikely(put_user(ret, &user_uffdio_move_vec->move))) {
+		ret = -EFAULT;
+		goto out_free;
+	}
+	if (ret < 0)
+		goto out_free;
+
+	VM_WARN_ON(!ret);
+	if (!(uffdio_move_vec.mode & UFFDIO_MOVE_MODE_DONTWAKE))
+		wake_userfault_vec(ctx, vec, uffdio_move_vec.nr);
+	ret = ret == len ? 0 : -EAGAIN;
+
+out_free:
+	kfree(vec);
+out:
+	return ret;
+}
+
 /*
  * userland asks for a certain API version and we return which bits
  * and ioctl commands are implemented in this kernel for such API
@@ -4373,6 +4793,12 @@ static long userfaultfd_ioctl(struct file *file, unsigned cmd,
 	case UFFDIO_MOVE:
 		ret = userfaultfd_move(ctx, arg);
 		break;
+	case UFFDIO_COPY_VEC:
+		ret = userfaultfd_copy_vec(ctx, arg);
+		break;
+	case UFFDIO_MOVE_VEC:
+		ret = userfaultfd_move_vec(ctx, arg);
+		break;
 	case UFFDIO_WRITEPROTECT:
 		ret = userfaultfd_writeprotect(ctx, arg);
 		break;
@@ -917,11 +917,12 @@ struct rb_list {
 };
 
 /*
- * A fast size storage contains VAs up to 1M size. A pool consists
- * of linked between each other ready to go VAs of certain sizes.
- * An index in the pool-array corresponds to number of pages + 1.
+ * A fast size storage contains VAs up to 2M size plus a guard page.
+ * A pool consists of linked between each other ready to go VAs of
+ * certain sizes. An index in the pool-array corresponds to number
+ * of pages + 1.
  */
-#define MAX_VA_SIZE_PAGES 256
+#define MAX_VA_SIZE_PAGES 513
 
 struct vmap_pool {
 	struct list_head head;
@@ -960,6 +961,27 @@ static struct vmap_node *vmap_nodes = &single;
 static __read_mostly unsigned int nr_vmap_nodes = 1;
 static __read_mostly unsigned int vmap_zone_size = 1;
 
+/*
+ * A per-CPU front of the pools for mid-sized VAs. A pool hit of such
+ * a size moves a few more VAs of the same size here, so that vmalloc()
+ * and vfree() churn of those sizes mostly avoids the node's pool_lock.
+ * The lock is only contended by a purge decaying the cache.
+ */
+#define VMAP_CPU_CACHE_MIN_SIZE	SZ_64K
+#define VMAP_CPU_CACHE_MAX_SIZE	(SZ_2M + PAGE_SIZE)
+#define VMAP_CPU_CACHE_DEPTH	8
+#define VMAP_CPU_CACHE_BATCH	4
+
+struct vmap_cpu_cache {
+	spinlock_t lock;
+	unsigned int nr;
+	/* Hit since the last decay, otherwise the next one drains it. */
+	bool used;
+	struct vmap_area *va[VMAP_CPU_CACHE_DEPTH];
+};
+
+static DEFINE_PER_CPU(struct vmap_cpu_cache, vmap_cpu_cache);
+
 /* A simple iterator over all vmap-nodes. */
 #define for_each_vmap_node(vn)	\
 	for ((vn) = &vmap_nodes[0];	\
@@ -1936,14 +1958,112 @@ node_pool_add_va(struct vmap_node *n, struct vmap_area *va)
 	return true;
 }
 
+static __always_inline bool
+is_cpu_cache_size(unsigned long size)
+{
+	return size >= VMAP_CPU_CACHE_MIN_SIZE &&
+		size <= VMAP_CPU_CACHE_MAX_SIZE;
+}
+
+static struct vmap_area *
+cpu_cache_del_va(unsigned long size, unsigned long align,
+		unsigned long vstart, unsigned long vend)
+{
+	struct vmap_cpu_cache *vc;
+	struct vmap_area *va = NULL;
+	int i;
+
+	if (!is_cpu_cache_size(size))
+		return NULL;
+
+	vc = raw_cpu_ptr(&vmap_cpu_cache);
+	if (!READ_ONCE(vc->nr))
+		return NULL;
+
+	spin_lock(&vc->lock);
+	/* Most recently cached first. */
+	for (i = vc->nr - 1; i >= 0; i--) {
+		struct vmap_area *tmp = vc->va[i];
+
+		if (va_size(tmp) != size || !IS_ALIGNED(tmp->va_start, align))
+			continue;
+		if (tmp->va_start < vstart || tmp->va_end > vend)
+			continue;
+
+		va = tmp;
+		vc->va[i] = vc->va[--vc->nr];
+		vc->used = true;
+		break;
+	}
+	spin_unlock(&vc->lock);
+
+	return va;
+}
+
+/*
+ * Move VAs from @head to this CPU's cache, as long as it has room.
+ * What does not fit is left on @head. Returns the number moved.
+ */
+static int
+cpu_cache_add_list(struct list_head *head)
+{
+	struct vmap_cpu_cache *vc = raw_cpu_ptr(&vmap_cpu_cache);
+	struct vmap_area *va;
+	int nr = 0;
+
+	spin_lock(&vc->lock);
+	while (!list_empty(head) && vc->nr < VMAP_CPU_CACHE_DEPTH) {
+		va = list_first_entry(head, struct vmap_area, list);
+		list_del_init(&va->list);
+		vc->va[vc->nr++] = va;
+		nr++;
+	}
+	spin_unlock(&vc->lock);
+
+	return nr;
+}
+
+static void reclaim_list_global(struct list_head *head);
+
+/*
+ * Give the cached VAs back to the global heap: all of them if
+ * @full_decay, otherwise only from CPUs that had no hit since
+ * the previous decay.
+ */
+static void
+decay_cpu_caches(bool full_decay)
+{
+	LIST_HEAD(decay_list);
+	struct vmap_cpu_cache *vc;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		vc = per_cpu_ptr(&vmap_cpu_cache, cpu);
+		if (!READ_ONCE(vc->nr))
+			continue;
+
+		spin_lock(&vc->lock);
+		if (full_decay || !vc->used) {
+			while (vc->nr)
+				list_add(&vc->va[--vc->nr]->list, &decay_list);
+		}
+		vc->used = false;
+		spin_unlock(&vc->lock);
+	}
+
+	reclaim_list_global(&decay_list);
+}
+
 static struct vmap_area *
 node_pool_del_va(struct vmap_node *vn, unsigned long size,
 		unsigned long align, unsigned long vstart,
 		unsigned long vend)
 {
-	struct vmap_area *va = NULL;
+	struct vmap_area *va = NULL, *tmp;
 	struct vmap_pool *vp;
+	LIST_HEAD(refill);
 	int err = 0;
+	int i = 0;
 
 	vp = size_to_va_pool(vn, size);
 	if (!vp || list_empty(&vp->head))
@@ -1973,8 +2093,32 @@ node_pool_del_va(struct vmap_node *vn, unsigned long size,
 			va = NULL;
 		}
 	}
+
+	/* Stock this CPU up with a few more of a size that is in use. */
+	if (va && is_cpu_cache_size(size)) {
+		for (i = 0; i < VMAP_CPU_CACHE_BATCH; i++) {
+			if (list_empty(&vp->head))
+				break;
+
+			tmp = list_first_entry(&vp->head, struct vmap_area, list);
+			list_move_tail(&tmp->list, &refill);
+			WRITE_ONCE(vp->len, vp->len - 1);
+		}
+	}
 	spin_unlock(&vn->pool_lock);
 
+	if (i) {
+		i -= cpu_cache_add_list(&refill);
+
+		/* The cache had no room for these, put them back. */
+		if (i) {
+			spin_lock(&vn->pool_lock);
+			list_splice(&refill, &vp->head);
+			WRITE_ONCE(vp->len, vp->len + i);
+			spin_unlock(&vn->pool_lock);
+		}
+	}
+
 	return va;
 }
 
@@ -1997,7 +2141,10 @@ node_alloc(unsigned long size, unsigned long align,
 		return NULL;
 
 	*vn_id = raw_smp_processor_id() % nr_vmap_nodes;
-	va = node_pool_del_va(id_to_node(*vn_id), size, align, vstart, vend);
+	va = cpu_cache_del_va(size, align, vstart, vend);
+	if (!va)
+		va = node_pool_del_va(id_to_node(*vn_id), size, align,
+				vstart, vend);
 	*vn_id = encode_vn_id(*vn_id);
 
 	if (va)
@@ -2199,18 +2346,33 @@ static DEFINE_MUTEX(vmap_purge_lock);
 /* for per-CPU blocks */
 static void purge_fragmented_blocks_allcpus(void);
 
+/*
+ * Number of VAs merged back into the global heap per free_vmap_area_lock
+ * hold, so that a large purge does not stall allocators behind it.
+ */
+#define VMAP_RECLAIM_BATCH_SIZE 64
+
 static void
 reclaim_list_global(struct list_head *head)
 {
 	struct vmap_area *va, *n;
+	unsigned int batch_count = 0;
 
 	if (list_empty(head))
 		return;
 
 	spin_lock(&free_vmap_area_lock);
-	list_for_each_entry_safe(va, n, head, list)
+	list_for_each_entry_safe(va, n, head, list) {
 		merge_or_add_vmap_area_augment(va,
 			&free_vmap_area_root, &free_vmap_area_list);
+
+		if (++batch_count >= VMAP_RECLAIM_BATCH_SIZE) {
+			spin_unlock(&free_vmap_area_lock);
+			cond_resched();
+			spin_lock(&free_vmap_area_lock);
+			batch_count = 0;
+		}
+	}
 	spin_unlock(&free_vmap_area_lock);
 }
 
@@ -2348,6 +2510,7 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end,
 	 * Use cpumask to mark which node has to be processed.
 	 */
 	purge_nodes = CPU_MASK_NONE;
+	decay_cpu_caches(full_pool_decay);
 
 	for_each_vmap_node(vn) {
 		INIT_LIST_HEAD(&vn->purge_list);
@@ -5492,6 +5655,9 @@ vmap_node_shrink_count(struct shrinker *shrink, struct shrink_control *sc)
 			count += READ_ONCE(vn->pool[i].len);
 	}
 
+	for_each_possible_cpu(i)
+		count += READ_ONCE(per_cpu_ptr(&vmap_cpu_cache, i)->nr);
+
 	return count ? count : SHRINK_EMPTY;
 }
 
@@ -5501,6 +5667,7 @@ vmap_node_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 	struct vmap_node *vn;
 
 	guard(mutex)(&vmap_purge_lock);
+	decay_cpu_caches(true);
 	for_each_vmap_node(vn)
 		decay_va_pool_node(vn, true);
 
@@ -5531,6 +5698,7 @@ void __init vmalloc_init(void)
 		init_llist_head(&p->list);
 		INIT_WORK(&p->wq, delayed_vfree_work);
 		xa_init(&vbq->vmap_blocks);
+		spin_lock_init(&per_cpu(vmap_cpu_cache, i).lock);
 	}
 
 	/*
@@ -149,6 +149,9 @@ struct scan_control {
 	/* Always discard instead of demoting to lower tier memory */
 	unsigned int no_demotion:1;
 
+	/* kswapd helper threads are reclaiming the same node alongside */
+	unsigned int kswapd_parallel:1;
+
 	/* Allocation order */
 	s8 order;
 
@@ -179,6 +182,41 @@ struct scan_control {
 	struct reclaim_state reclaim_state;
 };
 
+/* Upper bound of /sys/devices/system/node/nodeN/kswapd_threads */
+#define KSWAPD_MAX_THREADS	16
+
+struct kswapd_helper {
+	struct pglist_data *pgdat;
+	struct task_struct *task;
+#ifdef CONFIG_LRU_GEN
+	/* like pgdat->mm_walk, which belongs to kswapd itself */
+	struct lru_gen_mm_walk mm_walk;
+#endif
+};
+
+/*
+ * The reclaim threads of a node besides kswapd. For every shrink_node() pass,
+ * kswapd publishes its scan_control in @pass; the helpers that are idle run
+ * the same pass on their own copy and hand their progress back before kswapd
+ * looks at it. Stragglers that show up after kswapd closed the pass sit it out.
+ */
+struct kswapd_helpers {
+	spinlock_t lock;
+	struct scan_control pass;
+	bool open;			/* @pass can still be joined */
+	unsigned long seq;		/* bumped for every pass */
+	int nr_running;			/* helpers inside the pass */
+	unsigned long nr_reclaimed;
+	unsigned long nr_scanned;
+	wait_queue_head_t pass_wait;	/* helpers wait for a pass here */
+	wait_queue_head_t done_wait;	/* kswapd waits for the helpers here */
+
+	int nr;				/* Protected by kswapd_helpers_lock */
+	struct kswapd_helper *helper[KSWAPD_MAX_THREADS - 1];
+};
+
+static DEFINE_MUTEX(kswapd_helpers_lock);
+
 #ifdef ARCH_HAS_PREFETCHW
 #define prefetchw_prev_lru_folio(_folio, _base, _field)			\
 	do {								\
@@ -3457,6 +3495,80 @@ static void walk_update_folio(struct lru_gen_mm_walk *walk, struct folio *folio,
 	}
 }
 
+#ifdef CONFIG_NUMA_BALANCING
+/*
+ * With NUMA_BALANCING_MGLRU, the accessed bits the mm walk harvests replace
+ * the hinting faults: a young folio that is not on the node its mm mostly
+ * runs on is isolated under the PTL and migrated by walk_numa_migrate() once
+ * the mmap lock is dropped.
+ */
+static void walk_numa_prepare(struct lru_gen_mm_walk *walk, struct mm_struct *mm)
+{
+	int nid;
+
+	walk->numa_nid = NUMA_NO_NODE;
+
+	/* no votes means no node has won the majority yet */
+	if (!(sysctl_numa_balancing_mode & NUMA_BALANCING_MGLRU) ||
+	    !READ_ONCE(mm->numa_access_votes))
+		return;
+
+	nid = READ_ONCE(mm->numa_access_nid);
+	if (nid != NUMA_NO_NODE && nid != lruvec_pgdat(walk->lruvec)->node_id &&
+	    node_online(nid))
+		walk->numa_nid = nid;
+}
+
+static bool walk_numa_full(struct lru_gen_mm_walk *walk)
+{
+	return walk->nr_numa_folios == LRU_GEN_NUMA_BATCH;
+}
+
+static void walk_numa_isolate(struct lru_gen_mm_walk *walk, struct vm_area_struct *vma,
+			      struct folio *folio)
+{
+	if (walk->numa_nid == NUMA_NO_NODE || walk_numa_full(walk))
+		return;
+
+	/* the mm-wide hint says nothing about other mms or VMA policies */
+	if (!vma_migratable(vma) || vma_policy(vma) || folio_maybe_mapped_shared(folio))
+		return;
+
+	if (migrate_misplaced_folio_prepare(folio, vma, walk->numa_nid))
+		return;
+
+	walk->numa_folios[walk->nr_numa_folios++] = folio;
+}
+
+static void walk_numa_migrate(struct lru_gen_mm_walk *walk)
+{
+	int i;
+
+	for (i = 0; i < walk->nr_numa_folios; i++)
+		migrate_misplaced_folio(walk->numa_folios[i], walk->numa_nid);
+
+	walk->nr_numa_folios = 0;
+}
+#else
+static void walk_numa_prepare(struct lru_gen_mm_walk *walk, struct mm_struct *mm)
+{
+}
+
+static void walk_numa_isolate(struct lru_gen_mm_walk *walk, struct vm_area_struct *vma,
+			      struct folio *folio)
+{
+}
+
+static bool walk_numa_full(struct lru_gen_mm_walk *walk)
+{
+	return false;
+}
+
+static void walk_numa_migrate(struct lru_gen_mm_walk *walk)
+{
+}
+#endif /* CONFIG_NUMA_BALANCING */
+
 static bool walk_pte_range(pmd_t *pmd, unsigned long start, unsigned long end,
 			   struct mm_walk *args)
 {
@@ -3524,6 +3636,7 @@ static bool walk_pte_range(pmd_t *pmd, unsigned long start, unsigned long end,
 
 		if (last != folio) {
 			walk_update_folio(walk, last, gen, dirty);
+			walk_numa_isolate(walk, args->vma, folio);
 
 			last = folio;
 			dirty = false;
@@ -3615,6 +3728,7 @@ static void walk_pmd_range_locked(pud_t *pud, unsigned long addr, struct vm_area
 
 		if (last != folio) {
 			walk_update_folio(walk, last, gen, dirty);
+			walk_numa_isolate(walk, vma, folio);
 
 			last = folio;
 			dirty = false;
@@ -3732,7 +3846,7 @@ static int walk_pud_range(p4d_t *p4d, unsigned long start, unsigned long end,
 
 		walk_pmd_range(&val, addr, next, args);
 
-		if (need_resched() || walk->batched >= MAX_LRU_BATCH) {
+		if (need_resched() || walk->batched >= MAX_LRU_BATCH || walk_numa_full(walk)) {
 			end = (addr | ~PUD_MASK) + 1;
 			goto done;
 		}
@@ -3762,6 +3876,7 @@ static void walk_mm(struct mm_struct *mm, struct lru_gen_mm_walk *walk)
 	struct lruvec *lruvec = walk->lruvec;
 
 	walk->next_addr = FIRST_USER_ADDRESS;
+	walk_numa_prepare(walk, mm);
 
 	do {
 		DEFINE_MAX_SEQ(lruvec);
@@ -3785,10 +3900,25 @@ static void walk_mm(struct mm_struct *mm, struct lru_gen_mm_walk *walk)
 			lruvec_unlock_irq(lruvec);
 		}
 
+		walk_numa_migrate(walk);
+
 		cond_resched();
 	} while (err == -EAGAIN);
 }
 
+static struct lru_gen_mm_walk *kswapd_mm_walk(struct pglist_data *pgdat)
+{
+	struct kswapd_helper *helper;
+
+	if (current == pgdat->kswapd)
+		return &pgdat->mm_walk;
+
+	helper = kthread_data(current);
+	VM_WARN_ON_ONCE(helper->pgdat != pgdat);
+
+	return &helper->mm_walk;
+}
+
 static struct lru_gen_mm_walk *set_mm_walk(struct pglist_data *pgdat, bool force_alloc)
 {
 	struct lru_gen_mm_walk *walk = current->reclaim_state->mm_walk;
@@ -3796,7 +3926,7 @@ static struct lru_gen_mm_walk *set_mm_walk(struct pglist_data *pgdat, bool force
 	if (pgdat && current_is_kswapd()) {
 		VM_WARN_ON_ONCE(walk);
 
-		walk = &pgdat->mm_walk;
+		walk = kswapd_mm_walk(pgdat);
 	} else if (!walk && force_alloc) {
 		VM_WARN_ON_ONCE(current_is_kswapd());
 
@@ -6071,6 +6201,7 @@ static void shrink_node_memcgs(pg_data_t *pgdat, struct scan_control *sc)
 		.pgdat = pgdat,
 	};
 	struct mem_cgroup_reclaim_cookie *partial = &reclaim;
+	struct mem_cgroup_reclaim_cookie *shared;
 	struct mem_cgroup *memcg;
 
 	/*
@@ -6085,7 +6216,14 @@ static void shrink_node_memcgs(pg_data_t *pgdat, struct scan_control *sc)
 	if (current_is_kswapd() || sc->memcg_full_walk)
 		partial = NULL;
 
-	memcg = mem_cgroup_iter(target_memcg, NULL, partial);
+	/*
+	 * The helper threads of kswapd share the iterator instead, so that
+	 * together they still do a full walk but each memcg is reclaimed
+	 * by only one of them.
+	 */
+	shared = sc->kswapd_parallel ? &reclaim : partial;
+
+	memcg = mem_cgroup_iter(target_memcg, NULL, shared);
 	do {
 		struct lruvec *lruvec = mem_cgroup_lruvec(memcg, pgdat);
 		unsigned long reclaimed;
@@ -6140,7 +6278,7 @@ static void shrink_node_memcgs(pg_data_t *pgdat, struct scan_control *sc)
 			mem_cgroup_iter_break(target_memcg, memcg);
 			break;
 		}
-	} while ((memcg = mem_cgroup_iter(target_memcg, memcg, partial)));
+	} while ((memcg = mem_cgroup_iter(target_memcg, memcg, shared)));
 }
 
 static void shrink_node(pg_data_t *pgdat, struct scan_control *sc)
@@ -6980,6 +7118,116 @@ static bool prepare_kswapd_sleep(pg_data_t *pgdat, int order,
 	return false;
 }
 
+/*
+ * Run one shrink_node() pass of kswapd on its own copy of the scan_control and
+ * hand back what it reclaimed.
+ */
+static void kswapd_helper_pass(pg_data_t *pgdat, struct kswapd_helpers *h,
+			       struct scan_control *sc)
+{
+	unsigned long pflags;
+
+	sc->nr_scanned = 0;
+	sc->nr_reclaimed = 0;
+	memset(&sc->nr, 0, sizeof(sc->nr));
+	memset(&sc->reclaim_state, 0, sizeof(sc->reclaim_state));
+
+	set_task_reclaim_state(current, &sc->reclaim_state);
+	psi_memstall_enter(&pflags);
+	__fs_reclaim_acquire(_THIS_IP_);
+
+	shrink_node(pgdat, sc);
+
+	__fs_reclaim_release(_THIS_IP_);
+	psi_memstall_leave(&pflags);
+	set_task_reclaim_state(current, NULL);
+
+	spin_lock(&h->lock);
+	h->nr_reclaimed += sc->nr_reclaimed;
+	h->nr_scanned += sc->nr_scanned;
+	WRITE_ONCE(h->nr_running, h->nr_running - 1);
+	spin_unlock(&h->lock);
+
+	wake_up(&h->done_wait);
+}
+
+static int kswapd_helper(void *p)
+{
+	struct kswapd_helper *helper = p;
+	pg_data_t *pgdat = helper->pgdat;
+	struct kswapd_helpers *h = pgdat->kswapd_helpers;
+	unsigned long seq = READ_ONCE(h->seq);
+
+	/* Same as kswapd(), which these threads act on behalf of */
+	current->flags |= PF_MEMALLOC | PF_KSWAPD;
+	set_freezable();
+
+	while (!kthread_freezable_should_stop(NULL)) {
+		struct scan_control sc;
+		bool join;
+
+		if (wait_event_freezable(h->pass_wait, READ_ONCE(h->seq) != seq ||
+						       kthread_should_stop()))
+			continue;
+
+		spin_lock(&h->lock);
+		seq = h->seq;
+		join = h->open;
+		if (join) {
+			sc = h->pass;
+			h->nr_running++;
+		}
+		spin_unlock(&h->lock);
+
+		if (join)
+			kswapd_helper_pass(pgdat, h, &sc);
+	}
+
+	current->flags &= ~(PF_MEMALLOC | PF_KSWAPD);
+
+	return 0;
+}
+
+/*
+ * shrink_node() for kswapd, together with whichever of its helper threads are
+ * idle. The helpers partition the memcgs through a shared iterator, see
+ * shrink_node_memcgs(), or the memcg generations with MGLRU, see shrink_many().
+ */
+static void kswapd_shrink_node_parallel(pg_data_t *pgdat, struct scan_control *sc)
+{
+	struct kswapd_helpers *h = smp_load_acquire(&pgdat->kswapd_helpers);
+
+	if (!h || !READ_ONCE(h->nr)) {
+		shrink_node(pgdat, sc);
+		return;
+	}
+
+	sc->kswapd_parallel = 1;
+
+	spin_lock(&h->lock);
+	h->pass = *sc;
+	h->open = true;
+	WRITE_ONCE(h->seq, h->seq + 1);
+	spin_unlock(&h->lock);
+	wake_up_all(&h->pass_wait);
+
+	shrink_node(pgdat, sc);
+
+	spin_lock(&h->lock);
+	h->open = false;
+	spin_unlock(&h->lock);
+	wait_event(h->done_wait, !READ_ONCE(h->nr_running));
+
+	spin_lock(&h->lock);
+	sc->nr_reclaimed += h->nr_reclaimed;
+	sc->nr_scanned += h->nr_scanned;
+	h->nr_reclaimed = 0;
+	h->nr_scanned = 0;
+	spin_unlock(&h->lock);
+
+	sc->kswapd_parallel = 0;
+}
+
 /*
  * kswapd shrinks a node of pages that are at or below the highest usable
  * zone that is currently unbalanced.
@@ -7005,7 +7253,7 @@ static bool kswapd_shrink_node(pg_data_t *pgdat,
 	 * Historically care was taken to put equal pressure on all zones but
 	 * now pressure is applied based on node LRU order.
 	 */
-	shrink_node(pgdat, sc);
+	kswapd_shrink_node_parallel(pgdat, sc);
 
 	/*
 	 * Fragmentation may mean that the system cannot be rebalanced for
@@ -7610,6 +7858,67 @@ void __meminit kswapd_run(int nid)
 	pgdat_kswapd_unlock(pgdat);
 }
 
+/*
+ * Start or stop helper threads until kswapd has @nr_threads - 1 of them.
+ * Caller must be holding kswapd_lock, and kswapd must be running.
+ */
+static int kswapd_set_helpers(pg_data_t *pgdat, int nr_threads)
+{
+	struct kswapd_helpers *h = pgdat->kswapd_helpers;
+	int nid = pgdat->node_id;
+	int ret = 0;
+
+	mutex_lock(&kswapd_helpers_lock);
+	if (!h) {
+		if (nr_threads <= 1)
+			goto unlock;
+
+		h = kzalloc_node(sizeof(*h), GFP_KERNEL, nid);
+		if (!h) {
+			ret = -ENOMEM;
+			goto unlock;
+		}
+		spin_lock_init(&h->lock);
+		init_waitqueue_head(&h->pass_wait);
+		init_waitqueue_head(&h->done_wait);
+		smp_store_release(&pgdat->kswapd_helpers, h);
+	}
+
+	while (h->nr < nr_threads - 1) {
+		struct kswapd_helper *helper;
+
+		helper = kzalloc_node(sizeof(*helper), GFP_KERNEL, nid);
+		if (!helper) {
+			ret = -ENOMEM;
+			break;
+		}
+		helper->pgdat = pgdat;
+		helper->task = kthread_create_on_node(kswapd_helper, helper, nid,
+						      "kswapd%d:%d", nid, h->nr + 1);
+		if (IS_ERR(helper->task)) {
+			ret = PTR_ERR(helper->task);
+			kfree(helper);
+			break;
+		}
+		h->helper[h->nr] = helper;
+		WRITE_ONCE(h->nr, h->nr + 1);
+		wake_up_process(helper->task);
+	}
+
+	/* A helper in the middle of a pass finishes it before stopping */
+	while (h->nr > max(nr_threads - 1, 0)) {
+		struct kswapd_helper *helper = h->helper[h->nr - 1];
+
+		WRITE_ONCE(h->nr, h->nr - 1);
+		kthread_stop(helper->task);
+		kfree(helper);
+	}
+unlock:
+	mutex_unlock(&kswapd_helpers_lock);
+
+	return ret;
+}
+
 /*
  * Called by memory hotplug when all memory in a node is offlined.  Caller must
  * be holding mem_hotplug_begin/done().
@@ -7622,8 +7931,11 @@ void __meminit kswapd_stop(int nid)
 	pgdat_kswapd_lock(pgdat);
 	kswapd = pgdat->kswapd;
 	if (kswapd) {
+		kswapd_set_helpers(pgdat, 0);
 		kthread_stop(kswapd);
 		pgdat->kswapd = NULL;
+		kfree(pgdat->kswapd_helpers);
+		pgdat->kswapd_helpers = NULL;
 	}
 	pgdat_kswapd_unlock(pgdat);
 }
@@ -8017,13 +8329,65 @@ static ssize_t reclaim_store(struct device *dev,
 }
 
 static DEVICE_ATTR_WO(reclaim);
+
+static ssize_t kswapd_threads_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	pg_data_t *pgdat = NODE_DATA(dev->id);
+	int nr_threads = 1;
+
+	pgdat_kswapd_lock(pgdat);
+	if (pgdat->kswapd_helpers)
+		nr_threads += READ_ONCE(pgdat->kswapd_helpers->nr);
+	pgdat_kswapd_unlock(pgdat);
+
+	return sysfs_emit(buf, "%d\n", nr_threads);
+}
+
+static ssize_t kswapd_threads_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	pg_data_t *pgdat = NODE_DATA(dev->id);
+	unsigned int nr_threads;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &nr_threads);
+	if (ret)
+		return ret;
+	if (!nr_threads || nr_threads > KSWAPD_MAX_THREADS)
+		return -EINVAL;
+
+	pgdat_kswapd_lock(pgdat);
+	if (pgdat->kswapd)
+		ret = kswapd_set_helpers(pgdat, nr_threads);
+	else
+		ret = -ENODEV;
+	pgdat_kswapd_unlock(pgdat);
+
+	return ret ? ret : count;
+}
+
+static DEVICE_ATTR_RW(kswapd_threads);
+
 int reclaim_register_node(struct node *node)
 {
-	return device_create_file(&node->dev, &dev_attr_reclaim);
+	int ret;
+
+	ret = device_create_file(&node->dev, &dev_attr_reclaim);
+	if (ret)
+		return ret;
+
+	ret = device_create_file(&node->dev, &dev_attr_kswapd_threads);
+	if (ret)
+		device_remove_file(&node->dev, &dev_attr_reclaim);
+
+	return ret;
 }
 
 void reclaim_unregister_node(struct node *node)
 {
-	return device_remove_file(&node->dev, &dev_attr_reclaim);
+	device_remove_file(&node->dev, &dev_attr_kswapd_threads);
+	device_remove_file(&node->dev, &dev_attr_reclaim);
 }
 #endif
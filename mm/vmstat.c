@@ -1353,6 +1353,12 @@ const char * const vmstat_text[] = {
 	[I(DROP_PAGECACHE)]			= "drop_pagecache",
 	[I(DROP_SLAB)]				= "drop_slab",
 	[I(OOM_KILL)]				= "oom_kill",
+#ifdef CONFIG_READAHEAD_PATTERNS
+	[I(RA_STRIDE_ISSUED)]			= "ra_stride_issued",
+	[I(RA_STRIDE_HIT)]			= "ra_stride_hit",
+	[I(RA_STRIDE_MISS)]			= "ra_stride_miss",
+	[I(RA_STREAM_RESUME)]			= "ra_stream_resume",
+#endif
 
 #ifdef CONFIG_NUMA_BALANCING
 	[I(NUMA_PTE_UPDATES)]			= "numa_pte_updates",
@@ -1378,6 +1384,10 @@ const char * const vmstat_text[] = {
 	[I(KCOMPACTD_WAKE)]			= "compact_daemon_wake",
 	[I(KCOMPACTD_MIGRATE_SCANNED)]		= "compact_daemon_migrate_scanned",
 	[I(KCOMPACTD_FREE_SCANNED)]		= "compact_daemon_free_scanned",
+	[I(KCOMPACTD_TARGET_WAKE)]		= "compact_daemon_target_wake",
+	[I(KCOMPACTD_TARGET_MET)]		= "compact_daemon_target_met",
+	[I(KCOMPACTD_WORKER_MIGRATE_SCANNED)]	= "compact_daemon_worker_migrate_scanned",
+	[I(KCOMPACTD_WORKER_FREE_SCANNED)]	= "compact_daemon_worker_free_scanned",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -19,6 +19,7 @@
  * lock ordering:
  *	page_lock
  *	pool->lock
+ *	zs_magazine->lock
  *	class->lock
  *	zspage->lock
  */
@@ -97,6 +98,7 @@
 #define MAGIC_VAL_BITS	8
 
 #define ZS_MAX_PAGES_PER_ZSPAGE	(_AC(CONFIG_ZSMALLOC_CHAIN_SIZE, UL))
+#define ZS_MAGAZINE_SIZE	CONFIG_ZSMALLOC_MAGAZINE_SIZE
 
 /* ZS_MIN_ALLOC_SIZE must be multiple of ZS_ALIGN */
 #define ZS_MIN_ALLOC_SIZE \
@@ -157,6 +159,19 @@ static struct dentry *zs_stat_root;
 
 static size_t huge_class_size;
 
+/*
+ * Per-CPU cache of free objects of a size class. Objects sitting in a
+ * magazine remain allocated in their zspage and keep their handle, so
+ * zs_malloc() and zs_free() can recycle them without class->lock.
+ */
+struct zs_magazine {
+	spinlock_t lock;
+	unsigned int count;
+	unsigned long hit;
+	unsigned long miss;
+	unsigned long handles[];
+};
+
 struct size_class {
 	spinlock_t lock;
 	struct list_head fullness_list[NR_FULLNESS_GROUPS];
@@ -171,6 +186,7 @@ struct size_class {
 
 	unsigned int index;
 	struct zs_size_stat stats;
+	struct zs_magazine __percpu *mag;
 };
 
 /*
@@ -578,6 +594,47 @@ static int zs_stats_size_show(struct seq_file *s, void *v)
 }
 DEFINE_SHOW_ATTRIBUTE(zs_stats_size);
 
+static int zs_stats_magazines_show(struct seq_file *s, void *v)
+{
+	int i, cpu;
+	struct zs_pool *pool = s->private;
+	struct size_class *class;
+	struct zs_magazine *mag;
+	unsigned long cached, hit, miss;
+	unsigned long total_cached = 0, total_hit = 0, total_miss = 0;
+
+	seq_printf(s, " %5s %5s %10s %16s %16s\n",
+			"class", "size", "cached", "hit", "miss");
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		class = pool->size_class[i];
+
+		if (class->index != i || !class->mag)
+			continue;
+
+		cached = hit = miss = 0;
+		for_each_possible_cpu(cpu) {
+			mag = per_cpu_ptr(class->mag, cpu);
+			cached += READ_ONCE(mag->count);
+			hit += READ_ONCE(mag->hit);
+			miss += READ_ONCE(mag->miss);
+		}
+
+		seq_printf(s, " %5u %5u %10lu %16lu %16lu\n",
+			   i, class->size, cached, hit, miss);
+
+		total_cached += cached;
+		total_hit += hit;
+		total_miss += miss;
+	}
+
+	seq_printf(s, "\n %5s %5s %10lu %16lu %16lu\n",
+		   "Total", "", total_cached, total_hit, total_miss);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(zs_stats_magazines);
+
 static void zs_pool_stat_create(struct zs_pool *pool, const char *name)
 {
 	if (!zs_stat_root) {
@@ -589,6 +646,8 @@ static void zs_pool_stat_create(struct zs_pool *pool, const char *name)
 
 	debugfs_create_file("classes", S_IFREG | 0444, pool->stat_dentry, pool,
 			    &zs_stats_size_fops);
+	debugfs_create_file("magazines", S_IFREG | 0444, pool->stat_dentry,
+			    pool, &zs_stats_magazines_fops);
 }
 
 static void zs_pool_stat_destroy(struct zs_pool *pool)
@@ -1282,6 +1341,172 @@ static unsigned long obj_malloc(struct zs_pool *pool,
 }
 
 
+static void obj_free(int class_size, unsigned long obj)
+{
+	struct link_free *link;
+	struct zspage *zspage;
+	struct zpdesc *f_zpdesc;
+	unsigned long f_offset;
+	unsigned int f_objidx;
+	void *vaddr;
+
+
+	obj_to_location(obj, &f_zpdesc, &f_objidx);
+	f_offset = offset_in_page(class_size * f_objidx);
+	zspage = get_zspage(f_zpdesc);
+
+	vaddr = kmap_local_zpdesc(f_zpdesc);
+	link = (struct link_free *)(vaddr + f_offset);
+
+	/* Insert this object in containing zspage's freelist */
+	if (likely(!ZsHugePage(zspage)))
+		link->next = get_freeobj(zspage) << OBJ_TAG_BITS;
+	else
+		f_zpdesc->handle = 0;
+	set_freeobj(zspage, f_objidx);
+
+	kunmap_local(vaddr);
+	mod_zspage_inuse(zspage, -1);
+}
+
+/*
+ * Frees the object behind @handle, but not the handle itself. The caller
+ * holds class->lock, which keeps the object from being migrated.
+ */
+static void __zs_free(struct zs_pool *pool, struct size_class *class,
+		      unsigned long handle)
+{
+	struct zspage *zspage;
+	struct zpdesc *f_zpdesc;
+	unsigned long obj;
+	int fullness;
+
+	obj = handle_to_obj(handle);
+	obj_to_zpdesc(obj, &f_zpdesc);
+	zspage = get_zspage(f_zpdesc);
+
+	class_stat_sub(class, ZS_OBJS_INUSE, 1);
+	obj_free(class->size, obj);
+
+	fullness = fix_fullness_group(class, zspage);
+	if (fullness == ZS_INUSE_RATIO_0)
+		free_zspage(pool, class, zspage);
+}
+
+static int zs_magazine_init(struct size_class *class)
+{
+	int cpu;
+
+	/* A cached huge object would pin a whole zspage */
+	if (!ZS_MAGAZINE_SIZE || class->objs_per_zspage == 1)
+		return 0;
+
+	class->mag = __alloc_percpu(struct_size_t(struct zs_magazine, handles,
+						  ZS_MAGAZINE_SIZE),
+				    __alignof__(struct zs_magazine));
+	if (!class->mag)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(class->mag, cpu)->lock);
+	return 0;
+}
+
+/*
+ * Releases the @nr oldest objects of @mag back to their zspages, taking
+ * class->lock once for the whole batch.
+ */
+static void zs_magazine_flush(struct zs_pool *pool, struct size_class *class,
+			      struct zs_magazine *mag, unsigned int nr)
+{
+	unsigned int i;
+
+	lockdep_assert_held(&mag->lock);
+
+	spin_lock(&class->lock);
+	for (i = 0; i < nr; i++)
+		__zs_free(pool, class, mag->handles[i]);
+	spin_unlock(&class->lock);
+
+	for (i = 0; i < nr; i++)
+		cache_free_handle(mag->handles[i]);
+
+	mag->count -= nr;
+	memmove(mag->handles, mag->handles + nr,
+		mag->count * sizeof(mag->handles[0]));
+}
+
+/*
+ * The magazine of the local CPU is only trylocked: it may be contended by
+ * a drain from another CPU, or by an interrupted zs_malloc()/zs_free() on
+ * this one. Both callers fall back to the class->lock path on failure.
+ */
+static unsigned long zs_magazine_alloc(struct size_class *class)
+{
+	struct zs_magazine *mag;
+	unsigned long handle = 0;
+
+	if (!class->mag)
+		return 0;
+
+	mag = raw_cpu_ptr(class->mag);
+	if (!spin_trylock(&mag->lock))
+		return 0;
+
+	if (mag->count) {
+		handle = mag->handles[--mag->count];
+		mag->hit++;
+	} else {
+		mag->miss++;
+	}
+	spin_unlock(&mag->lock);
+
+	return handle;
+}
+
+static bool zs_magazine_free(struct zs_pool *pool, struct size_class *class,
+			     unsigned long handle)
+{
+	struct zs_magazine *mag;
+
+	if (!class->mag)
+		return false;
+
+	mag = raw_cpu_ptr(class->mag);
+	if (!spin_trylock(&mag->lock))
+		return false;
+
+	if (mag->count == ZS_MAGAZINE_SIZE)
+		zs_magazine_flush(pool, class, mag,
+				  DIV_ROUND_UP(ZS_MAGAZINE_SIZE, 2));
+	mag->handles[mag->count++] = handle;
+	spin_unlock(&mag->lock);
+
+	return true;
+}
+
+/* Returns all objects cached in the magazines to their zspages. */
+static void zs_magazines_drain(struct zs_pool *pool)
+{
+	struct size_class *class;
+	struct zs_magazine *mag;
+	int i, cpu;
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		class = pool->size_class[i];
+		if (!class || class->index != i || !class->mag)
+			continue;
+
+		for_each_possible_cpu(cpu) {
+			mag = per_cpu_ptr(class->mag, cpu);
+			spin_lock(&mag->lock);
+			if (mag->count)
+				zs_magazine_flush(pool, class, mag, mag->count);
+			spin_unlock(&mag->lock);
+		}
+	}
+}
+
 /**
  * zs_malloc - Allocate block of given size from pool.
  * @pool: pool to allocate from
@@ -1307,14 +1532,18 @@ unsigned long zs_malloc(struct zs_pool *pool, size_t size, gfp_t gfp,
 	if (unlikely(size > ZS_MAX_ALLOC_SIZE))
 		return (unsigned long)ERR_PTR(-ENOSPC);
 
-	handle = cache_alloc_handle(gfp);
-	if (!handle)
-		return (unsigned long)ERR_PTR(-ENOMEM);
-
 	/* extra space in chunk to keep the handle */
 	size += ZS_HANDLE_SIZE;
 	class = pool->size_class[get_size_class_index(size)];
 
+	handle = zs_magazine_alloc(class);
+	if (handle)
+		return handle;
+
+	handle = cache_alloc_handle(gfp);
+	if (!handle)
+		return (unsigned long)ERR_PTR(-ENOMEM);
+
 	/* class->lock effectively protects the zpage migration */
 	spin_lock(&class->lock);
 	zspage = find_get_zspage(class);
@@ -1352,41 +1581,12 @@ unsigned long zs_malloc(struct zs_pool *pool, size_t size, gfp_t gfp,
 }
 EXPORT_SYMBOL_GPL(zs_malloc);
 
-static void obj_free(int class_size, unsigned long obj)
-{
-	struct link_free *link;
-	struct zspage *zspage;
-	struct zpdesc *f_zpdesc;
-	unsigned long f_offset;
-	unsigned int f_objidx;
-	void *vaddr;
-
-
-	obj_to_location(obj, &f_zpdesc, &f_objidx);
-	f_offset = offset_in_page(class_size * f_objidx);
-	zspage = get_zspage(f_zpdesc);
-
-	vaddr = kmap_local_zpdesc(f_zpdesc);
-	link = (struct link_free *)(vaddr + f_offset);
-
-	/* Insert this object in containing zspage's freelist */
-	if (likely(!ZsHugePage(zspage)))
-		link->next = get_freeobj(zspage) << OBJ_TAG_BITS;
-	else
-		f_zpdesc->handle = 0;
-	set_freeobj(zspage, f_objidx);
-
-	kunmap_local(vaddr);
-	mod_zspage_inuse(zspage, -1);
-}
-
 void zs_free(struct zs_pool *pool, unsigned long handle)
 {
 	struct zspage *zspage;
 	struct zpdesc *f_zpdesc;
 	unsigned long obj;
 	struct size_class *class;
-	int fullness;
 
 	if (IS_ERR_OR_NULL((void *)handle))
 		return;
@@ -1400,15 +1600,14 @@ void zs_free(struct zs_pool *pool, unsigned long handle)
 	obj_to_zpdesc(obj, &f_zpdesc);
 	zspage = get_zspage(f_zpdesc);
 	class = zspage_class(pool, zspage);
+	if (zs_magazine_free(pool, class, handle)) {
+		read_unlock(&pool->lock);
+		return;
+	}
 	spin_lock(&class->lock);
 	read_unlock(&pool->lock);
 
-	class_stat_sub(class, ZS_OBJS_INUSE, 1);
-	obj_free(class->size, obj);
-
-	fullness = fix_fullness_group(class, zspage);
-	if (fullness == ZS_INUSE_RATIO_0)
-		free_zspage(pool, class, zspage);
+	__zs_free(pool, class, handle);
 
 	spin_unlock(&class->lock);
 	cache_free_handle(handle);
@@ -1962,6 +2161,9 @@ unsigned long zs_compact(struct zs_pool *pool)
 	if (atomic_xchg(&pool->compaction_in_progress, 1))
 		return 0;
 
+	/* Cached objects would keep their zspages from being compacted */
+	zs_magazines_drain(pool);
+
 	for (i = ZS_SIZE_CLASSES - 1; i >= 0; i--) {
 		class = pool->size_class[i];
 		if (class->index != i)
@@ -2150,6 +2352,8 @@ struct zs_pool *zs_create_pool(const char *name)
 		class->objs_per_zspage = objs_per_zspage;
 		spin_lock_init(&class->lock);
 		pool->size_class[i] = class;
+		if (zs_magazine_init(class))
+			goto err;
 
 		fullness = ZS_INUSE_RATIO_0;
 		while (fullness < NR_FULLNESS_GROUPS) {
@@ -2184,6 +2388,7 @@ void zs_destroy_pool(struct zs_pool *pool)
 	int i;
 
 	zs_unregister_shrinker(pool);
+	zs_magazines_drain(pool);
 	zs_flush_migration(pool);
 	zs_pool_stat_destroy(pool);
 
@@ -2204,6 +2409,7 @@ void zs_destroy_pool(struct zs_pool *pool)
 			pr_err("Class-%d fullness group %d is not empty\n",
 			       class->size, fg);
 		}
+		free_percpu(class->mag);
 		kfree(class);
 	}
 
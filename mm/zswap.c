@@ -71,9 +71,15 @@ static u64 zswap_decompress_fail;
 static u64 zswap_reject_alloc_fail;
 /* Store failed because the entry metadata could not be allocated (rare) */
 static u64 zswap_reject_kmemcache_fail;
+/* Large folio chunks stored as one compressed object */
+static u64 zswap_stored_chunks;
+/* Large folio chunks that had to be stored page by page instead */
+static u64 zswap_chunk_fallback;
 
 /* Shrinker work queue */
 static struct workqueue_struct *shrink_wq;
+/* Work queue that batched compression fans out to */
+static struct workqueue_struct *compress_wq;
 /* Pool limit was hit, we need to calm down */
 static bool zswap_pool_reached_full;
 
@@ -122,6 +128,14 @@ static bool zswap_shrinker_enabled = IS_ENABLED(
 		CONFIG_ZSWAP_SHRINKER_DEFAULT_ON);
 module_param_named(shrinker_enabled, zswap_shrinker_enabled, bool, 0644);
 
+/* Compress large folios in chunks instead of page by page */
+static bool zswap_large_chunks;
+module_param_named(large_chunks, zswap_large_chunks, bool, 0644);
+
+/* Compress the pages of a large folio in batches (not across folios) */
+static bool zswap_batch_compress;
+module_param_named(batch_compress, zswap_batch_compress, bool, 0644);
+
 bool zswap_is_enabled(void)
 {
 	return zswap_enabled;
@@ -132,16 +146,80 @@ bool zswap_never_enabled(void)
 	return !static_branch_maybe(CONFIG_ZSWAP_DEFAULT_ON, &zswap_ever_enabled);
 }
 
+/*
+ * Whether large folios may be swapped in although zswap can hold part of
+ * their range. Only chunked stores keep ranges whole often enough for that
+ * to be worth checking, see zswap_can_load_large().
+ */
+bool zswap_large_swapin_allowed(void)
+{
+	return zswap_never_enabled() || READ_ONCE(zswap_large_chunks);
+}
+
 /*********************************
 * data structures
 **********************************/
 
+/*
+ * Large folios are compressed in naturally aligned chunks of up to 64K. The
+ * per-CPU buffer holds both the compressed stream of a chunk and, when only
+ * part of a chunk is loaded, its decompressed contents.
+ */
+#define ZSWAP_MAX_CHUNK_ORDER	(PAGE_SHIFT < 16 ? 16 - PAGE_SHIFT : 0)
+#define ZSWAP_MAX_CHUNK_SIZE	(PAGE_SIZE << ZSWAP_MAX_CHUNK_ORDER)
+#define ZSWAP_BUFFER_SIZE	(ZSWAP_MAX_CHUNK_ORDER ? \
+				 2 * ZSWAP_MAX_CHUNK_SIZE : PAGE_SIZE)
+
+/*
+ * Pages of a large folio are compressed in batches of up to ZSWAP_MAX_BATCH.
+ * Asynchronous compressors get the whole batch in flight at once, with the
+ * output of each request in its own page of the per-CPU buffer. Synchronous
+ * ones have the batch fanned out to workers, ZSWAP_FANOUT_PAGES at a time,
+ * which is enough work per slice to be worth a wakeup.
+ *
+ * Batches never span folios: reclaim hands zswap_store() one folio at a
+ * time, so order-0 folios are always compressed one by one.
+ */
+#define ZSWAP_MAX_BATCH		MIN(8, ZSWAP_BUFFER_SIZE / PAGE_SIZE)
+#define ZSWAP_FANOUT_PAGES	4
+#define ZSWAP_MAX_FANOUT	DIV_ROUND_UP(ZSWAP_MAX_BATCH, ZSWAP_FANOUT_PAGES)
+
+struct zswap_compress_work {
+	struct work_struct work;
+	struct page **pages;
+	struct zswap_entry **entries;
+	unsigned int nr;
+	struct zswap_pool *pool;
+	bool ret;
+};
+
+/* The batch being stored, kept off the stack of reclaim */
+struct zswap_batch {
+	struct page *pages[ZSWAP_MAX_BATCH];
+	struct zswap_entry *entries[ZSWAP_MAX_BATCH];
+	/* asynchronous compressors */
+	struct scatterlist input[ZSWAP_MAX_BATCH];
+	struct scatterlist output[ZSWAP_MAX_BATCH];
+	int errs[ZSWAP_MAX_BATCH];
+	/* synchronous compressors */
+	struct zswap_compress_work works[ZSWAP_MAX_FANOUT];
+};
+
 struct crypto_acomp_ctx {
 	struct crypto_acomp *acomp;
 	struct acomp_req *req;
 	struct crypto_wait wait;
 	u8 *buffer;
 	struct mutex mutex;
+	/* only allocated for asynchronous compressors */
+	struct acomp_req *batch_reqs[ZSWAP_MAX_BATCH];
+	struct crypto_wait batch_waits[ZSWAP_MAX_BATCH];
+	/*
+	 * Protects @batch. Taken before @mutex, which workers compressing a
+	 * slice of the batch take on the CPU they run on.
+	 */
+	struct mutex batch_mutex;
+	struct zswap_batch *batch;
 };
 
 /*
@@ -169,30 +247,55 @@ static struct mem_cgroup *zswap_next_shrink;
 static struct work_struct zswap_shrink_work;
 static struct shrinker *zswap_shrinker;
 
+/*
+ * struct zswap_chunk
+ *
+ * Compressed storage of a large folio chunk. The compressed stream does not
+ * fit a single zsmalloc object, so it is split into PAGE_SIZE pieces.
+ *
+ * nr_slots - number of swap slots still referencing the chunk's entry, plus
+ *            one while writeback goes through the slots one by one
+ * nr_handles - number of zsmalloc handles the stream is spread over
+ * handles - zsmalloc allocation handles, in stream order
+ */
+struct zswap_chunk {
+	atomic_t nr_slots;
+	unsigned int nr_handles;
+	unsigned long handles[];
+};
+
 /*
  * struct zswap_entry
  *
  * This structure contains the metadata for tracking a single compressed
- * page within zswap.
+ * page, or a chunk of 2^order pages of a large folio, within zswap. A chunk
+ * entry is stored in the xarray at the offset of every page it covers.
  *
- * swpentry - associated swap entry, the offset indexes into the xarray
+ * swpentry - associated swap entry, the offset indexes into the xarray. For
+ *            chunks, this is the swap entry of the first page.
  * length - the length in bytes of the compressed page data.  Needed during
  *          decompression.
+ * order - the number of pages compressed together, as a power of two
  * referenced - true if the entry recently entered the zswap pool. Unset by the
  *              writeback logic. The entry is only reclaimed by the writeback
  *              logic if referenced is unset. See comments in the shrinker
  *              section for context.
  * pool - the zswap_pool the entry's data is in
  * handle - zsmalloc allocation handle that stores the compressed page data
+ * chunk - compressed storage of a large folio chunk, if order is non-zero
  * objcg - the obj_cgroup that the compressed memory is charged to
  * lru - handle to the pool's lru used to evict pages.
  */
 struct zswap_entry {
 	swp_entry_t swpentry;
 	unsigned int length;
+	unsigned char order;
 	bool referenced;
 	struct zswap_pool *pool;
-	unsigned long handle;
+	union {
+		unsigned long handle;
+		struct zswap_chunk *chunk;
+	};
 	struct obj_cgroup *objcg;
 	struct list_head lru;
 };
@@ -244,6 +347,8 @@ static void __zswap_pool_empty(struct percpu_ref *ref);
 
 static void acomp_ctx_free(struct crypto_acomp_ctx *acomp_ctx)
 {
+	int i;
+
 	if (!acomp_ctx)
 		return;
 
@@ -256,6 +361,12 @@ static void acomp_ctx_free(struct crypto_acomp_ctx *acomp_ctx)
 
 	acomp_ctx->req = NULL;
 
+	for (i = 0; i < ZSWAP_MAX_BATCH; i++) {
+		if (acomp_ctx->batch_reqs[i])
+			acomp_request_free(acomp_ctx->batch_reqs[i]);
+		acomp_ctx->batch_reqs[i] = NULL;
+	}
+
 	/*
 	 * We have to handle both cases here: an error pointer return from
 	 * crypto_alloc_acomp_node(); and a) NULL initialization by zswap, or
@@ -268,6 +379,9 @@ static void acomp_ctx_free(struct crypto_acomp_ctx *acomp_ctx)
 
 	kfree(acomp_ctx->buffer);
 	acomp_ctx->buffer = NULL;
+
+	kfree(acomp_ctx->batch);
+	acomp_ctx->batch = NULL;
 }
 
 static struct zswap_pool *zswap_pool_create(char *compressor)
@@ -758,23 +872,49 @@ static void zswap_entry_cache_free(struct zswap_entry *entry)
 	kmem_cache_free(zswap_entry_cache, entry);
 }
 
+static void zswap_chunk_free(struct zs_pool *zs_pool, struct zswap_chunk *chunk)
+{
+	unsigned int i;
+
+	for (i = 0; i < chunk->nr_handles; i++)
+		zs_free(zs_pool, chunk->handles[i]);
+	kfree(chunk);
+}
+
 /*
  * Carries out the common pattern of freeing an entry's zsmalloc allocation,
  * freeing the entry itself, and decrementing the number of stored pages.
  */
 static void zswap_entry_free(struct zswap_entry *entry)
 {
+	unsigned int nr_pages = 1U << entry->order;
+
 	zswap_lru_del(&zswap_list_lru, entry);
-	zs_free(entry->pool->zs_pool, entry->handle);
+	if (entry->order)
+		zswap_chunk_free(entry->pool->zs_pool, entry->chunk);
+	else
+		zs_free(entry->pool->zs_pool, entry->handle);
 	zswap_pool_put(entry->pool);
 	if (entry->objcg) {
-		obj_cgroup_uncharge_zswap(entry->objcg, entry->length);
+		obj_cgroup_uncharge_zswap(entry->objcg, entry->length, nr_pages);
 		obj_cgroup_put(entry->objcg);
 	}
-	if (entry->length == PAGE_SIZE)
+	if (!entry->order && entry->length == PAGE_SIZE)
 		atomic_long_dec(&zswap_stored_incompressible_pages);
 	zswap_entry_cache_free(entry);
-	atomic_long_dec(&zswap_stored_pages);
+	atomic_long_sub(nr_pages, &zswap_stored_pages);
+}
+
+/*
+ * Drops the reference of a swap slot that was just erased from the tree. A
+ * chunk entry is shared by all the slots it covers and is only freed once
+ * the last of them is gone; until then it stays accounted in full.
+ */
+static void zswap_entry_put(struct zswap_entry *entry)
+{
+	if (entry->order && !atomic_dec_and_test(&entry->chunk->nr_slots))
+		return;
+	zswap_entry_free(entry);
 }
 
 /*********************************
@@ -784,7 +924,8 @@ static int zswap_cpu_comp_prepare(unsigned int cpu, struct hlist_node *node)
 {
 	struct zswap_pool *pool = hlist_entry(node, struct zswap_pool, node);
 	struct crypto_acomp_ctx *acomp_ctx = per_cpu_ptr(pool->acomp_ctx, cpu);
-	int ret = -ENOMEM;
+	struct acomp_req *req;
+	int ret = -ENOMEM, i;
 
 	/*
 	 * To handle cases where the CPU goes through online-offline-online
@@ -795,10 +936,16 @@ static int zswap_cpu_comp_prepare(unsigned int cpu, struct hlist_node *node)
 		return 0;
 	}
 
-	acomp_ctx->buffer = kmalloc_node(PAGE_SIZE, GFP_KERNEL, cpu_to_node(cpu));
+	acomp_ctx->buffer = kmalloc_node(ZSWAP_BUFFER_SIZE, GFP_KERNEL,
+					 cpu_to_node(cpu));
 	if (!acomp_ctx->buffer)
 		return ret;
 
+	acomp_ctx->batch = kmalloc_node(sizeof(*acomp_ctx->batch), GFP_KERNEL,
+					cpu_to_node(cpu));
+	if (!acomp_ctx->batch)
+		goto fail;
+
 	/*
 	 * In case of an error, crypto_alloc_acomp_node() returns an
 	 * error pointer, never NULL.
@@ -829,7 +976,25 @@ static int zswap_cpu_comp_prepare(unsigned int cpu, struct hlist_node *node)
 	acomp_request_set_callback(acomp_ctx->req, CRYPTO_TFM_REQ_MAY_BACKLOG,
 				   crypto_req_done, &acomp_ctx->wait);
 
+	/* Batched compression only keeps several requests in flight if async */
+	for (i = 0; i < ZSWAP_MAX_BATCH; i++) {
+		if (!acomp_is_async(acomp_ctx->acomp))
+			break;
+		req = acomp_request_alloc(acomp_ctx->acomp);
+		if (!req) {
+			pr_err("could not alloc crypto acomp_request %s\n",
+			       pool->tfm_name);
+			goto fail;
+		}
+		crypto_init_wait(&acomp_ctx->batch_waits[i]);
+		acomp_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					   crypto_req_done,
+					   &acomp_ctx->batch_waits[i]);
+		acomp_ctx->batch_reqs[i] = req;
+	}
+
 	mutex_init(&acomp_ctx->mutex);
+	mutex_init(&acomp_ctx->batch_mutex);
 	return 0;
 
 fail:
@@ -837,42 +1002,18 @@ static int zswap_cpu_comp_prepare(unsigned int cpu, struct hlist_node *node)
 	return ret;
 }
 
-static bool zswap_compress(struct page *page, struct zswap_entry *entry,
-			   struct zswap_pool *pool)
+/*
+ * Store the result of compressing @page, found at @dst, into zsmalloc. Called
+ * with the acomp_ctx mutex held, which protects the buffer @dst points into.
+ */
+static bool zswap_compress_store(struct page *page, struct zswap_entry *entry,
+				 struct zswap_pool *pool, u8 *dst,
+				 int comp_ret, unsigned int dlen)
 {
-	struct crypto_acomp_ctx *acomp_ctx;
-	struct scatterlist input, output;
-	int comp_ret = 0, alloc_ret = 0;
-	unsigned int dlen = PAGE_SIZE;
 	unsigned long handle;
-	gfp_t gfp;
-	u8 *dst;
+	int alloc_ret = 0;
 	bool mapped = false;
-
-	acomp_ctx = raw_cpu_ptr(pool->acomp_ctx);
-	mutex_lock(&acomp_ctx->mutex);
-
-	dst = acomp_ctx->buffer;
-	sg_init_table(&input, 1);
-	sg_set_page(&input, page, PAGE_SIZE, 0);
-
-	sg_init_one(&output, dst, PAGE_SIZE);
-	acomp_request_set_params(acomp_ctx->req, &input, &output, PAGE_SIZE, dlen);
-
-	/*
-	 * it maybe looks a little bit silly that we send an asynchronous request,
-	 * then wait for its completion synchronously. This makes the process look
-	 * synchronous in fact.
-	 * Theoretically, acomp supports users send multiple acomp requests in one
-	 * acomp instance, then get those requests done simultaneously. but in this
-	 * case, zswap actually does store and load page by page, there is no
-	 * existing method to send the second page before the first page is done
-	 * in one thread doing zswap.
-	 * but in different threads running on different cpu, we have different
-	 * acomp instance, so multiple threads can do (de)compression in parallel.
-	 */
-	comp_ret = crypto_wait_req(crypto_acomp_compress(acomp_ctx->req), &acomp_ctx->wait);
-	dlen = acomp_ctx->req->dlen;
+	gfp_t gfp;
 
 	/*
 	 * If a page cannot be compressed into a size smaller than PAGE_SIZE,
@@ -887,7 +1028,7 @@ static bool zswap_compress(struct page *page, struct zswap_entry *entry,
 					folio_memcg(page_folio(page)))) {
 			rcu_read_unlock();
 			comp_ret = comp_ret ? comp_ret : -EINVAL;
-			goto unlock;
+			goto out;
 		}
 		rcu_read_unlock();
 		comp_ret = 0;
@@ -900,14 +1041,14 @@ static bool zswap_compress(struct page *page, struct zswap_entry *entry,
 	handle = zs_malloc(pool->zs_pool, dlen, gfp, page_to_nid(page));
 	if (IS_ERR_VALUE(handle)) {
 		alloc_ret = PTR_ERR((void *)handle);
-		goto unlock;
+		goto out;
 	}
 
 	zs_obj_write(pool->zs_pool, handle, dst, dlen);
 	entry->handle = handle;
 	entry->length = dlen;
 
-unlock:
+out:
 	if (mapped)
 		kunmap_local(dst);
 	if (comp_ret == -ENOSPC || alloc_ret == -ENOSPC)
@@ -917,18 +1058,325 @@ static bool zswap_compress(struct page *page, struct zswap_entry *entry,
 	else if (alloc_ret)
 		zswap_reject_alloc_fail++;
 
-	mutex_unlock(&acomp_ctx->mutex);
 	return comp_ret == 0 && alloc_ret == 0;
 }
 
+static bool zswap_compress(struct page *page, struct zswap_entry *entry,
+			   struct zswap_pool *pool)
+{
+	struct crypto_acomp_ctx *acomp_ctx;
+	struct scatterlist input, output;
+	unsigned int dlen = PAGE_SIZE;
+	int comp_ret;
+	bool ret;
+	u8 *dst;
+
+	acomp_ctx = raw_cpu_ptr(pool->acomp_ctx);
+	mutex_lock(&acomp_ctx->mutex);
+
+	dst = acomp_ctx->buffer;
+	sg_init_table(&input, 1);
+	sg_set_page(&input, page, PAGE_SIZE, 0);
+
+	sg_init_one(&output, dst, PAGE_SIZE);
+	acomp_request_set_params(acomp_ctx->req, &input, &output, PAGE_SIZE, dlen);
+
+	/*
+	 * it maybe looks a little bit silly that we send an asynchronous request,
+	 * then wait for its completion synchronously. This makes the process look
+	 * synchronous in fact.
+	 * Theoretically, acomp supports users send multiple acomp requests in one
+	 * acomp instance, then get those requests done simultaneously. but in this
+	 * case, zswap actually does store and load page by page, there is no
+	 * existing method to send the second page before the first page is done
+	 * in one thread doing zswap, short of batching the pages of a large
+	 * folio (see zswap_compress_batch()).
+	 * but in different threads running on different cpu, we have different
+	 * acomp instance, so multiple threads can do (de)compression in parallel.
+	 */
+	comp_ret = crypto_wait_req(crypto_acomp_compress(acomp_ctx->req), &acomp_ctx->wait);
+	dlen = acomp_ctx->req->dlen;
+
+	ret = zswap_compress_store(page, entry, pool, dst, comp_ret, dlen);
+	mutex_unlock(&acomp_ctx->mutex);
+	return ret;
+}
+
+/*
+ * Asynchronous compressors get all requests of the batch in flight before
+ * waiting for any of them, so that hardware with several engines or queues
+ * works on the pages in parallel.
+ */
+static bool zswap_compress_batch_async(struct crypto_acomp_ctx *acomp_ctx,
+				       unsigned int nr, struct zswap_pool *pool)
+{
+	struct zswap_batch *batch = acomp_ctx->batch;
+	bool ret = true;
+	unsigned int i;
+
+	mutex_lock(&acomp_ctx->mutex);
+
+	for (i = 0; i < nr; i++) {
+		sg_init_table(&batch->input[i], 1);
+		sg_set_page(&batch->input[i], batch->pages[i], PAGE_SIZE, 0);
+		sg_init_one(&batch->output[i], acomp_ctx->buffer + i * PAGE_SIZE,
+			    PAGE_SIZE);
+		acomp_request_set_params(acomp_ctx->batch_reqs[i],
+					 &batch->input[i], &batch->output[i],
+					 PAGE_SIZE, PAGE_SIZE);
+		batch->errs[i] = crypto_acomp_compress(acomp_ctx->batch_reqs[i]);
+	}
+
+	for (i = 0; i < nr; i++) {
+		struct acomp_req *req = acomp_ctx->batch_reqs[i];
+
+		batch->errs[i] = crypto_wait_req(batch->errs[i],
+						 &acomp_ctx->batch_waits[i]);
+		if (!zswap_compress_store(batch->pages[i], batch->entries[i],
+					  pool, acomp_ctx->buffer + i * PAGE_SIZE,
+					  batch->errs[i], req->dlen))
+			ret = false;
+	}
+
+	mutex_unlock(&acomp_ctx->mutex);
+	return ret;
+}
+
+static void zswap_compress_slice(struct zswap_compress_work *cw)
+{
+	unsigned int i;
+
+	cw->ret = true;
+	for (i = 0; i < cw->nr; i++) {
+		if (!zswap_compress(cw->pages[i], cw->entries[i], cw->pool)) {
+			cw->ret = false;
+			break;
+		}
+	}
+}
+
+static void zswap_compress_workfn(struct work_struct *work)
+{
+	zswap_compress_slice(container_of(work, struct zswap_compress_work,
+					  work));
+}
+
+/*
+ * Synchronous compressors run on the CPU, so the batch is split into slices
+ * of ZSWAP_FANOUT_PAGES that are compressed by workers on other CPUs, each
+ * using the acomp_ctx of the CPU it runs on. The caller compresses the first
+ * slice itself while waiting.
+ */
+static bool zswap_compress_batch_sync(struct zswap_batch *batch,
+				      unsigned int nr, struct zswap_pool *pool)
+{
+	unsigned int i, nr_works = DIV_ROUND_UP(nr, ZSWAP_FANOUT_PAGES);
+	struct zswap_compress_work *works = batch->works;
+	bool ret;
+
+	for (i = 0; i < nr_works; i++) {
+		struct zswap_compress_work *cw = &works[i];
+		unsigned int start = i * ZSWAP_FANOUT_PAGES;
+
+		cw->pages = batch->pages + start;
+		cw->entries = batch->entries + start;
+		cw->nr = min_t(unsigned int, nr - start, ZSWAP_FANOUT_PAGES);
+		cw->pool = pool;
+		if (i) {
+			INIT_WORK(&cw->work, zswap_compress_workfn);
+			queue_work(compress_wq, &cw->work);
+		}
+	}
+
+	zswap_compress_slice(&works[0]);
+	ret = works[0].ret;
+
+	for (i = 1; i < nr_works; i++) {
+		flush_work(&works[i].work);
+		ret &= works[i].ret;
+	}
+
+	return ret;
+}
+
+/*
+ * Compresses the first @nr pages of @acomp_ctx's batch into its entries.
+ * Called with the batch_mutex held. On failure, some of the entries may
+ * still hold a handle, which the caller must free.
+ */
+static bool zswap_compress_batch(struct crypto_acomp_ctx *acomp_ctx,
+				 unsigned int nr, struct zswap_pool *pool)
+{
+	if (acomp_is_async(acomp_ctx->acomp))
+		return zswap_compress_batch_async(acomp_ctx, nr, pool);
+	return zswap_compress_batch_sync(acomp_ctx->batch, nr, pool);
+}
+
+/*
+ * Compresses a naturally aligned chunk of 2^@order pages of a large folio as
+ * a single stream. The chunk is only kept if that saves at least one page,
+ * otherwise the caller stores its pages one by one.
+ */
+static bool zswap_compress_chunk(struct page *page, unsigned int order,
+				 struct zswap_entry *entry,
+				 struct zswap_pool *pool)
+{
+	unsigned int size = PAGE_SIZE << order;
+	struct crypto_acomp_ctx *acomp_ctx;
+	struct scatterlist input, output;
+	struct zswap_chunk *chunk;
+	unsigned int dlen = size;
+	unsigned int nr_handles, i;
+	unsigned long handle;
+	int comp_ret;
+	gfp_t gfp;
+
+	acomp_ctx = raw_cpu_ptr(pool->acomp_ctx);
+	mutex_lock(&acomp_ctx->mutex);
+
+	sg_init_table(&input, 1);
+	sg_set_page(&input, page, size, 0);
+	sg_init_one(&output, acomp_ctx->buffer, size);
+	acomp_request_set_params(acomp_ctx->req, &input, &output, size, dlen);
+
+	comp_ret = crypto_wait_req(crypto_acomp_compress(acomp_ctx->req), &acomp_ctx->wait);
+	dlen = acomp_ctx->req->dlen;
+	if (comp_ret || !dlen || dlen > size - PAGE_SIZE)
+		goto fallback;
+
+	nr_handles = DIV_ROUND_UP(dlen, PAGE_SIZE);
+	chunk = kmalloc_node(struct_size(chunk, handles, nr_handles), GFP_KERNEL,
+			     page_to_nid(page));
+	if (!chunk)
+		goto fallback;
+
+	gfp = GFP_NOWAIT | __GFP_NORETRY | __GFP_HIGHMEM | __GFP_MOVABLE;
+	for (i = 0; i < nr_handles; i++) {
+		unsigned int len = min(dlen - i * (unsigned int)PAGE_SIZE,
+				       (unsigned int)PAGE_SIZE);
+
+		handle = zs_malloc(pool->zs_pool, len, gfp, page_to_nid(page));
+		if (IS_ERR_VALUE(handle))
+			goto free_handles;
+		zs_obj_write(pool->zs_pool, handle,
+			     acomp_ctx->buffer + i * PAGE_SIZE, len);
+		chunk->handles[i] = handle;
+	}
+
+	atomic_set(&chunk->nr_slots, 1U << order);
+	chunk->nr_handles = nr_handles;
+	entry->chunk = chunk;
+	entry->length = dlen;
+	entry->order = order;
+	mutex_unlock(&acomp_ctx->mutex);
+	return true;
+
+free_handles:
+	while (i--)
+		zs_free(pool->zs_pool, chunk->handles[i]);
+	kfree(chunk);
+fallback:
+	zswap_chunk_fallback++;
+	mutex_unlock(&acomp_ctx->mutex);
+	return false;
+}
+
+/*
+ * Decompresses a chunk entry into the pages of @folio that it overlaps. If
+ * the folio covers the whole chunk, the stream is decompressed in place,
+ * otherwise it goes through the per-CPU buffer. With @buf, the whole chunk
+ * is decompressed there instead and @folio is ignored.
+ *
+ * Returns the decompressed length, or a negative error code.
+ */
+static int zswap_decompress_chunk(struct zswap_entry *entry,
+				   struct folio *folio, u8 *buf)
+{
+	pgoff_t first = swp_offset(entry->swpentry);
+	pgoff_t last = first + (1UL << entry->order);
+	pgoff_t folio_first = 0, folio_last = 0;
+	unsigned int size = PAGE_SIZE << entry->order;
+	struct zswap_chunk *chunk = entry->chunk;
+	struct zswap_pool *pool = entry->pool;
+	struct crypto_acomp_ctx *acomp_ctx;
+	struct scatterlist input, output;
+	u8 *src, *dst = NULL;
+	unsigned int i;
+	int ret, dlen;
+
+	if (!buf) {
+		folio_first = swp_offset(folio->swap);
+		folio_last = folio_first + folio_nr_pages(folio);
+	}
+
+	acomp_ctx = raw_cpu_ptr(pool->acomp_ctx);
+	mutex_lock(&acomp_ctx->mutex);
+
+	src = acomp_ctx->buffer;
+	for (i = 0; i < chunk->nr_handles; i++) {
+		struct scatterlist sg[2];
+		unsigned int len = min(entry->length - i * (unsigned int)PAGE_SIZE,
+				       (unsigned int)PAGE_SIZE);
+
+		zs_obj_read_sg_begin(pool->zs_pool, chunk->handles[i], sg, len);
+		memcpy_from_sglist(src + i * PAGE_SIZE, sg, 0, len);
+		zs_obj_read_sg_end(pool->zs_pool, chunk->handles[i]);
+	}
+	sg_init_one(&input, src, entry->length);
+
+	if (buf) {
+		sg_init_one(&output, buf, size);
+	} else if (first >= folio_first && last <= folio_last) {
+		sg_init_table(&output, 1);
+		sg_set_page(&output, folio_page(folio, first - folio_first),
+			    size, 0);
+	} else {
+		dst = acomp_ctx->buffer + ZSWAP_MAX_CHUNK_SIZE;
+		sg_init_one(&output, dst, size);
+	}
+	acomp_request_set_params(acomp_ctx->req, &input, &output,
+				 entry->length, size);
+	ret = crypto_wait_req(crypto_acomp_decompress(acomp_ctx->req),
+			      &acomp_ctx->wait);
+	dlen = acomp_ctx->req->dlen;
+
+	if (!ret && dlen == size && dst) {
+		pgoff_t offset;
+
+		for (offset = max(first, folio_first);
+		     offset < min(last, folio_last); offset++)
+			memcpy_to_page(folio_page(folio, offset - folio_first), 0,
+				       dst + (offset - first) * PAGE_SIZE,
+				       PAGE_SIZE);
+	}
+	mutex_unlock(&acomp_ctx->mutex);
+
+	return ret ? ret : dlen;
+}
+
+/*
+ * Decompresses @entry into the pages of @folio backing the same swap slots.
+ * The folio may be larger than the entry, or smaller than a chunk entry.
+ */
 static bool zswap_decompress(struct zswap_entry *entry, struct folio *folio)
 {
 	struct zswap_pool *pool = entry->pool;
 	struct scatterlist input[2]; /* zsmalloc returns an SG list 1-2 entries */
 	struct scatterlist output;
 	struct crypto_acomp_ctx *acomp_ctx;
+	struct page *page;
 	int ret = 0, dlen;
 
+	if (entry->order) {
+		dlen = zswap_decompress_chunk(entry, folio, NULL);
+		if (dlen == PAGE_SIZE << entry->order)
+			return true;
+		goto fail;
+	}
+
+	page = folio_page(folio, swp_offset(entry->swpentry) -
+				 swp_offset(folio->swap));
+
 	acomp_ctx = raw_cpu_ptr(pool->acomp_ctx);
 	mutex_lock(&acomp_ctx->mutex);
 	zs_obj_read_sg_begin(pool->zs_pool, entry->handle, input, entry->length);
@@ -939,14 +1387,14 @@ static bool zswap_decompress(struct zswap_entry *entry, struct folio *folio)
 
 		WARN_ON_ONCE(input->length != PAGE_SIZE);
 
-		dst = kmap_local_folio(folio, 0);
+		dst = kmap_local_page(page);
 		memcpy_from_sglist(dst, input, 0, PAGE_SIZE);
 		dlen = PAGE_SIZE;
 		kunmap_local(dst);
-		flush_dcache_folio(folio);
+		flush_dcache_page(page);
 	} else {
 		sg_init_table(&output, 1);
-		sg_set_folio(&output, folio, PAGE_SIZE, 0);
+		sg_set_page(&output, page, PAGE_SIZE, 0);
 		acomp_request_set_params(acomp_ctx->req, input, &output,
 					 entry->length, PAGE_SIZE);
 		ret = crypto_acomp_decompress(acomp_ctx->req);
@@ -960,6 +1408,7 @@ static bool zswap_decompress(struct zswap_entry *entry, struct folio *folio)
 	if (!ret && dlen == PAGE_SIZE)
 		return true;
 
+fail:
 	zswap_decompress_fail++;
 	pr_alert_ratelimited("Decompression error from zswap (%d:%lu %s %u->%d)\n",
 						swp_type(entry->swpentry),
@@ -972,6 +1421,42 @@ static bool zswap_decompress(struct zswap_entry *entry, struct folio *folio)
 /*********************************
 * writeback code
 **********************************/
+/*
+ * A chunk written back slot by slot is decompressed once into a buffer, on the
+ * first slot that verifies the entry, and copied out of it for the others.
+ * That slot also pins @entry, so that it can't be freed and its memory reused
+ * for another entry that later slots would mistake it for.
+ */
+struct zswap_chunk_buf {
+	u8 *data;
+	struct zswap_entry *entry;
+	bool filled;
+};
+
+static bool zswap_decompress_slot(struct zswap_entry *entry,
+				  struct folio *folio,
+				  struct zswap_chunk_buf *cbuf)
+{
+	pgoff_t index = swp_offset(folio->swap) - swp_offset(entry->swpentry);
+
+	if (!cbuf || !cbuf->data)
+		return zswap_decompress(entry, folio);
+
+	if (!cbuf->filled || cbuf->entry != entry) {
+		cbuf->filled = false;
+		if (zswap_decompress_chunk(entry, NULL, cbuf->data) !=
+		    PAGE_SIZE << entry->order) {
+			zswap_decompress_fail++;
+			return false;
+		}
+		cbuf->filled = true;
+	}
+
+	memcpy_to_page(folio_page(folio, 0), 0, cbuf->data + index * PAGE_SIZE,
+		       PAGE_SIZE);
+	return true;
+}
+
 /*
  * Attempts to free an entry by adding a folio to the swap cache,
  * decompressing the entry data into the folio, and issuing a
@@ -983,15 +1468,21 @@ static bool zswap_decompress(struct zswap_entry *entry, struct folio *folio)
  * in the first place.  After the folio has been decompressed into
  * the swap cache, the compressed version stored by zswap can be
  * freed.
+ *
+ * A chunk entry is written back as one large folio, so that the range
+ * stays either entirely in zswap or entirely on the swap device.
  */
-static int zswap_writeback_entry(struct zswap_entry *entry,
-				 swp_entry_t swpentry)
+static int __zswap_writeback_entry(struct zswap_entry *entry,
+				   swp_entry_t swpentry, unsigned int order,
+				   struct zswap_chunk_buf *cbuf)
 {
+	unsigned int i, nr_pages = 1U << order;
 	struct xarray *tree;
 	pgoff_t offset = swp_offset(swpentry);
 	struct folio *folio;
 	struct mempolicy *mpol;
 	struct swap_info_struct *si;
+	gfp_t gfp = GFP_KERNEL;
 	int ret = 0;
 
 	/* try to allocate swap cache folio */
@@ -999,8 +1490,10 @@ static int zswap_writeback_entry(struct zswap_entry *entry,
 	if (!si)
 		return -EEXIST;
 
+	if (order)
+		gfp |= __GFP_NORETRY | __GFP_NOWARN;
 	mpol = get_task_policy(current);
-	folio = swap_cache_alloc_folio(swpentry, GFP_KERNEL, BIT(0), NULL, mpol,
+	folio = swap_cache_alloc_folio(swpentry, gfp, BIT(order), NULL, mpol,
 				       NO_INTERLEAVE_INDEX);
 	put_swap_device(si);
 
@@ -1024,23 +1517,33 @@ static int zswap_writeback_entry(struct zswap_entry *entry,
 	 * be dereferenced.
 	 */
 	tree = swap_zswap_tree(swpentry);
-	if (entry != xa_load(tree, offset)) {
-		ret = -ENOMEM;
-		goto out;
+	for (i = 0; i < nr_pages; i++) {
+		if (entry != xa_load(tree, offset + i)) {
+			ret = -ENOENT;
+			goto out;
+		}
 	}
 
-	if (!zswap_decompress(entry, folio)) {
+	/* The slot references @entry, so it is safe to take another one */
+	if (cbuf && !cbuf->entry) {
+		atomic_inc(&entry->chunk->nr_slots);
+		cbuf->entry = entry;
+	}
+
+	if (!zswap_decompress_slot(entry, folio, cbuf)) {
 		ret = -EIO;
 		goto out;
 	}
 
-	xa_erase(tree, offset);
-
-	count_vm_event(ZSWPWB);
+	count_vm_events(ZSWPWB, nr_pages);
 	if (entry->objcg)
-		count_objcg_events(entry->objcg, ZSWPWB, 1);
+		count_objcg_events(entry->objcg, ZSWPWB, nr_pages);
+	zswap_written_back_pages += nr_pages;
 
-	zswap_entry_free(entry);
+	for (i = 0; i < nr_pages; i++) {
+		xa_erase(tree, offset + i);
+		zswap_entry_put(entry);
+	}
 
 	/* folio is up to date */
 	folio_mark_uptodate(folio);
@@ -1060,6 +1563,39 @@ static int zswap_writeback_entry(struct zswap_entry *entry,
 	return ret;
 }
 
+static int zswap_writeback_entry(struct zswap_entry *entry,
+				 swp_entry_t swpentry, unsigned int order)
+{
+	struct zswap_chunk_buf cbuf = {};
+	unsigned int i, written = 0;
+	int ret;
+
+	ret = __zswap_writeback_entry(entry, swpentry, order, NULL);
+	if (!order || (ret != -EEXIST && ret != -ENOENT && ret != -EBUSY))
+		return ret;
+
+	/*
+	 * Some pages of the chunk were swapped in or freed since it was
+	 * stored, so the range is already split between zswap and memory.
+	 * Write back the slots that are left one by one. Without a buffer,
+	 * each slot decompresses the chunk on its own.
+	 */
+	cbuf.data = kmalloc(PAGE_SIZE << order,
+			    GFP_KERNEL | __GFP_NORETRY | __GFP_NOWARN);
+	for (i = 0; i < 1U << order; i++) {
+		swp_entry_t swp = swp_entry(swp_type(swpentry),
+					    swp_offset(swpentry) + i);
+
+		if (!__zswap_writeback_entry(entry, swp, 0, &cbuf))
+			written++;
+	}
+	kfree(cbuf.data);
+	if (cbuf.entry)
+		zswap_entry_put(cbuf.entry);
+
+	return written ? 0 : ret;
+}
+
 /*********************************
 * shrinker functions
 **********************************/
@@ -1093,6 +1629,7 @@ static enum lru_status shrink_memcg_cb(struct list_head *item, struct list_lru_o
 	swp_entry_t swpentry;
 	enum lru_status ret = LRU_REMOVED_RETRY;
 	int writeback_result;
+	unsigned int order;
 
 	/*
 	 * Second chance algorithm: if the entry has its referenced bit set, give it
@@ -1133,10 +1670,12 @@ static enum lru_status shrink_memcg_cb(struct list_head *item, struct list_lru_o
 
 	/*
 	 * Once the lru lock is dropped, the entry might get freed. The
-	 * swpentry is copied to the stack, and entry isn't deref'd again
-	 * until the entry is verified to still be alive in the tree.
+	 * swpentry and order are copied to the stack, and entry isn't
+	 * deref'd again until the entry is verified to still be alive in
+	 * the tree.
 	 */
 	swpentry = entry->swpentry;
+	order = entry->order;
 
 	/*
 	 * It's safe to drop the lock here because we return either
@@ -1144,7 +1683,7 @@ static enum lru_status shrink_memcg_cb(struct list_head *item, struct list_lru_o
 	 */
 	spin_unlock(&l->lock);
 
-	writeback_result = zswap_writeback_entry(entry, swpentry);
+	writeback_result = zswap_writeback_entry(entry, swpentry, order);
 
 	if (writeback_result) {
 		zswap_reject_reclaim_fail++;
@@ -1159,8 +1698,6 @@ static enum lru_status shrink_memcg_cb(struct list_head *item, struct list_lru_o
 			ret = LRU_STOP;
 			*encountered_page_in_swapcache = true;
 		}
-	} else {
-		zswap_written_back_pages++;
 	}
 
 	return ret;
@@ -1393,42 +1930,42 @@ static void shrink_worker(struct work_struct *w)
 * main API
 **********************************/
 
-static bool zswap_store_page(struct page *page,
-			     struct obj_cgroup *objcg,
-			     struct zswap_pool *pool)
+/*
+ * Publishes a compressed entry for the 2^@order pages starting at @page. A
+ * chunk entry is published at the offset of every page it covers. On
+ * failure, the entry and its compressed data are freed.
+ */
+static bool zswap_store_entry(struct page *page, struct zswap_entry *entry,
+			      unsigned int order, struct obj_cgroup *objcg,
+			      struct zswap_pool *pool)
 {
 	swp_entry_t page_swpentry = page_swap_entry(page);
-	struct zswap_entry *entry, *old;
-
-	/* allocate entry */
-	entry = zswap_entry_cache_alloc(GFP_KERNEL, page_to_nid(page));
-	if (!entry) {
-		zswap_reject_kmemcache_fail++;
-		return false;
-	}
-
-	if (!zswap_compress(page, entry, pool))
-		goto compress_failed;
+	unsigned int i, nr_pages = 1U << order;
+	struct zswap_entry *old;
+	struct xarray *tree;
 
-	old = xa_store(swap_zswap_tree(page_swpentry),
-		       swp_offset(page_swpentry),
-		       entry, GFP_KERNEL);
-	if (xa_is_err(old)) {
-		int err = xa_err(old);
+	/* All pages of a chunk live within the same tree */
+	tree = swap_zswap_tree(page_swpentry);
+	for (i = 0; i < nr_pages; i++) {
+		old = xa_store(tree, swp_offset(page_swpentry) + i,
+			       entry, GFP_KERNEL);
+		if (xa_is_err(old)) {
+			int err = xa_err(old);
+
+			WARN_ONCE(err != -ENOMEM, "unexpected xarray error: %d\n", err);
+			zswap_reject_alloc_fail++;
+			goto store_failed;
+		}
 
-		WARN_ONCE(err != -ENOMEM, "unexpected xarray error: %d\n", err);
-		zswap_reject_alloc_fail++;
-		goto store_failed;
+		/*
+		 * We may have had an existing entry that became stale when
+		 * the folio was redirtied and now the new version is being
+		 * swapped out. Get rid of the old.
+		 */
+		if (old)
+			zswap_entry_put(old);
 	}
 
-	/*
-	 * We may have had an existing entry that became stale when
-	 * the folio was redirtied and now the new version is being
-	 * swapped out. Get rid of the old.
-	 */
-	if (old)
-		zswap_entry_free(old);
-
 	/*
 	 * The entry is successfully compressed and stored in the tree, there is
 	 * no further possibility of failure. Grab refs to the pool and objcg,
@@ -1439,11 +1976,13 @@ static bool zswap_store_page(struct page *page,
 	zswap_pool_get(pool);
 	if (objcg) {
 		obj_cgroup_get(objcg);
-		obj_cgroup_charge_zswap(objcg, entry->length);
+		obj_cgroup_charge_zswap(objcg, entry->length, nr_pages);
 	}
-	atomic_long_inc(&zswap_stored_pages);
-	if (entry->length == PAGE_SIZE)
+	atomic_long_add(nr_pages, &zswap_stored_pages);
+	if (!order && entry->length == PAGE_SIZE)
 		atomic_long_inc(&zswap_stored_incompressible_pages);
+	if (order)
+		zswap_stored_chunks++;
 
 	/*
 	 * We finish initializing the entry while it's already in xarray.
@@ -1467,12 +2006,122 @@ static bool zswap_store_page(struct page *page,
 	return true;
 
 store_failed:
-	zs_free(pool->zs_pool, entry->handle);
+	/* Unpublish the part of the chunk that made it into the tree */
+	while (i--)
+		xa_erase(tree, swp_offset(page_swpentry) + i);
+	if (order)
+		zswap_chunk_free(pool->zs_pool, entry->chunk);
+	else
+		zs_free(pool->zs_pool, entry->handle);
+	zswap_entry_cache_free(entry);
+	return false;
+}
+
+static bool zswap_store_page(struct page *page, unsigned int order,
+			     struct obj_cgroup *objcg,
+			     struct zswap_pool *pool)
+{
+	struct zswap_entry *entry;
+
+	/* allocate entry */
+	entry = zswap_entry_cache_alloc(GFP_KERNEL, page_to_nid(page));
+	if (!entry) {
+		zswap_reject_kmemcache_fail++;
+		return false;
+	}
+
+	entry->order = 0;
+	if (order) {
+		if (!zswap_compress_chunk(page, order, entry, pool))
+			goto compress_failed;
+	} else if (!zswap_compress(page, entry, pool)) {
+		goto compress_failed;
+	}
+
+	return zswap_store_entry(page, entry, order, objcg, pool);
+
 compress_failed:
 	zswap_entry_cache_free(entry);
 	return false;
 }
 
+static void zswap_entries_free(struct zswap_pool *pool,
+			       struct zswap_entry **entries, unsigned int nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++) {
+		zs_free(pool->zs_pool, entries[i]->handle);
+		zswap_entry_cache_free(entries[i]);
+	}
+}
+
+/*
+ * Stores @nr_pages order-0 pages of @folio starting at @start, compressing
+ * them in batches if enabled.
+ */
+static bool zswap_store_pages(struct folio *folio, long start, long nr_pages,
+			      struct obj_cgroup *objcg,
+			      struct zswap_pool *pool)
+{
+	struct crypto_acomp_ctx *acomp_ctx;
+	struct zswap_entry **entries;
+	struct page **pages;
+	unsigned int i, nr;
+	bool ret = false;
+	long index;
+
+	if (!zswap_batch_compress || ZSWAP_MAX_BATCH == 1 || nr_pages == 1) {
+		for (index = start; index < start + nr_pages; index++) {
+			if (!zswap_store_page(folio_page(folio, index), 0,
+					      objcg, pool))
+				return false;
+		}
+		return true;
+	}
+
+	acomp_ctx = raw_cpu_ptr(pool->acomp_ctx);
+	mutex_lock(&acomp_ctx->batch_mutex);
+	pages = acomp_ctx->batch->pages;
+	entries = acomp_ctx->batch->entries;
+
+	for (index = start; index < start + nr_pages; index += nr) {
+		nr = min_t(long, start + nr_pages - index, ZSWAP_MAX_BATCH);
+
+		for (i = 0; i < nr; i++) {
+			pages[i] = folio_page(folio, index + i);
+			entries[i] = zswap_entry_cache_alloc(GFP_KERNEL,
+							page_to_nid(pages[i]));
+			if (!entries[i]) {
+				zswap_reject_kmemcache_fail++;
+				zswap_entries_free(pool, entries, i);
+				goto unlock;
+			}
+			entries[i]->order = 0;
+			entries[i]->handle = 0;
+		}
+
+		if (!zswap_compress_batch(acomp_ctx, nr, pool)) {
+			zswap_entries_free(pool, entries, nr);
+			goto unlock;
+		}
+
+		for (i = 0; i < nr; i++) {
+			if (!zswap_store_entry(pages[i], entries[i], 0,
+					       objcg, pool)) {
+				zswap_entries_free(pool, entries + i + 1,
+						   nr - i - 1);
+				goto unlock;
+			}
+		}
+	}
+	ret = true;
+
+unlock:
+	mutex_unlock(&acomp_ctx->batch_mutex);
+	return ret;
+}
+
 bool zswap_store(struct folio *folio)
 {
 	long nr_pages = folio_nr_pages(folio);
@@ -1480,8 +2129,9 @@ bool zswap_store(struct folio *folio)
 	struct obj_cgroup *objcg = NULL;
 	struct mem_cgroup *memcg = NULL;
 	struct zswap_pool *pool;
+	unsigned int order = 0;
 	bool ret = false;
-	long index;
+	long index, nr;
 
 	VM_WARN_ON_ONCE(!folio_test_locked(folio));
 	VM_WARN_ON_ONCE(!folio_test_swapcache(folio));
@@ -1515,10 +2165,18 @@ bool zswap_store(struct folio *folio)
 		mem_cgroup_put(memcg);
 	}
 
-	for (index = 0; index < nr_pages; ++index) {
-		struct page *page = folio_page(folio, index);
+	if (zswap_large_chunks)
+		order = min_t(unsigned int, folio_order(folio),
+			      ZSWAP_MAX_CHUNK_ORDER);
+
+	for (index = 0; index < nr_pages; index += nr) {
+		nr = order ? 1L << order : nr_pages;
 
-		if (!zswap_store_page(page, objcg, pool))
+		if (order && zswap_store_page(folio_page(folio, index), order,
+					      objcg, pool))
+			continue;
+
+		if (!zswap_store_pages(folio, index, nr, objcg, pool))
 			goto put_pool;
 	}
 
@@ -1552,13 +2210,48 @@ bool zswap_store(struct folio *folio)
 			tree = swap_zswap_tree(swp_entry(type, offset + index));
 			entry = xa_erase(tree, offset + index);
 			if (entry)
-				zswap_entry_free(entry);
+				zswap_entry_put(entry);
 		}
 	}
 
 	return ret;
 }
 
+/**
+ * zswap_can_load_large() - check if a large folio can be loaded from zswap
+ * @swp: swap entry of the first page of the folio
+ * @nr_pages: number of pages in the folio
+ *
+ * swap_read_folio() can't read a large folio partly from zswap and partly
+ * from the swap device. Which entries back the range doesn't matter: plain
+ * pages and chunks can be mixed freely.
+ *
+ * The answer is only stable once the range is in the swap cache, which keeps
+ * writeback and invalidation away from it, so the swap cache checks again
+ * under the cluster lock when adding a large folio.
+ *
+ * Return: true if either all or none of the pages are stored in zswap.
+ */
+bool zswap_can_load_large(swp_entry_t swp, unsigned int nr_pages)
+{
+	pgoff_t offset = swp_offset(swp);
+	struct xarray *tree;
+	unsigned int i;
+	bool stored;
+
+	if (zswap_never_enabled())
+		return true;
+
+	/* A large folio never straddles two trees */
+	tree = swap_zswap_tree(swp);
+	stored = xa_load(tree, offset);
+	for (i = 1; i < nr_pages; i++) {
+		if (!!xa_load(tree, offset + i) != stored)
+			return false;
+	}
+	return true;
+}
+
 /**
  * zswap_load() - load a folio from zswap
  * @folio: folio to load
@@ -1571,10 +2264,10 @@ bool zswap_store(struct folio *folio)
  *  NOT marked up-to-date, so that an IO error is emitted (e.g. do_swap_page()
  *  will SIGBUS).
  *
- *  -EINVAL: if the swapped out content was in zswap, but the page belongs
- *  to a large folio, which is not supported by zswap. The folio is unlocked,
- *  but NOT marked up-to-date, so that an IO error is emitted (e.g.
- *  do_swap_page() will SIGBUS).
+ *  -EINVAL: if the swapped out content of a large folio was only partially
+ *  in zswap, which is not supported (see zswap_can_load_large()). The folio
+ *  is unlocked, but NOT marked up-to-date, so that an IO error is emitted
+ *  (e.g. do_swap_page() will SIGBUS).
  *
  *  -ENOENT: if the swapped out content was not in zswap. The folio remains
  *  locked on return.
@@ -1583,8 +2276,10 @@ int zswap_load(struct folio *folio)
 {
 	swp_entry_t swp = folio->swap;
 	pgoff_t offset = swp_offset(swp);
+	long nr_pages = folio_nr_pages(folio);
 	struct xarray *tree = swap_zswap_tree(swp);
 	struct zswap_entry *entry;
+	long index, next;
 
 	VM_WARN_ON_ONCE(!folio_test_locked(folio));
 	VM_WARN_ON_ONCE(!folio_test_swapcache(folio));
@@ -1592,30 +2287,35 @@ int zswap_load(struct folio *folio)
 	if (zswap_never_enabled())
 		return -ENOENT;
 
-	/*
-	 * Large folios should not be swapped in while zswap is being used, as
-	 * they are not properly handled. Zswap does not properly load large
-	 * folios, and a large folio may only be partially in zswap.
-	 */
-	if (WARN_ON_ONCE(folio_test_large(folio))) {
-		folio_unlock(folio);
-		return -EINVAL;
-	}
-
 	entry = xa_load(tree, offset);
-	if (!entry)
+	if (!entry) {
+		if (!zswap_can_load_large(swp, nr_pages))
+			goto partial;
 		return -ENOENT;
+	}
 
-	if (!zswap_decompress(entry, folio)) {
-		folio_unlock(folio);
-		return -EIO;
+	/*
+	 * The folio lock keeps every slot of the folio stable. Entries may
+	 * cover a single page, or a chunk that extends past either end of
+	 * the folio if it was stored from a larger one.
+	 */
+	for (index = 0; index < nr_pages; index = next) {
+		entry = xa_load(tree, offset + index);
+		if (!entry)
+			goto partial;
+
+		if (!zswap_decompress(entry, folio)) {
+			folio_unlock(folio);
+			return -EIO;
+		}
+
+		next = swp_offset(entry->swpentry) + (1L << entry->order) -
+		       offset;
 	}
 
 	folio_mark_uptodate(folio);
 
-	count_vm_event(ZSWPIN);
-	if (entry->objcg)
-		count_objcg_events(entry->objcg, ZSWPIN, 1);
+	count_vm_events(ZSWPIN, nr_pages);
 
 	/*
 	 * We are reading into the swapcache, invalidate zswap entry.
@@ -1625,11 +2325,19 @@ int zswap_load(struct folio *folio)
 	 * compression work.
 	 */
 	folio_mark_dirty(folio);
-	xa_erase(tree, offset);
-	zswap_entry_free(entry);
+	for (index = 0; index < nr_pages; index++) {
+		entry = xa_erase(tree, offset + index);
+		if (entry->objcg)
+			count_objcg_events(entry->objcg, ZSWPIN, 1);
+		zswap_entry_put(entry);
+	}
 
 	folio_unlock(folio);
 	return 0;
+
+partial:
+	folio_unlock(folio);
+	return -EINVAL;
 }
 
 void zswap_invalidate(swp_entry_t swp)
@@ -1643,7 +2351,7 @@ void zswap_invalidate(swp_entry_t swp)
 
 	entry = xa_erase(tree, offset);
 	if (entry)
-		zswap_entry_free(entry);
+		zswap_entry_put(entry);
 }
 
 int zswap_swapon(int type, unsigned long nr_pages)
@@ -1736,6 +2444,10 @@ static int zswap_debugfs_init(void)
 			   zswap_debugfs_root, &zswap_decompress_fail);
 	debugfs_create_u64("written_back_pages", 0444,
 			   zswap_debugfs_root, &zswap_written_back_pages);
+	debugfs_create_u64("stored_chunks", 0444,
+			   zswap_debugfs_root, &zswap_stored_chunks);
+	debugfs_create_u64("chunk_fallback", 0444,
+			   zswap_debugfs_root, &zswap_chunk_fallback);
 	debugfs_create_file("pool_total_size", 0444,
 			    zswap_debugfs_root, NULL, &total_size_fops);
 	debugfs_create_file("stored_pages", 0444,
@@ -1779,6 +2491,11 @@ static int zswap_setup(void)
 	if (!shrink_wq)
 		goto shrink_wq_fail;
 
+	compress_wq = alloc_workqueue("zswap-compress",
+			WQ_UNBOUND|WQ_MEM_RECLAIM|WQ_HIGHPRI, 0);
+	if (!compress_wq)
+		goto compress_wq_fail;
+
 	zswap_shrinker = zswap_alloc_shrinker();
 	if (!zswap_shrinker)
 		goto shrinker_fail;
@@ -1807,6 +2524,8 @@ static int zswap_setup(void)
 lru_fail:
 	shrinker_free(zswap_shrinker);
 shrinker_fail:
+	destroy_workqueue(compress_wq);
+compress_wq_fail:
 	destroy_workqueue(shrink_wq);
 shrink_wq_fail:
 	cpuhp_remove_multi_state(CPUHP_MM_ZSWP_POOL_PREPARE);
@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * mem-fork.c
+ *
+ * fork: Benchmark for fork(2) latency as the resident set of the parent grows
+ */
+#include "bench.h"
+#include <subcmd/parse-options.h>
+#include "util/stat.h"
+#include "util/string2.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <linux/time64.h>
+
+static const char	*min_size_str	= "64MB";
+static const char	*max_size_str	= "1GB";
+static unsigned int	nr_loops	= 10;
+static bool		use_thp;
+
+static const struct option options[] = {
+	OPT_STRING('s', "min-size", &min_size_str, "64MB",
+		   "Smallest resident set to fork with (e.g. 1MB, 2GB)"),
+	OPT_STRING('S', "max-size", &max_size_str, "1GB",
+		   "Largest resident set to fork with, doubling from --min-size"),
+	OPT_UINTEGER('l', "nr_loops", &nr_loops,
+		     "Number of forks to average per size"),
+	OPT_BOOLEAN('H', "thp", &use_thp,
+		    "Back the resident set with transparent huge pages"),
+	OPT_END()
+};
+
+static const char * const bench_mem_fork_usage[] = {
+	"perf bench mem fork <options>",
+	NULL
+};
+
+/* Time how long the parent is stalled in fork(), in microseconds */
+static int time_fork(u64 *usec)
+{
+	struct timeval start, end, diff;
+	pid_t pid;
+
+	gettimeofday(&start, NULL);
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (pid == 0)
+		_exit(0);
+	gettimeofday(&end, NULL);
+
+	if (waitpid(pid, NULL, 0) < 0)
+		return -1;
+
+	timersub(&end, &start, &diff);
+	*usec = diff.tv_sec * USEC_PER_SEC + diff.tv_usec;
+	return 0;
+}
+
+static int bench_fork_size(size_t size)
+{
+	struct stats stats;
+	unsigned int i;
+	double avg;
+	void *buf;
+	u64 usec;
+
+	buf = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		perror("mmap");
+		return -1;
+	}
+	madvise(buf, size, use_thp ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+
+	/* Populate it, so that fork() has page tables to copy */
+	memset(buf, 1, size);
+
+	init_stats(&stats);
+	for (i = 0; i < nr_loops; i++) {
+		if (time_fork(&usec)) {
+			perror("fork");
+			munmap(buf, size);
+			return -1;
+		}
+		update_stats(&stats, usec);
+	}
+	munmap(buf, size);
+
+	avg = avg_stats(&stats);
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %10zu MB: %12.1f usecs/fork (+- %5.2f%%)\n",
+		       size >> 20, avg,
+		       rel_stddev_stats(stddev_stats(&stats), avg));
+		break;
+	case BENCH_FORMAT_SIMPLE:
+		printf("%zu %.1f\n", size >> 20, avg);
+		break;
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		return -1;
+	}
+
+	return 0;
+}
+
+int bench_mem_fork(int argc, const char **argv)
+{
+	size_t size, min_size, max_size;
+
+	argc = parse_options(argc, argv, options, bench_mem_fork_usage, 0);
+	if (argc) {
+		usage_with_options(bench_mem_fork_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	min_size = (size_t)perf_atoll((char *)min_size_str);
+	max_size = (size_t)perf_atoll((char *)max_size_str);
+	if ((s64)min_size <= 0 || (s64)max_size <= 0 || min_size > max_size) {
+		fprintf(stderr, "Invalid size range: %s - %s\n",
+			min_size_str, max_size_str);
+		return 1;
+	}
+	if (!nr_loops) {
+		fprintf(stderr, "Invalid nr_loops: %u\n", nr_loops);
+		return 1;
+	}
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Forking with %u loops per size, THP %s\n\n",
+		       nr_loops, use_thp ? "on" : "off");
+
+	for (size = min_size; size <= max_size; size *= 2) {
+		if (bench_fork_size(size))
+			return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * mem-migrate.c
+ *
+ * migrate: Benchmark for page migration throughput between two NUMA nodes
+ */
+#include "bench.h"
+#include <subcmd/parse-options.h>
+#include "util/stat.h"
+#include "util/string2.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <linux/time64.h>
+
+/* From <numaif.h>, to not depend on libnuma */
+#define MPOL_BIND	2
+#define MPOL_MF_MOVE	(1 << 1)
+
+static const char	*size_str	= "1GB";
+static unsigned int	nr_loops	= 10;
+static unsigned int	from_node;
+static unsigned int	to_node		= 1;
+static bool		use_thp;
+
+static const struct option options[] = {
+	OPT_STRING('s', "size", &size_str, "1GB",
+		   "Size of the region to migrate back and forth (e.g. 1MB, 2GB)"),
+	OPT_UINTEGER('l', "nr_loops", &nr_loops,
+		     "Number of round trips to average"),
+	OPT_UINTEGER('f', "from", &from_node,
+		     "Node the region is first placed on"),
+	OPT_UINTEGER('t', "to", &to_node,
+		     "Node the region is migrated to and back from"),
+	OPT_BOOLEAN('H', "thp", &use_thp,
+		    "Back the region with transparent huge pages"),
+	OPT_END()
+};
+
+static const char * const bench_mem_migrate_usage[] = {
+	"perf bench mem migrate <options>",
+	NULL
+};
+
+/* Bind [buf, buf + size) to @node, moving what is already populated */
+static int move_to_node(void *buf, size_t size, unsigned int node)
+{
+	unsigned long nodemask[4] = { 0 };
+	unsigned int bits = sizeof(nodemask) * 8;
+
+	if (node >= bits) {
+		errno = EINVAL;
+		return -1;
+	}
+	nodemask[node / (sizeof(long) * 8)] = 1UL << (node % (sizeof(long) * 8));
+
+	return syscall(SYS_mbind, buf, size, MPOL_BIND, nodemask, bits + 1,
+		       MPOL_MF_MOVE);
+}
+
+/* Time one migration of the region to @node, in microseconds */
+static int time_migrate(void *buf, size_t size, unsigned int node, u64 *usec)
+{
+	struct timeval start, end, diff;
+
+	gettimeofday(&start, NULL);
+	if (move_to_node(buf, size, node))
+		return -1;
+	gettimeofday(&end, NULL);
+
+	timersub(&end, &start, &diff);
+	*usec = diff.tv_sec * USEC_PER_SEC + diff.tv_usec;
+	return 0;
+}
+
+int bench_mem_migrate(int argc, const char **argv)
+{
+	struct stats stats;
+	unsigned int i;
+	double avg;
+	size_t size;
+	void *buf;
+	u64 usec;
+
+	argc = parse_options(argc, argv, options, bench_mem_migrate_usage, 0);
+	if (argc) {
+		usage_with_options(bench_mem_migrate_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	size = (size_t)perf_atoll((char *)size_str);
+	if ((s64)size <= 0) {
+		fprintf(stderr, "Invalid size:%s\n", size_str);
+		return 1;
+	}
+	if (!nr_loops || from_node == to_node) {
+		fprintf(stderr, "Invalid nr_loops or nodes: %u, %u -> %u\n",
+			nr_loops, from_node, to_node);
+		return 1;
+	}
+
+	buf = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	madvise(buf, size, use_thp ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+
+	/* Populate it on the source node, so that there is something to move */
+	if (move_to_node(buf, size, from_node)) {
+		perror("mbind");
+		goto err;
+	}
+	memset(buf, 1, size);
+
+	init_stats(&stats);
+	for (i = 0; i < nr_loops; i++) {
+		if (time_migrate(buf, size, to_node, &usec)) {
+			perror("mbind");
+			goto err;
+		}
+		update_stats(&stats, usec);
+		if (time_migrate(buf, size, from_node, &usec)) {
+			perror("mbind");
+			goto err;
+		}
+		update_stats(&stats, usec);
+	}
+	munmap(buf, size);
+
+	avg = avg_stats(&stats);
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# Migrating %s between nodes %u and %u, THP %s\n\n",
+		       size_str, from_node, to_node, use_thp ? "on" : "off");
+		printf(" %14.1f usecs/migration (+- %5.2f%%)\n", avg,
+		       rel_stddev_stats(stddev_stats(&stats), avg));
+		printf(" %14.3f GB/sec\n",
+		       (double)size / avg * USEC_PER_SEC / (1 << 30));
+		break;
+	case BENCH_FORMAT_SIMPLE:
+		printf("%.3f\n", (double)size / avg * USEC_PER_SEC / (1 << 30));
+		break;
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		return 1;
+	}
+
+	return 0;
+
+err:
+	munmap(buf, size);
+	return 1;
+}
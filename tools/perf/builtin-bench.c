@@ -66,6 +66,8 @@ static const struct bench mem_benchmarks[] = {
 	{ "memset",	"Benchmark for memset() functions",		bench_mem_memset	},
 	{ "find_bit",	"Benchmark for find_bit() functions",		bench_mem_find_bit	},
 	{ "mmap",	"Benchmark for mmap() mappings",		bench_mem_mmap		},
+	{ "fork",	"Benchmark for fork() as the RSS grows",	bench_mem_fork		},
+	{ "migrate",	"Benchmark for page migration between nodes",	bench_mem_migrate	},
 	{ "all",	"Run all memory access benchmarks",		NULL			},
 	{ NULL,		NULL,						NULL			}
 };
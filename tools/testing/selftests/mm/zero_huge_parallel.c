@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Check that huge folios zeroed at fault time by helper threads
+ * (vm.zero_huge_parallel_mb), with and without non-temporal stores
+ * (vm.zero_huge_nocache), come out fully zeroed whatever the faulting
+ * address within the folio.
+ *
+ * The hugetlb pool is dirtied first and the pages are faulted back in, so
+ * any chunk the helpers missed shows up as a non-zero byte.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "vm_util.h"
+#include "kselftest.h"
+
+#define PARALLEL_MB_PATH	"/proc/sys/vm/zero_huge_parallel_mb"
+#define NOCACHE_PATH		"/proc/sys/vm/zero_huge_nocache"
+#define NR_HUGEPAGES		4
+
+static unsigned long old_parallel_mb, old_nocache;
+
+static unsigned long read_sysctl(const char *path)
+{
+	char buf[32] = { };
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		ksft_exit_fail_perror(path);
+	if (read(fd, buf, sizeof(buf) - 1) <= 0)
+		ksft_exit_fail_perror(path);
+	close(fd);
+
+	return strtoul(buf, NULL, 10);
+}
+
+static void write_sysctl(const char *path, unsigned long val)
+{
+	char buf[32];
+	int fd, len;
+
+	len = snprintf(buf, sizeof(buf), "%lu", val);
+	fd = open(path, O_WRONLY);
+	if (fd < 0)
+		ksft_exit_fail_perror(path);
+	if (write(fd, buf, len) != len)
+		ksft_exit_fail_perror(path);
+	close(fd);
+}
+
+static void restore_sysctls(void)
+{
+	write_sysctl(PARALLEL_MB_PATH, old_parallel_mb);
+	write_sysctl(NOCACHE_PATH, old_nocache);
+}
+
+static double elapsed_ms(struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) * 1e3 +
+	       (end.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/* Returns true if all of the huge pages came out zeroed */
+static bool fault_and_check(const char *desc, size_t hpage_size,
+			    unsigned long parallel_mb, unsigned long nocache,
+			    size_t fault_off)
+{
+	size_t size = NR_HUGEPAGES * hpage_size;
+	struct timespec start;
+	bool zeroed = true;
+	char *map;
+	size_t i;
+
+	write_sysctl(PARALLEL_MB_PATH, parallel_mb);
+	write_sysctl(NOCACHE_PATH, nocache);
+
+	/* Leave garbage in the pool pages */
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (map == MAP_FAILED)
+		ksft_exit_fail_perror("mmap");
+	memset(map, 0xa5, size);
+	munmap(map, size);
+
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (map == MAP_FAILED)
+		ksft_exit_fail_perror("mmap");
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < NR_HUGEPAGES; i++)
+		map[i * hpage_size + fault_off] = 0;
+	ksft_print_msg("%s: faulted %d huge pages in %.2f ms\n", desc,
+		       NR_HUGEPAGES, elapsed_ms(&start));
+
+	for (i = 0; i < size; i += sizeof(unsigned long)) {
+		if (*(unsigned long *)(map + i)) {
+			ksft_print_msg("%s: non-zero byte at offset %zu\n",
+				       desc, i);
+			zeroed = false;
+			break;
+		}
+	}
+
+	munmap(map, size);
+	return zeroed;
+}
+
+int main(int argc, char **argv)
+{
+	size_t hpage_size = default_huge_page_size();
+	unsigned long hpage_mb;
+	unsigned int nocache;
+	const struct {
+		const char *name;
+		size_t off;
+	} faults[] = {
+		{ "first page", 0 },
+		{ "middle", hpage_size / 2 + 123 },
+		{ "last page", hpage_size - 1 },
+	};
+	char desc[64];
+	int i;
+
+	ksft_print_header();
+	ksft_set_plan(2 * ARRAY_SIZE(faults) + 1);
+
+	if (access(PARALLEL_MB_PATH, F_OK) || access(NOCACHE_PATH, F_OK))
+		ksft_exit_skip("parallel huge page zeroing not supported\n");
+	if (geteuid())
+		ksft_exit_skip("need root to change the zeroing sysctls\n");
+	if (!hpage_size)
+		ksft_exit_skip("no hugetlb support\n");
+	if (get_free_hugepages() < NR_HUGEPAGES)
+		ksft_exit_skip("need %d free huge pages\n", NR_HUGEPAGES);
+
+	hpage_mb = hpage_size >> 20;
+	if (!hpage_mb)
+		ksft_exit_skip("huge pages are smaller than 1MB\n");
+
+	old_parallel_mb = read_sysctl(PARALLEL_MB_PATH);
+	old_nocache = read_sysctl(NOCACHE_PATH);
+	atexit(restore_sysctls);
+
+	/* Serial zeroing, as a reference for the timings */
+	ksft_test_result(fault_and_check("serial", hpage_size, 0, 0, 0),
+			 "serial zeroing\n");
+
+	for (nocache = 0; nocache <= 1; nocache++) {
+		for (i = 0; i < ARRAY_SIZE(faults); i++) {
+			snprintf(desc, sizeof(desc), "parallel%s, fault at %s",
+				 nocache ? " nocache" : "", faults[i].name);
+			ksft_test_result(fault_and_check(desc, hpage_size,
+							 hpage_mb, nocache,
+							 faults[i].off),
+					 "%s\n", desc);
+		}
+	}
+
+	ksft_finished();
+}
@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * A scheduler which queues every task on one DSQ shared by all CPUs, created
+ * with SCX_CREATE_DSQ_LOCKLESS_ENQ, and dispatches from it in batches with
+ * scx_bpf_dsq_move_to_local_nr(). Used to measure the throughput of the shared
+ * DSQ under high wakeup rates.
+ */
+
+#include <scx/common.bpf.h>
+
+char _license[] SEC("license") = "GPL";
+
+#define SHARED_DSQ	0
+#define DISPATCH_BATCH	8
+
+s32 scx_bpf_create_dsq___v2(u64 dsq_id, s32 node, u64 flags) __ksym __weak;
+u32 scx_bpf_dsq_move_to_local_nr(u64 dsq_id, u32 nr, u64 enq_flags) __ksym __weak;
+
+const volatile bool lockless_enq = true;
+
+u64 nr_enqueued, nr_dispatched, nr_dispatch_calls;
+/* times tasks left the shared DSQ, whether dispatched or not */
+u64 nr_dequeued;
+/* most tasks moved by one scx_bpf_dsq_move_to_local_nr() call */
+u32 max_batch;
+
+UEI_DEFINE(uei);
+
+s32 BPF_STRUCT_OPS(dsq_throughput_select_cpu, struct task_struct *p,
+		   s32 prev_cpu, u64 wake_flags)
+{
+	bool is_idle;
+
+	/* pick the CPU to wake but always go through the shared DSQ */
+	return scx_bpf_select_cpu_dfl(p, prev_cpu, wake_flags, &is_idle);
+}
+
+void BPF_STRUCT_OPS(dsq_throughput_enqueue, struct task_struct *p,
+		    u64 enq_flags)
+{
+	__sync_fetch_and_add(&nr_enqueued, 1);
+	scx_bpf_dsq_insert(p, SHARED_DSQ, SCX_SLICE_DFL, enq_flags);
+}
+
+void BPF_STRUCT_OPS(dsq_throughput_dispatch, s32 cpu, struct task_struct *prev)
+{
+	u32 nr;
+
+	__sync_fetch_and_add(&nr_dispatch_calls, 1);
+
+	nr = scx_bpf_dsq_move_to_local_nr(SHARED_DSQ, DISPATCH_BATCH, 0);
+	if (nr)
+		__sync_fetch_and_add(&nr_dispatched, nr);
+	if (nr > max_batch)
+		max_batch = nr;
+}
+
+void BPF_STRUCT_OPS(dsq_throughput_dequeue, struct task_struct *p,
+		    u64 deq_flags)
+{
+	__sync_fetch_and_add(&nr_dequeued, 1);
+}
+
+s32 BPF_STRUCT_OPS_SLEEPABLE(dsq_throughput_init)
+{
+	return scx_bpf_create_dsq___v2(SHARED_DSQ, -1,
+				       lockless_enq ? SCX_CREATE_DSQ_LOCKLESS_ENQ : 0);
+}
+
+void BPF_STRUCT_OPS(dsq_throughput_exit, struct scx_exit_info *ei)
+{
+	UEI_RECORD(uei, ei);
+}
+
+SEC(".struct_ops.link")
+struct sched_ext_ops dsq_throughput_ops = {
+	.select_cpu		= (void *)dsq_throughput_select_cpu,
+	.enqueue		= (void *)dsq_throughput_enqueue,
+	.dispatch		= (void *)dsq_throughput_dispatch,
+	.dequeue		= (void *)dsq_throughput_dequeue,
+	.init			= (void *)dsq_throughput_init,
+	.exit			= (void *)dsq_throughput_exit,
+	.name			= "dsq_throughput",
+	.timeout_ms		= 5000U,
+};
@@ -0,0 +1,208 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Ping-pong pairs of threads over pipes, so that every round trip is two
+ * wakeups going through the shared DSQ, and report the wakeup rate with the
+ * shared DSQ taking lockless insertions and with it always locking.
+ */
+#include <bpf/bpf.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <scx/common.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "dsq_throughput.bpf.skel.h"
+#include "scx_test.h"
+
+#define RUN_SECS	2
+#define DRAIN_TRIES	100	/* 10ms apart */
+
+struct pingpong {
+	pthread_t	threads[2];
+	int		pipes[2][2];
+	unsigned long	nr_trips;
+};
+
+static volatile bool stop;
+
+static void *pinger(void *arg)
+{
+	struct pingpong *pp = arg;
+	char c = 0;
+
+	while (!stop) {
+		if (write(pp->pipes[0][1], &c, 1) != 1 ||
+		    read(pp->pipes[1][0], &c, 1) != 1)
+			break;
+		pp->nr_trips++;
+	}
+	/* unblock ponger */
+	close(pp->pipes[0][1]);
+	return NULL;
+}
+
+static void *ponger(void *arg)
+{
+	struct pingpong *pp = arg;
+	char c;
+
+	while (read(pp->pipes[0][0], &c, 1) == 1) {
+		if (write(pp->pipes[1][1], &c, 1) != 1)
+			break;
+	}
+	close(pp->pipes[1][1]);
+	return NULL;
+}
+
+/* Returns the number of wakeups per second, or -1 on failure */
+static double run_pingpong(int nr_pairs)
+{
+	struct pingpong *pps;
+	unsigned long nr_trips = 0;
+	int nr_started = 0;
+	bool failed = false;
+	int i;
+
+	pps = calloc(nr_pairs, sizeof(*pps));
+	if (!pps)
+		return -1;
+
+	stop = false;
+	for (i = 0; i < nr_pairs; i++) {
+		struct pingpong *pp = &pps[i];
+
+		if (pipe(pp->pipes[0]))
+			goto err;
+		if (pipe(pp->pipes[1])) {
+			close(pp->pipes[0][0]);
+			close(pp->pipes[0][1]);
+			goto err;
+		}
+		if (pthread_create(&pp->threads[1], NULL, ponger, pp)) {
+			close(pp->pipes[0][0]);
+			close(pp->pipes[0][1]);
+			close(pp->pipes[1][0]);
+			close(pp->pipes[1][1]);
+			goto err;
+		}
+		if (pthread_create(&pp->threads[0], NULL, pinger, pp)) {
+			/* ponger exits once it sees EOF on the ping pipe */
+			close(pp->pipes[0][1]);
+			pthread_join(pp->threads[1], NULL);
+			close(pp->pipes[0][0]);
+			close(pp->pipes[1][0]);
+			goto err;
+		}
+		nr_started++;
+	}
+
+	sleep(RUN_SECS);
+	goto out;
+err:
+	failed = true;
+out:
+	stop = true;
+
+	/* pairs shut themselves down once pinger sees stop */
+	for (i = 0; i < nr_started; i++) {
+		pthread_join(pps[i].threads[0], NULL);
+		pthread_join(pps[i].threads[1], NULL);
+		close(pps[i].pipes[0][0]);
+		close(pps[i].pipes[1][0]);
+		nr_trips += pps[i].nr_trips;
+	}
+	free(pps);
+
+	return failed ? -1 : 2.0 * nr_trips / RUN_SECS;
+}
+
+/*
+ * Every task inserted into the shared DSQ must leave it again, by being
+ * dispatched or dequeued. Once the workload is done, wait for the DSQ to
+ * drain: an insertion lost on the lockless path never would. Exits are read
+ * before insertions, so this never sees the DSQ drained when it isn't.
+ */
+static bool wait_drained(struct dsq_throughput *skel, __u64 *nr_stuck)
+{
+	__u64 nr_dequeued, nr_enqueued;
+	int i;
+
+	for (i = 0; i < DRAIN_TRIES; i++) {
+		nr_dequeued = __atomic_load_n(&skel->bss->nr_dequeued,
+					      __ATOMIC_ACQUIRE);
+		nr_enqueued = __atomic_load_n(&skel->bss->nr_enqueued,
+					      __ATOMIC_ACQUIRE);
+		*nr_stuck = nr_enqueued - nr_dequeued;
+		if (!*nr_stuck)
+			return true;
+		usleep(10000);
+	}
+	return false;
+}
+
+static enum scx_test_status measure(bool lockless_enq, double *rate)
+{
+	struct dsq_throughput *skel;
+	struct bpf_link *link;
+	int nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	__u64 nr_stuck;
+	bool drained;
+
+	skel = dsq_throughput__open();
+	SCX_FAIL_IF(!skel, "Failed to open");
+	SCX_ENUM_INIT(skel);
+	skel->rodata->lockless_enq = lockless_enq;
+	SCX_FAIL_IF(dsq_throughput__load(skel), "Failed to load skel");
+
+	link = bpf_map__attach_struct_ops(skel->maps.dsq_throughput_ops);
+	SCX_FAIL_IF(!link, "Failed to attach scheduler");
+
+	/* twice as many pairs as CPUs, so that tasks queue up to be batched */
+	*rate = run_pingpong(2 * (nr_cpus > 1 ? nr_cpus : 1));
+	drained = wait_drained(skel, &nr_stuck);
+
+	SCX_EQ(skel->data->uei.kind, EXIT_KIND(SCX_EXIT_NONE));
+	SCX_GT(skel->bss->nr_dispatched, 0);
+	SCX_FAIL_IF(!drained, "%llu tasks never left the shared DSQ",
+		    (unsigned long long)nr_stuck);
+	SCX_FAIL_IF(skel->bss->max_batch <= 1,
+		    "Never moved more than one task per dispatch");
+
+	fprintf(stderr, "%s DSQ: %.0f wakeups/s, %lu enqueued, %lu dispatched, "
+		"%.2f tasks/dispatch, at most %u\n",
+		lockless_enq ? "lockless" : "locked", *rate,
+		skel->bss->nr_enqueued, skel->bss->nr_dispatched,
+		skel->bss->nr_dispatch_calls ?
+		(double)skel->bss->nr_dispatched / skel->bss->nr_dispatch_calls : 0,
+		skel->bss->max_batch);
+
+	bpf_link__destroy(link);
+	dsq_throughput__destroy(skel);
+
+	SCX_FAIL_IF(*rate < 0, "Failed to run the workload");
+	return SCX_TEST_PASS;
+}
+
+static enum scx_test_status run(void *ctx)
+{
+	enum scx_test_status status;
+	double locked, lockless;
+
+	status = measure(false, &locked);
+	if (status != SCX_TEST_PASS)
+		return status;
+
+	status = measure(true, &lockless);
+	if (status != SCX_TEST_PASS)
+		return status;
+
+	fprintf(stderr, "lockless/locked: %.2f\n", locked ? lockless / locked : 0);
+	return SCX_TEST_PASS;
+}
+
+struct scx_test dsq_throughput = {
+	.name = "dsq_throughput",
+	.description = "Measure wakeup throughput through a shared lockless DSQ "
+		       "dispatched in batches",
+	.run = run,
+};
+REGISTER_SCX_TEST(&dsq_throughput)